@@ -6,6 +6,9 @@
 #include "tracker.h"
 #include "datatype.h"
 #include "model.hpp"
+#include "flow_propagator.h"
+#include "reid_pool.h"
+#include "common.h"
 #include <vector>
 
 using std::vector;
@@ -13,22 +16,34 @@ using std::vector;
 class DeepSort {
 public:    
     DeepSort(std::string modelPath, int batchSize, int featureDim, int cpu_id, rknn_core_mask npu_id);
+    // 多路: Re-ID 上下文从 reid 借, 不影响运动门控/跟随等单路的全局状态
+    DeepSort(ReidPool* reid, int featureDim);
     ~DeepSort();
 
 public:
-    void sort(cv::Mat& frame, vector<DetectBox>& dets);
-    void sort_interval(cv::Mat& frame, vector<DetectBox>& dets);
+    void sort(nv12_frame& frame, vector<DetectBox>& dets);
+    // 没有新检测, 只做卡尔曼预测; max_since_update 为输出轨迹允许的未更新帧数, -1 为 track_interval + 1
+    void sort_interval(nv12_frame& frame, vector<DetectBox>& dets, int max_since_update = -1);
     int  track_process();
+    // 处理一帧检测结果 (按帧序号依次调用), frame.dets.results 换成轨迹
+    void process(imageout_idx& frame);
+    // 轨迹当前的外观特征 (样本库平均, 归一化), 离线分段拼接用; 轨迹没有样本时返回 false
+    bool track_feature(int track_id, FEATURE& feature);
     void showDetection(cv::Mat& img, std::vector<DetectBox>& boxes);
 
 private:
-    void sort(cv::Mat& frame, DETECTIONS& detections);
-    void sort(cv::Mat& frame, DETECTIONSV2& detectionsv2);   
+    void sort(nv12_frame& frame, DETECTIONS& detections);
+    void sort(nv12_frame& frame, DETECTIONSV2& detectionsv2);   
     void init();
+    bool tracks_moving();
+    void publish_follow(int frame);
+    void propagate_flow(nv12_frame& frame, const vector<DETECTBOX>& prev_boxes);
+    bool extract_features(nv12_frame& frame, DETECTIONS& detections);
+    void count_reid(int crops);
 
 private:
-    std::string enginePath;
-    int batchSize;
+    std::string enginePath;       // 多路时不用 (Re-ID 上下文来自 reid)
+    int batchSize = 1;
     int featureDim;
     cv::Size imgShape;
     float confThres;
@@ -37,14 +52,27 @@ private:
     float maxCosineDist;
 
     const int track_interval = 1; 
+    // 运动门控统计
+    int gated_run = 0;     // 连续没跑检测的帧数
+    int gated_frames = 0;
+    int total_frames = 0;
+    int flow_updates = 0;  // 光流修正的轨迹数 (累计)
+    // Re-ID 调用统计, 每 300 个有检测的帧打印一次后清零
+    int reid_frames = 0;
+    int reid_max = 0;      // 单帧最多算了几个框
+    long reid_crops = 0;   // 算了特征的框数
+    long reid_skipped = 0; // LAZY_REID 直接配上、没算特征的框数
 private:
     vector<RESULT_DATA> result;
     vector<std::pair<CLSCONF, DETECTBOX>> results;
     tracker* objTracker;
-    FeatureTensor* featureExtractor1;
-    FeatureTensor* featureExtractor2;
-    rknn_core_mask npu_id;
-    int cpu_id;
+    FeatureTensor* featureExtractor1 = NULL;  // 单路自己的两个 Re-ID 上下文, 多路时为空
+    FeatureTensor* featureExtractor2 = NULL;
+    FlowPropagator* flow = NULL;  // FLOW_PROPAGATION 打开时才有
+    ReidPool* reid = NULL;        // 多路共用的 Re-ID 上下文, 为空时用自己的两个
+    bool single_stream = true;
+    rknn_core_mask npu_id = RKNN_NPU_CORE_AUTO;
+    int cpu_id = -1;
 };
 
 #endif  //deepsort.h
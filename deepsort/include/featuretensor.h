@@ -6,21 +6,37 @@
 #include "model.hpp"
 #include "datatype.h"
 #include "rknn_fp.h"
-#include "resize.h"
+#include "frame.h"
+#include "worker_pool.h"
+#include "image_processor.h"
+
+#define REID_CROP_THREADS  2  // 裁剪线程数 (含调用线程)
+#define REID_PARALLEL_MIN  4  // 框数达到该值才分给多个线程
 
 using std::vector;
 
 class FeatureTensor :public rknn_fp{
 public:
     using rknn_fp::rknn_fp;
+    ~FeatureTensor();
     void init(cv::Size, int, int);
-    bool getRectsFeature(const cv::Mat& img, DETECTIONS& det);
-    void doInference(vector<cv::Mat>& imgMats, DETECTIONS& det);
+    bool getRectsFeature(const nv12_frame& img, DETECTIONS& det);
+    /*
+        crops:  n 个连续存放的 imgShape 大小的 BGR 裁剪图
+        index:  第 k 个裁剪图对应的 det 下标
+        按模型 batch 推理, 特征写回 det
+    */
+    void doInference(unsigned char *crops, int n, const vector<int>& index, DETECTIONS& det);
 
 public:
     cv::Size imgShape;
     int featureDim;
-    PreResize pre_do;
+    int batchSize = 1;
+
+private:
+    vector<unsigned char> cropBuf;  // 超过一个 batch 时的裁剪图暂存, 帧间复用
+    WorkerPool *workers = NULL;
+    ImageProcessor *processor = NULL;
 };
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef FLOW_PROPAGATOR_H
+#define FLOW_PROPAGATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "datatype.h"
+#include "frame.h"
+
+#define FLOW_SCALE       2     // 在缩小到 1/FLOW_SCALE 的亮度图上算光流
+#define FLOW_MAX_POINTS  16    // 每个框内最多取的角点数
+#define FLOW_MIN_POINTS  4     // 有效点少于该值时不修正, 只用卡尔曼预测
+#define FLOW_FB_THRESH   1.0   // 前向-后向光流回到起点的误差上限 (缩小后的像素)
+#define FLOW_MAX_AGE     8     // 轨迹连续这么多帧没有检测更新后不再用光流推
+#define FLOW_MAX_ZOOM    1.25  // 两帧之间框的缩放比例上限 (及其倒数)
+
+/*
+    没有检测的帧用稀疏光流推框
+    在上一帧每个框内 (略向内收) 取角点, 金字塔 LK 跟到当前帧, 再反向跟回去剔除错点,
+    取位移的中位数为框的平移, 点对距离比值的中位数为缩放
+    所有框的点一次送进 calcOpticalFlowPyrLK, 金字塔每帧只建一次
+*/
+class FlowPropagator {
+public:
+    // 有检测的帧: 只记下该帧, 作为下一帧光流的起点
+    void reset(const nv12_frame &frame);
+    /*
+        prev_boxes: 各框在上一帧的位置 (tlwh, 宽或高为 0 的不处理)
+        out: 推到当前帧的框, ok[i] 为 0 时点太少, out[i] 不可用
+        返回推成功的框数; 当前帧随后成为下一次的起点
+    */
+    int propagate(const nv12_frame &frame, const std::vector<DETECTBOX> &prev_boxes, std::vector<DETECTBOX> &out,
+                  std::vector<uint8_t> &ok);
+
+private:
+    void downscale(const nv12_frame &frame, cv::Mat &luma);
+
+    cv::Mat prev;
+    cv::Mat cur;
+    std::vector<cv::Point2f> p0, p1, back;   // 复用, 避免每帧分配
+    std::vector<int> owner;                  // 每个点属于哪个框
+    std::vector<uint8_t> status, status_back;
+    std::vector<float> err;
+};
+
+#endif // FLOW_PROPAGATOR_H
@@ -7,15 +7,11 @@
 #define INFTY_COST 1e5
 class tracker;
 //for matching;
+// 没有状态, 在调用处构造即可; 各路的 tracker 可以在不同线程同时匹配
 class linear_assignment
 {
-    linear_assignment();
-    linear_assignment(const linear_assignment& );
-    linear_assignment& operator=(const linear_assignment&);
-    static linear_assignment* instance;
-
 public:
-    static linear_assignment* getInstance();
+    linear_assignment();
     TRACHER_MATCHD matching_cascade(tracker* distance_metric,
             tracker::GATED_METRIC_FUNC distance_metric_func,
             float max_distance,
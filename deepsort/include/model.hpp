@@ -19,6 +19,7 @@ public:
     DETECTBOX tlwh;
     float confidence;
     FEATURE feature;
+    bool has_feature = true;  // 关联优先 (LAZY_REID) 时直接配上的检测没有算特征
 
     DETECTBOX to_xyah() const {
         //(centerx, centery, ration, h)
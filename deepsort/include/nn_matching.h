@@ -15,6 +15,8 @@ public:
     DYNAMICM distance(const FEATURESS& features, const std::vector<int> &targets);
     //    void partial_fit(FEATURESS& features, std::vector<int> targets, std::vector<int> active_targets);
     void partial_fit(std::vector<TRACKER_DATA>& tid_feats, std::vector<int>& active_targets);
+    // 轨迹样本库的平均特征 (归一化), 没有样本时返回 false
+    bool mean_feature(int track_id, FEATURE& feature) const;
     float mating_threshold;
 
 private:
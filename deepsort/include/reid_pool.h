@@ -0,0 +1,32 @@
+#ifndef REID_POOL_H
+#define REID_POOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "featuretensor.h"
+
+/*
+    多路共用的 Re-ID 上下文
+    各路追踪线程每帧借一个上下文算特征, 用完归还; 都在用时按到达顺序等待
+*/
+class ReidPool {
+public:
+    ReidPool(const std::string &modelPath, int n, int cpu_id, rknn_core_mask npu_id, cv::Size imgShape,
+             int featureDim);
+    ~ReidPool();
+    FeatureTensor *acquire();
+    void release(FeatureTensor *ft);
+
+private:
+    std::vector<FeatureTensor *> all;
+    std::vector<FeatureTensor *> idle;
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned long next_ticket = 0;  // 发号 / 叫号, 保证先到先得
+    unsigned long serving = 0;
+};
+
+#endif // REID_POOL_H
@@ -82,6 +82,7 @@ public:
 
     int cls;
     float conf;
+    int lazy_updates = 0;  // 连续几次更新没带特征 (LAZY_REID 直接配上), 到 LAZY_REID_REFRESH 时要算一次
 private:
     void featuresAppendOne(const FEATURE& f);
 };
@@ -10,6 +10,9 @@
 
 using namespace std;
 
+#define LAZY_REID_IOU      0.5   // 无歧义配对要求预测框与检测框的 IoU 不低于此值
+#define LAZY_REID_REFRESH  10    // 轨迹连续这么多次不带特征配对后, 下一次配对算特征更新样本库
+
 class NearNeighborDisMetric;
 
 class tracker
@@ -32,6 +35,11 @@ public:
     void predict();
     void update(const DETECTIONS& detections);
     void update(const DETECTIONSV2& detectionsv2);
+    // direct: match_unambiguous 找出的配对 (轨迹下标, 检测下标), 直接更新, 其余照常匹配
+    void update(const DETECTIONSV2& detectionsv2, const std::vector<MATCH_DATA>& direct);
+    // 关联优先: 须在 predict 之后调用, need_feature 为要算特征的检测
+    void match_unambiguous(const DETECTIONS& detections, std::vector<MATCH_DATA>& matches,
+                           std::vector<int>& need_feature);
     typedef DYNAMICM (tracker::* GATED_METRIC_FUNC)(
             std::vector<Track>& tracks,
             const DETECTIONS& dets,
@@ -39,6 +47,9 @@ public:
             const std::vector<int>& detection_indices);
 private:    
     void _match(const DETECTIONS& detections, TRACHER_MATCHD& res);
+    // 只在 detection_indices 与没有被 skip_tracks 标记的轨迹之间匹配
+    void _match(const DETECTIONS& detections, TRACHER_MATCHD& res, std::vector<int>& detection_indices,
+                const std::vector<bool>& skip_tracks);
     void _initiate_track(const DETECTION_ROW& detection);
     void _initiate_track(const DETECTION_ROW& detection, CLSCONF clsConf);
 public:
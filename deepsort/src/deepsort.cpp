@@ -3,10 +3,13 @@
 #include <iostream>
 
 #include <thread>
+#include <atomic>
 
 #include "deepsort.h"
 #include "common.h"
 #include "mytime.h"
+#include "motion_detector.h"
+#include "nn_matching.h"
 using namespace std;
 
 struct video_property;
@@ -16,6 +19,12 @@ extern video_property video_probs;       // 视频属性类
 extern bool bDetecting;                  // 目标检测进程状态
 extern bool bTracking;                   // 目标追踪进程状态               
 extern double end_time;                  // 整个视频追踪结束
+extern atomic<bool> bTracksMoving;       // 有确认的轨迹在动, 运动门控用
+extern atomic<int> followTrackID;        // 跟随的轨迹 ID
+extern mutex mtxFollow;
+extern follow_state followTarget;        // 被跟随轨迹的状态, videoResize 据此裁剪检测区域
+extern bool FLOW_PROPAGATION;            // 没有检测的帧用光流修正轨迹
+extern bool LAZY_REID;                   // 关联优先, 无歧义配上的检测不算 Re-ID 特征
 
 extern mutex mtxQueueOutput;
 extern mutex mtxQueueDetOut;
@@ -32,23 +41,41 @@ DeepSort::DeepSort(std::string modelPath, int batchSize, int featureDim, int cpu
     init();
 }
 
+DeepSort::DeepSort(ReidPool* reid, int featureDim) {
+    this->reid = reid;
+    this->single_stream = false;
+    this->featureDim = featureDim;
+    this->imgShape = cv::Size(128, 256);
+    this->maxBudget = 100;
+    this->maxCosineDist = 0.2;
+    init();
+}
+
 void DeepSort::init() {
     objTracker = new tracker(maxCosineDist, maxBudget);
 
-    // two Re-ID networks, share same CPU and NPU
-    featureExtractor1 = new FeatureTensor(enginePath.c_str(), cpu_id, npu_id, 1, 1);
-    featureExtractor1->init(imgShape, featureDim, NET_INPUTCHANNEL);
+    if (reid == NULL) {
+        // two Re-ID networks, share same CPU and NPU
+        featureExtractor1 = new FeatureTensor(enginePath.c_str(), cpu_id, npu_id, 1, 1);
+        featureExtractor1->init(imgShape, featureDim, NET_INPUTCHANNEL);
 
-    featureExtractor2 = new FeatureTensor(enginePath.c_str(), cpu_id, npu_id, 1, 1);
-    featureExtractor2->init(imgShape, featureDim, NET_INPUTCHANNEL);
+        featureExtractor2 = new FeatureTensor(enginePath.c_str(), cpu_id, npu_id, 1, 1);
+        featureExtractor2->init(imgShape, featureDim, NET_INPUTCHANNEL);
+    }
 
+    if (FLOW_PROPAGATION)
+        flow = new FlowPropagator();
 }
 
 DeepSort::~DeepSort() {
     delete objTracker;
+    delete flow;
+    // 借来的 reid 由调用者释放
+    delete featureExtractor1;
+    delete featureExtractor2;
 }
 
-void DeepSort::sort(cv::Mat& frame, vector<DetectBox>& dets) {
+void DeepSort::sort(nv12_frame& frame, vector<DetectBox>& dets) {
     // preprocess Mat -> DETECTION
     DETECTIONS detections;  // DETECTIONS: std::vector<DETECTION_ROW> in model.hpp
     vector<CLSCONF> clsConf;
@@ -83,11 +110,16 @@ void DeepSort::sort(cv::Mat& frame, vector<DetectBox>& dets) {
         dets[i].classID = c.cls;
         dets[i].confidence = c.conf;
     }
+    if (flow != NULL)
+        flow->reset(frame);
 }
 
 
-void DeepSort::sort(cv::Mat& frame, DETECTIONS& detections) {
-    bool flag = featureExtractor1->getRectsFeature(frame, detections);
+void DeepSort::sort(nv12_frame& frame, DETECTIONS& detections) {
+    FeatureTensor* ft = reid != NULL ? reid->acquire() : featureExtractor1;
+    bool flag = ft->getRectsFeature(frame, detections);
+    if (reid != NULL)
+        reid->release(ft);
     if (flag) {
         objTracker->predict();
         objTracker->update(detections);
@@ -100,22 +132,32 @@ void DeepSort::sort(cv::Mat& frame, DETECTIONS& detections) {
     }
 }
 
-void DeepSort::sort_interval(cv::Mat& frame, vector<DetectBox>& dets) {
+void DeepSort::sort_interval(nv12_frame& frame, vector<DetectBox>& dets, int max_since_update) {
     /*
     If frame_id % this->track_interval != 0, there is no new detections
     so only predict the tracks using Kalman
     */
     if (!dets.empty()) cout << "Error occured! \n";
+    if (max_since_update < 0)
+        max_since_update = this->track_interval + 1;
 
     result.clear();
     results.clear();
+    // 光流从各轨迹在上一帧的框出发, 预测前记下
+    vector<DETECTBOX> prev_boxes;
+    if (flow != NULL) {
+        for (Track& track : objTracker->tracks)
+            prev_boxes.push_back(track.to_tlwh());
+    }
     objTracker->predict();  // Kalman predict
+    if (flow != NULL)
+        propagate_flow(frame, prev_boxes);
 
     // update result and results
     // cout << "---------" << objTracker->tracks.size() << "\n";
     for (Track& track : objTracker->tracks) {
             // if (!track.is_confirmed() || track.time_since_update > 1)
-            if (!track.is_confirmed() || track.time_since_update > this->track_interval + 1)
+            if (!track.is_confirmed() || track.time_since_update > max_since_update)
                 continue;
             result.push_back(make_pair(track.track_id, track.to_tlwh()));
             results.push_back(make_pair(CLSCONF(track.cls, track.conf) ,track.to_tlwh()));
@@ -135,13 +177,85 @@ void DeepSort::sort_interval(cv::Mat& frame, vector<DetectBox>& dets) {
 
 }
 
-void DeepSort::sort(cv::Mat& frame, DETECTIONSV2& detectionsv2) {
-    std::vector<CLSCONF>& clsConf = detectionsv2.first;
-    DETECTIONS& detections = detectionsv2.second;  // std::vector<DETECTION_ROW>
+/*
+    光流推出的框作为伪观测更新卡尔曼状态, 修正纯匀速预测的漂移
+    只处理最近 FLOW_MAX_AGE 帧内有过检测的确认轨迹; time_since_update 不清零,
+    长时间没有检测的轨迹照常老化
+*/
+void DeepSort::propagate_flow(nv12_frame& frame, const vector<DETECTBOX>& prev_boxes) {
+    vector<DETECTBOX> boxes = prev_boxes;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        Track& track = objTracker->tracks[i];
+        if (!track.is_confirmed() || track.time_since_update > FLOW_MAX_AGE)
+            boxes[i](2) = boxes[i](3) = 0;
+    }
+    vector<DETECTBOX> moved;
+    vector<uint8_t> ok;
+    if (flow->propagate(frame, boxes, moved, ok) == 0)
+        return;
+    for (size_t i = 0; i < moved.size(); i++) {
+        if (!ok[i])
+            continue;
+        Track& track = objTracker->tracks[i];
+        DETECTION_ROW measurement;
+        measurement.tlwh = moved[i];
+        KAL_DATA pa = objTracker->kf->update(track.mean, track.covariance, measurement.to_xyah());
+        track.mean = pa.first;
+        track.covariance = pa.second;
+        flow_updates++;
+    }
+}
+
+// 确认的轨迹中是否有速度超过 MOTION_TRACK_SPEED 的 (卡尔曼状态 x, y, a, h, vx, vy, va, vh)
+bool DeepSort::tracks_moving() {
+    for (Track& track : objTracker->tracks) {
+        if (!track.is_confirmed())
+            continue;
+        if (fabs(track.mean(4)) > MOTION_TRACK_SPEED || fabs(track.mean(5)) > MOTION_TRACK_SPEED)
+            return true;
+    }
+    return false;
+}
+
+// 把被跟随轨迹的卡尔曼状态交给 videoResize, 由它外推到要检测的帧
+void DeepSort::publish_follow(int frame) {
+    int id = followTrackID;
+    if (id < 0)
+        return;
+    follow_state s = {id, frame, false, 0, 0, 0, 0, 0, 0};
+    for (Track& track : objTracker->tracks) {
+        if (track.track_id != id)
+            continue;
+        DETECTBOX box = track.to_tlwh();
+        s.valid = track.is_confirmed() && track.time_since_update <= 1;
+        s.cx = box(0) + box(2) * 0.5f;
+        s.cy = box(1) + box(3) * 0.5f;
+        s.w = box(2);
+        s.h = box(3);
+        s.vx = track.mean(4);
+        s.vy = track.mean(5);
+        break;
+    }
+    mtxFollow.lock();
+    followTarget = s;
+    mtxFollow.unlock();
+}
 
+// 给 detections 算 Re-ID 特征, 框多时两个上下文并行
+bool DeepSort::extract_features(nv12_frame& frame, DETECTIONS& detections) {
     int numOfDetections = detections.size();
     bool flag1 = true, flag2 = true;
-    if (numOfDetections < 2){
+    if (reid == NULL && featureExtractor1 == NULL) {
+        printf("DeepSort: no Re-ID context\n");
+        return false;
+    }
+    if (reid != NULL) {
+        // 多路: 借一个上下文, 框多时由它自己的裁剪线程并行
+        FeatureTensor* ft = reid->acquire();
+        flag1 = ft->getRectsFeature(frame, detections);
+        reid->release(ft);
+    }
+    else if (numOfDetections < 2 || featureExtractor2 == NULL){
         // few objects, use single Re-ID 
         double timeBeforeReID = what_time_is_it_now();
         flag1 = featureExtractor1->getRectsFeature(frame, detections);
@@ -187,12 +301,53 @@ void DeepSort::sort(cv::Mat& frame, DETECTIONSV2& detectionsv2) {
         cout << "--------Time cost in update features: " << timeAfterUpdateFeatures - timeBeforeUpdateFeatures << "\n";
 
     }
- 
-    // bool flag = featureExtractor->getRectsFeature(frame, detections);
-    if (flag1 && flag2) {
+    return flag1 && flag2;
+}
+
+void DeepSort::sort(nv12_frame& frame, DETECTIONSV2& detectionsv2) {
+    DETECTIONS& detections = detectionsv2.second;  // std::vector<DETECTION_ROW>
+
+    bool ok;
+    vector<MATCH_DATA> direct;
+    if (LAZY_REID) {
+        // 关联优先: 先预测, 门控 + IoU 无歧义配上的检测不算特征
         objTracker->predict();
+        vector<int> need;
+        objTracker->match_unambiguous(detections, direct, need);
+        DETECTIONS part;
+        for (int i : need)
+            part.push_back(detections[i]);
+        ok = part.empty() || extract_features(frame, part);
+        for (size_t k = 0; ok && k < need.size(); k++)
+            detections[need[k]].updateFeature(part[k].feature);
+        for (MATCH_DATA& m : direct)
+            detections[m.second].has_feature = false;
+        reid_skipped += direct.size();
+        count_reid(need.size());
+        if (!ok) {
+            // 已经预测过了, 不能整帧丢掉: 只用直接配上的检测更新, 其余轨迹照常记为丢失
+            printf("Re-ID fail on %d crops, frame updated with %d direct matches only\n", (int)need.size(),
+                   (int)direct.size());
+            DETECTIONSV2 kept;
+            for (size_t k = 0; k < direct.size(); k++) {
+                kept.first.push_back(detectionsv2.first[direct[k].second]);
+                kept.second.push_back(detections[direct[k].second]);
+                direct[k].second = k;
+            }
+            detectionsv2 = kept;
+            ok = true;
+        }
+    }
+    else {
+        ok = extract_features(frame, detections);
+        count_reid(detections.size());
+        if (ok)
+            objTracker->predict();
+    }
+
+    if (ok) {
         // std::cout << "In: \n"; 
-        objTracker->update(detectionsv2);     
+        objTracker->update(detectionsv2, direct);
         // std::cout << "Out: \n";    
         result.clear();
         results.clear();
@@ -203,7 +358,57 @@ void DeepSort::sort(cv::Mat& frame, DETECTIONSV2& detectionsv2) {
             results.push_back(make_pair(CLSCONF(track.cls, track.conf) ,track.to_tlwh()));
         }
     }
-    else cout << "Re-ID1 Error? " << flag1 << " Re-ID2 Error? " << flag2 << "\n";
+    else
+        printf("Re-ID fail on %d crops, frame dropped\n", (int)detections.size());
+}
+
+void DeepSort::process(imageout_idx& frame) {
+    // get frame index of queueDetOut.front
+    int curFrameIdx = frame.dets.id;
+    // cout << "Is id match with result " << (!frame.dets.results.empty() && !(curFrameIdx % 3)) << "\n";
+
+    if (frame.dets.skipped) {
+        // 运动门控/检测间隔跳过了检测: 只预测 (或光流修正), 上次检测时在的轨迹继续输出
+        gated_run++;
+        gated_frames++;
+        sort_interval(frame.img, frame.dets.results, gated_run + 1);
+    }
+    else if (curFrameIdx < this->track_interval || !(curFrameIdx % this->track_interval)) { // have detections
+        gated_run = 0;
+        sort(frame.img, frame.dets.results);  // 会更新 dets.results
+    }
+    else
+        sort_interval(frame.img, frame.dets.results);
+    frame.dets.count = frame.dets.results.size();
+    if (single_stream) {
+        bTracksMoving = tracks_moving();
+        publish_follow(curFrameIdx);
+    }
+    total_frames++;
+    if (gated_frames > 0 && total_frames % 300 == 0)
+        printf("Skipped detection on %d/%d frames (%.1f%%), %d optical flow track updates\n", gated_frames,
+               total_frames, 100.0 * gated_frames / total_frames, flow_updates);
+    if (reid_frames >= 300) {
+        // 每帧算特征的框数 (Re-ID 调用); LAZY_REID 时另计无歧义直接配上、省掉的框数
+        printf("Re-ID: %.2f crops/frame (max %d) over %d frames", (double)reid_crops / reid_frames, reid_max,
+               reid_frames);
+        if (LAZY_REID)
+            printf(", %.2f/frame matched without Re-ID (%.1f%% of detections)", (double)reid_skipped / reid_frames,
+                   100.0 * reid_skipped / std::max(1L, reid_crops + reid_skipped));
+        printf("\n");
+        reid_frames = reid_max = 0;
+        reid_crops = reid_skipped = 0;
+    }
+}
+
+void DeepSort::count_reid(int crops) {
+    reid_frames++;
+    reid_crops += crops;
+    reid_max = std::max(reid_max, crops);
+}
+
+bool DeepSort::track_feature(int track_id, FEATURE& feature) {
+    return objTracker->metric->mean_feature(track_id, feature);
 }
 
 int DeepSort::track_process(){
@@ -221,14 +426,7 @@ int DeepSort::track_process(){
             continue;
 		}
 
-        // get frame index of queueDetOut.front
-        int curFrameIdx = queueDetOut.front().dets.id;
-        // cout << "Is id match with result " << (!queueDetOut.front().dets.results.empty() && !(curFrameIdx % 3)) << "\n";
-		
-        if (curFrameIdx < this->track_interval || !(curFrameIdx % this->track_interval))  // have detections
-            sort(queueDetOut.front().img , queueDetOut.front().dets.results);  // 会更新 dets.results
-        else  
-            sort_interval(queueDetOut.front().img , queueDetOut.front().dets.results);
+        process(queueDetOut.front());
         mtxQueueOutput.lock();
         // cout << "--------------" << queueDetOut.front().dets.results.size() << "\n";
         queueOutput.push(queueDetOut.front());
@@ -238,6 +436,10 @@ int DeepSort::track_process(){
         queueDetOut.pop();
         mtxQueueDetOut.unlock();
     }
+    if (gated_frames > 0)
+        printf("Skipped detection on %d/%d frames (%.1f%%), NPU inference saved on those frames; "
+               "%d optical flow track updates\n",
+               gated_frames, total_frames, 100.0 * gated_frames / total_frames, flow_updates);
     cout << "Track is over." << endl;
     return 0;
 }
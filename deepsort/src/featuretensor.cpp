@@ -1,74 +1,115 @@
 #include <queue>
 #include <iostream>
+#include <algorithm>
+#include <string.h>
 
 #include "featuretensor.h"
 #include "mytime.h"
 
 
+extern std::string IMAGE_BACKEND;
+
+FeatureTensor::~FeatureTensor() {
+    delete workers;
+    delete processor;
+}
+
 void FeatureTensor::init(cv::Size netShape, int featureDim, int channel){
     this->imgShape = netShape;
     this->featureDim = featureDim;
-    this->pre_do = PreResize(netShape.height, netShape.width, channel);
+    // 输入为 NHWC, dims[0] 即模型的 batch
+    this->batchSize = _input_attrs[0].dims[0] > 0 ? _input_attrs[0].dims[0] : 1;
+    this->workers = new WorkerPool(REID_CROP_THREADS - 1);
+    this->processor = create_image_processor(IMAGE_BACKEND.c_str());
+    printf("Re-ID: batch %d, %dx%dx%d\n", batchSize, netShape.width, netShape.height, channel);
 }
 
-void FeatureTensor::doInference(vector<cv::Mat>& imgMats, DETECTIONS& det) {
+void FeatureTensor::doInference(unsigned char *crops, int n, const vector<int>& index, DETECTIONS& det) {
     std::queue<float> history_time;
 	float sum_time = 0;
 	int cost_time = 0; // rknn接口查询返回
 	float npu_performance = 0.0;
+    size_t crop_bytes = (size_t)imgShape.area() * 3;
+    const rknn_tensor_attr &attr = _output_attrs[0];
 
-    for (int i = 0;i < imgMats.size();i++){
-        
-		cost_time = inference(imgMats[i].data);
-        // std::cout << "in deepsort doInference: " << i << "\n";
-		float* output = (float *)_output_buff[0];
-		for (int j = 0; j < featureDim; ++j)
-            det[i].feature[j] = output[j];
+    for (int b = 0; b < n; b += batchSize) {
+        int m = std::min(batchSize, n - b);
+        unsigned char *input = crops + b * crop_bytes;
+        // 最后不满一个 batch: 只拷有效部分, 其余位置的输出不用
+        if (m < batchSize && input != input_buffer()) {
+            memcpy(input_buffer(), input, m * crop_bytes);
+            input = input_buffer();
+        }
+		cost_time = inference(input);
+        for (int k = 0; k < m; k++) {
+            FEATURE &feature = det[index[b + k]].feature;
+            if (attr.type == RKNN_TENSOR_FLOAT32) {
+                float *output = (float *)_output_buff[0] + k * featureDim;
+                for (int j = 0; j < featureDim; ++j)
+                    feature[j] = output[j];
+            }
+            else {
+                int8_t *output = (int8_t *)_output_buff[0] + k * featureDim;
+                for (int j = 0; j < featureDim; ++j)
+                    feature[j] = ((float)output[j] - attr.zp) * attr.scale;
+            }
+        }
         npu_performance = cal_NPU_performance(history_time, sum_time, cost_time / 1.0e3);
         // printf("Deepsort: %f NPU(%d) performance : %f\n", what_time_is_it_now()/1000, _cpu_id, npu_performance);
 	}
 }
 
-bool FeatureTensor::getRectsFeature(const cv::Mat& img, DETECTIONS& det) {
-    std::vector<cv::Mat> mats;
-    
+bool FeatureTensor::getRectsFeature(const nv12_frame& img, DETECTIONS& det) {
     double timeBeforeGetRectsFeature = what_time_is_it_now();
 
-    for (auto& dbox : det) {
+    vector<cv::Rect> rects;
+    vector<int> index;
+    for (int i = 0; i < (int)det.size(); i++) {
+        DETECTION_ROW& dbox = det[i];
         cv::Rect rect = cv::Rect(int(dbox.tlwh(0)), int(dbox.tlwh(1)),
                                  int(dbox.tlwh(2)), int(dbox.tlwh(3)));
-        // std::cout << img.cols << " " << img.rows << "\n";
         // std::cout << dbox.tlwh(0) << " " << dbox.tlwh(1) << " "  << dbox.tlwh(2) << " "  << dbox.tlwh(3) << "\n";
 
         rect.x -= (rect.height * 0.5 - rect.width) * 0.5;
         rect.width = rect.height * 0.5;
         rect.x = (rect.x >= 0 ? rect.x : 0);
         rect.y = (rect.y >= 0 ? rect.y : 0);
-        rect.width = (rect.x + rect.width <= img.cols ? rect.width : (img.cols - rect.x));
-        rect.height = (rect.y + rect.height <= img.rows ? rect.height : (img.rows - rect.y));
+        rect.width = (rect.x + rect.width <= img.width ? rect.width : (img.width - rect.x));
+        rect.height = (rect.y + rect.height <= img.height ? rect.height : (img.height - rect.y));
 
-        if (rect.width < 0 || rect.height < 0) continue;
-        // std::cout << rect.x << " " << rect.y << " " << rect.width << " " << rect.height << "\n";
-        cv::Mat tempMat = img(rect).clone();
-        /*
-        if (tempMat.rows < 128 || tempMat.cols < 256) {
-            std::cout << tempMat.rows << " " << tempMat.cols << "\n";
-        }
-        */
-        if (tempMat.size().empty()) {
-            std::cout << "tempMat is empty: " << tempMat.cols << " " << tempMat.rows << "\n";
+        if (rect.width < 2 || rect.height < 2) {
+            std::cout << "tempMat is empty: " << rect.width << " " << rect.height << "\n";
             continue;
         }
-        cv::resize(tempMat, tempMat, imgShape);  // opencv
-        // pre_do.resize(tempMat, tempMat);  // rga
-        mats.push_back(tempMat);
+        rects.push_back(rect);
+        index.push_back(i);
+    }
+
+    // 不超过一个 batch 时直接裁剪到输入 tensor, 否则先放到暂存区
+    int n = rects.size();
+    size_t crop_bytes = (size_t)imgShape.area() * 3;
+    unsigned char *crops = input_buffer();
+    if (n > batchSize) {
+        if (cropBuf.size() < n * crop_bytes)
+            cropBuf.resize(n * crop_bytes);
+        crops = cropBuf.data();
     }
-    
-    doInference(mats, det);
+    // NV12 裁剪 + 缩放 + 转 BGR 一次完成
+    image_view src = img.view();
+    auto crop = [&](int k) {
+        image_rect rect = {rects[k].x, rects[k].y, rects[k].width, rects[k].height};
+        processor->crop(src, rect, make_image_view(crops + k * crop_bytes, imgShape.width, imgShape.height, IMAGE_BGR888));
+    };
+    if (n >= REID_PARALLEL_MIN)
+        workers->parallel_for(n, crop);
+    else
+        for (int k = 0; k < n; k++) crop(k);
+
+    doInference(crops, n, index, det);
 
     double timeAfterGetRectsFeature = what_time_is_it_now();
     std::cout << "--------Time cost in getRectsFeature: " << timeAfterGetRectsFeature- timeBeforeGetRectsFeature << "\n";
 
-    // std::cout << "in deepsort inference: " << mats.size() << "\n";
+    // std::cout << "in deepsort inference: " << n << "\n";
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,103 @@
+#include <math.h>
+#include <algorithm>
+
+#include "flow_propagator.h"
+
+static float median(std::vector<float> &v)
+{
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+void FlowPropagator::downscale(const nv12_frame &frame, cv::Mat &luma)
+{
+    // 只用 Y 平面, 不做颜色转换
+    cv::Mat y(frame.height, frame.width, CV_8UC1, (void *)frame.y(), frame.stride());
+    cv::resize(y, luma, cv::Size(frame.width / FLOW_SCALE, frame.height / FLOW_SCALE), 0, 0, cv::INTER_AREA);
+}
+
+void FlowPropagator::reset(const nv12_frame &frame)
+{
+    downscale(frame, prev);
+}
+
+int FlowPropagator::propagate(const nv12_frame &frame, const std::vector<DETECTBOX> &prev_boxes,
+                              std::vector<DETECTBOX> &out, std::vector<uint8_t> &ok)
+{
+    int n = prev_boxes.size();
+    out = prev_boxes;
+    ok.assign(n, 0);
+    downscale(frame, cur);
+    if (prev.size() != cur.size()) {
+        std::swap(prev, cur);
+        return 0;
+    }
+
+    // 上一帧各框内取角点, 框向内收 1/8 少取背景
+    p0.clear();
+    owner.clear();
+    std::vector<cv::Point2f> corners;
+    for (int i = 0; i < n; i++) {
+        const DETECTBOX &b = prev_boxes[i];
+        float x = b(0) / FLOW_SCALE, y = b(1) / FLOW_SCALE, w = b(2) / FLOW_SCALE, h = b(3) / FLOW_SCALE;
+        int x1 = std::max((int)(x + w / 8), 0), y1 = std::max((int)(y + h / 8), 0);
+        int x2 = std::min((int)(x + w * 7 / 8), prev.cols), y2 = std::min((int)(y + h * 7 / 8), prev.rows);
+        if (x2 - x1 < 8 || y2 - y1 < 8)
+            continue;
+        cv::goodFeaturesToTrack(prev(cv::Rect(x1, y1, x2 - x1, y2 - y1)), corners, FLOW_MAX_POINTS, 0.01, 3);
+        for (const cv::Point2f &c : corners) {
+            p0.push_back(cv::Point2f(c.x + x1, c.y + y1));
+            owner.push_back(i);
+        }
+    }
+    if (p0.empty()) {
+        std::swap(prev, cur);
+        return 0;
+    }
+
+    cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03);
+    cv::calcOpticalFlowPyrLK(prev, cur, p0, p1, status, err, cv::Size(15, 15), 2, criteria);
+    cv::calcOpticalFlowPyrLK(cur, prev, p1, back, status_back, err, cv::Size(15, 15), 2, criteria);
+
+    // owner 按框递增, 每个框的点是连续的一段
+    int moved = 0;
+    std::vector<float> dx, dy, zoom;
+    for (size_t begin = 0, end; begin < p0.size(); begin = end) {
+        int i = owner[begin];
+        dx.clear();
+        dy.clear();
+        std::vector<size_t> good;
+        for (end = begin; end < p0.size() && owner[end] == i; end++) {
+            float fb = hypotf(back[end].x - p0[end].x, back[end].y - p0[end].y);
+            if (!status[end] || !status_back[end] || fb > FLOW_FB_THRESH)
+                continue;
+            dx.push_back(p1[end].x - p0[end].x);
+            dy.push_back(p1[end].y - p0[end].y);
+            good.push_back(end);
+        }
+        if ((int)good.size() < FLOW_MIN_POINTS)
+            continue;
+
+        // 点对距离在两帧中的比值, 相邻点配对即可
+        zoom.clear();
+        for (size_t k = 0; k + 1 < good.size(); k++) {
+            size_t a = good[k], b = good[k + 1];
+            float d0 = hypotf(p0[a].x - p0[b].x, p0[a].y - p0[b].y);
+            if (d0 < 2)
+                continue;
+            zoom.push_back(hypotf(p1[a].x - p1[b].x, p1[a].y - p1[b].y) / d0);
+        }
+        float s = zoom.empty() ? 1.f : median(zoom);
+        s = std::min(std::max(s, (float)(1 / FLOW_MAX_ZOOM)), (float)FLOW_MAX_ZOOM);
+
+        const DETECTBOX &b = prev_boxes[i];
+        float cx = b(0) + b(2) / 2 + median(dx) * FLOW_SCALE;
+        float cy = b(1) + b(3) / 2 + median(dy) * FLOW_SCALE;
+        float w = b(2) * s, h = b(3) * s;
+        out[i] = DETECTBOX(cx - w / 2, cy - h / 2, w, h);
+        ok[i] = 1;
+        moved++;
+    }
+    std::swap(prev, cur);
+    return moved;
+}
@@ -2,17 +2,10 @@
 #include "hungarianoper.h"
 #include <map>
 
-linear_assignment *linear_assignment::instance = NULL;
 linear_assignment::linear_assignment()
 {
 }
 
-linear_assignment *linear_assignment::getInstance()
-{
-    if(instance == NULL) instance = new linear_assignment();
-    return instance;
-}
-
 TRACHER_MATCHD
 linear_assignment::matching_cascade(
         tracker *distance_metric,
@@ -51,9 +44,11 @@ linear_assignment::matching_cascade(
     //        }
     //    }
 
-    //!!!python diff: detection_indices will always be None.
-    for(size_t i = 0; i < detections.size(); i++) {
-        detection_indices.push_back(int(i));
+    //!!!python diff: detection_indices is None unless only part of the detections take part (LAZY_REID).
+    if(detection_indices.empty()) {
+        for(size_t i = 0; i < detections.size(); i++) {
+            detection_indices.push_back(int(i));
+        }
     }
 
     std::vector<int> unmatched_detections;
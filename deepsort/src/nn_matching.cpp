@@ -20,6 +20,19 @@ NearNeighborDisMetric::NearNeighborDisMetric(
     this->samples.clear();
 }
 
+bool NearNeighborDisMetric::mean_feature(int track_id, FEATURE& feature) const
+{
+    std::map<int, FEATURESS>::const_iterator it = samples.find(track_id);
+    if (it == samples.end() || it->second.rows() == 0)
+        return false;
+    feature = it->second.colwise().mean();
+    float norm = feature.norm();
+    if (norm <= 0)
+        return false;
+    feature /= norm;
+    return true;
+}
+
 DYNAMICM 
 NearNeighborDisMetric::distance(
     const FEATURESS & features,
@@ -0,0 +1,39 @@
+#include "reid_pool.h"
+#include "common.h"
+
+ReidPool::ReidPool(const std::string &modelPath, int n, int cpu_id, rknn_core_mask npu_id, cv::Size imgShape,
+                   int featureDim)
+{
+    for (int i = 0; i < n; i++) {
+        FeatureTensor *ft = new FeatureTensor(modelPath.c_str(), cpu_id, npu_id, 1, 1);
+        ft->init(imgShape, featureDim, NET_INPUTCHANNEL);
+        all.push_back(ft);
+        idle.push_back(ft);
+    }
+}
+
+ReidPool::~ReidPool()
+{
+    for (FeatureTensor *ft : all)
+        delete ft;
+}
+
+FeatureTensor *ReidPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    unsigned long ticket = next_ticket++;
+    cv.wait(lock, [&] { return ticket == serving && !idle.empty(); });
+    serving++;
+    FeatureTensor *ft = idle.back();
+    idle.pop_back();
+    // 下一个号可能也有空闲的上下文
+    cv.notify_all();
+    return ft;
+}
+
+void ReidPool::release(FeatureTensor *ft)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    idle.push_back(ft);
+    cv.notify_all();
+}
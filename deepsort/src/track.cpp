@@ -60,7 +60,12 @@ void Track::update(MyKalmanFilter * const kf, const DETECTION_ROW & detection)
     this->mean = pa.first;
     this->covariance = pa.second;
 
-    featuresAppendOne(detection.feature);
+    if (detection.has_feature) {
+        featuresAppendOne(detection.feature);
+        lazy_updates = 0;
+    }
+    else
+        lazy_updates++;
     //    this->features.row(features.rows()) = detection.feature;
     this->hits += 1;
     this->time_since_update = 0;
@@ -75,7 +80,12 @@ void Track::update(MyKalmanFilter * const kf, const DETECTION_ROW & detection, C
     this->mean = pa.first;
     this->covariance = pa.second;
 
-    featuresAppendOne(detection.feature);
+    if (detection.has_feature) {
+        featuresAppendOne(detection.feature);
+        lazy_updates = 0;
+    }
+    else
+        lazy_updates++;
     //    this->features.row(features.rows()) = detection.feature;
     this->hits += 1;
     this->time_since_update = 0;
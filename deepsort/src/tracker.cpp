@@ -69,11 +69,27 @@ void tracker::update(const DETECTIONS & detections)
 }
 
 void tracker::update(const DETECTIONSV2 & detectionsv2)
+{
+    update(detectionsv2, vector<MATCH_DATA>());
+}
+
+void tracker::update(const DETECTIONSV2 & detectionsv2, const vector<MATCH_DATA> & direct)
 {
     const vector<CLSCONF>& clsConf = detectionsv2.first;
     const DETECTIONS& detections = detectionsv2.second;
+    vector<bool> track_taken(tracks.size(), false);
+    vector<bool> det_taken(detections.size(), false);
+    for (const MATCH_DATA & data:direct) {
+        tracks[data.first].update(this->kf, detections[data.second], clsConf[data.second]);
+        track_taken[data.first] = true;
+        det_taken[data.second] = true;
+    }
+    vector<int> detection_indices;
+    for (size_t i = 0; i < detections.size(); i++) {
+        if (!det_taken[i]) detection_indices.push_back(i);
+    }
     TRACHER_MATCHD res;
-    _match(detections, res);
+    _match(detections, res, detection_indices, track_taken);
     // std::cout << "checkpoint in overloaded sort\n";
 
     vector < MATCH_DATA > &matches = res.matches;
@@ -108,23 +124,45 @@ void tracker::update(const DETECTIONSV2 & detectionsv2)
 }
 
 void tracker::_match(const DETECTIONS & detections, TRACHER_MATCHD & res)
+{
+    vector < int >detection_indices;
+    for (size_t i = 0; i < detections.size(); i++) {
+        detection_indices.push_back(i);
+    }
+    _match(detections, res, detection_indices, vector<bool>(tracks.size(), false));
+}
+
+void tracker::_match(const DETECTIONS & detections, TRACHER_MATCHD & res,
+                     vector<int>& detection_indices, const vector<bool>& skip_tracks)
 {
     vector < int >confirmed_tracks;
     vector < int >unconfirmed_tracks;
     int idx = 0;
     for (Track & t:tracks) {
+        if (skip_tracks[idx]) {
+            idx++;
+            continue;
+        }
         if (t.is_confirmed()) confirmed_tracks.push_back(idx);
         else unconfirmed_tracks.push_back(idx);
         idx++;
     }
+    if (detection_indices.empty()) {
+        // 检测全部直接配上了
+        res.unmatched_tracks.assign(confirmed_tracks.begin(), confirmed_tracks.end());
+        res.unmatched_tracks.insert(res.unmatched_tracks.end(), unconfirmed_tracks.begin(), unconfirmed_tracks.end());
+        return;
+    }
 
-    TRACHER_MATCHD matcha = linear_assignment::getInstance()-> matching_cascade(
+    linear_assignment matcher;
+    TRACHER_MATCHD matcha = matcher.matching_cascade(
         this, &tracker::gated_matric,
         this->metric->mating_threshold,
         this->max_age,
         this->tracks,
         detections,
-        confirmed_tracks);
+        confirmed_tracks,
+        detection_indices);
     
 
     vector < int >iou_track_candidates;
@@ -139,7 +177,7 @@ void tracker::_match(const DETECTIONS & detections, TRACHER_MATCHD & res)
         }
         ++it;
     }
-    TRACHER_MATCHD matchb = linear_assignment::getInstance()->min_cost_matching(
+    TRACHER_MATCHD matchb = matcher.min_cost_matching(
         this, &tracker::iou_cost,
         this->max_iou_distance,
         this->tracks,
@@ -162,6 +200,57 @@ void tracker::_match(const DETECTIONS & detections, TRACHER_MATCHD & res)
         matchb.unmatched_detections.end());
 }
 
+/*
+    关联优先 (LAZY_REID): 算特征之前先用运动门控 + IoU 找没有竞争的配对, 这些检测不用算特征
+    确认轨迹上一帧刚更新过, 门控内只有这一个检测, 这个检测也只落在这一条轨迹 (含未确认/丢失的) 的门控内,
+    且与预测框的 IoU 不低于 LAZY_REID_IOU, 才直接配上; 连续 LAZY_REID_REFRESH 次后下一次照常算特征
+    其余检测 (门控内有竞争的、可能是新目标的) 放进 need_feature, 算完特征后照常级联匹配
+*/
+void tracker::match_unambiguous(const DETECTIONS & detections, vector<MATCH_DATA> & matches,
+                                vector<int> & need_feature)
+{
+    matches.clear();
+    need_feature.clear();
+    int nd = detections.size();
+    if (nd == 0) return;
+    std::vector<DETECTBOX> measurements;
+    for (const DETECTION_ROW & d:detections) {
+        measurements.push_back(d.to_xyah());
+    }
+    double threshold = MyKalmanFilter::chi2inv95[4];
+    vector<int> det_gated(nd, 0);           // 各检测落在几条轨迹的门控内
+    vector<int> only_det(tracks.size(), -1); // 门控内只有一个检测时为该检测
+    for (size_t t = 0; t < tracks.size(); t++) {
+        Eigen::Matrix<float, 1, -1> dist = kf->gating_distance(tracks[t].mean, tracks[t].covariance, measurements);
+        int n = 0;
+        for (int j = 0; j < nd; j++) {
+            if (dist(0, j) > threshold) continue;
+            det_gated[j]++;
+            only_det[t] = j;
+            n++;
+        }
+        if (n != 1) only_det[t] = -1;
+    }
+
+    vector<bool> matched(nd, false);
+    for (size_t t = 0; t < tracks.size(); t++) {
+        Track & track = tracks[t];
+        int d = only_det[t];
+        if (d < 0 || det_gated[d] != 1 || !track.is_confirmed() || track.time_since_update != 1 ||
+            track.lazy_updates >= LAZY_REID_REFRESH)
+            continue;
+        DETECTBOX box = track.to_tlwh();
+        DETECTBOXSS candidate(1, 4);
+        candidate.row(0) = detections[d].tlwh;
+        if (iou(box, candidate)(0) < LAZY_REID_IOU) continue;
+        matches.push_back(std::make_pair((int)t, d));
+        matched[d] = true;
+    }
+    for (int j = 0; j < nd; j++) {
+        if (!matched[j]) need_feature.push_back(j);
+    }
+}
+
 void tracker::_initiate_track(const DETECTION_ROW & detection)
 {
     KAL_DATA data = kf->initiate(detection.to_xyah());
@@ -199,7 +288,7 @@ DYNAMICM tracker::gated_matric(
         targets.push_back(tracks[i].track_id);
     }
     DYNAMICM cost_matrix = this->metric->distance(features, targets);
-    DYNAMICM res = linear_assignment::getInstance()->gate_cost_matrix(
+    DYNAMICM res = linear_assignment().gate_cost_matrix(
         this->kf, cost_matrix, tracks, dets, track_indices,
         detection_indices);
     return res;
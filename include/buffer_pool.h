@@ -0,0 +1,39 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 最后一个引用释放时自动回到池里
+typedef std::shared_ptr<uint8_t> pooled_buffer;
+
+/*
+    固定大小的内存块池, 帧间复用检测输入等大块内存
+    on_create: 新分配的块调用一次 (如填好 letterbox 边框), 回收再取出时不再调用
+    池先于 buffer 析构也安全, 剩下的 buffer 释放时直接 free
+*/
+class BufferPool {
+public:
+    BufferPool(size_t bytes, const std::function<void(uint8_t *)> &on_create = std::function<void(uint8_t *)>());
+    ~BufferPool();
+    pooled_buffer acquire();
+    size_t buffer_size() const { return bytes; }
+    int allocated() const;  // 一共分配过的块数
+
+private:
+    struct shared_state {
+        std::mutex mtx;
+        std::vector<uint8_t *> free_list;
+        int allocated = 0;
+        bool alive = true;
+    };
+    size_t bytes;
+    std::function<void(uint8_t *)> on_create;
+    std::shared_ptr<shared_state> state;
+};
+
+#endif // BUFFER_POOL_H
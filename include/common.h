@@ -6,6 +6,8 @@
 #include "box.h"
 #define BOX_H
 #endif // BOX_H
+#include "frame.h"
+#include "buffer_pool.h"
 
 #define BYTE unsigned char
 #define IMG_WIDTH 720
@@ -36,35 +38,87 @@
 #define nboxes_total nboxes_0+nboxes_1+nboxes_2
 
 
+/*
+    分块检测的一块: 原图的 region 区域 letterbox 到网络输入
+    tile / n_tiles: 在该帧所有块中的序号与块数, n_tiles 为 0 表示不分块
+*/
+struct tile_t {
+    image_rect region;
+    letterbox_t lb;
+    int tile;
+    int n_tiles;
+};
+
 struct input_image{
     input_image(){
-
+        tile.n_tiles = 0;
+        motion = true;
+        model = 0;
+        stream = 0;
     }
-    input_image(int num, cv::Mat img1, cv::Mat img2){
+    // lb: 整帧 -> 网络输入, 预处理和后处理还原共用
+    input_image(int num, const nv12_frame &img1, const letterbox_t &geometry, cv::Mat img2 = cv::Mat(),
+                pooled_buffer buf = pooled_buffer()){
         index = num;
         img_src = img1;
+        lb = geometry;
         img_pad = img2;
+        pad_buf = buf;
+        tile.n_tiles = 0;
+        motion = true;
+        model = 0;
+        stream = 0;
+    }
+    // 分块: 由检测线程自己把 tile.region 写进输入 tensor
+    input_image(int num, const nv12_frame &img1, const letterbox_t &geometry, const tile_t &t){
+        index = num;
+        img_src = img1;
+        lb = geometry;
+        tile = t;
+        motion = true;
+        model = 0;
+        stream = 0;
     }
     int index;
-    cv::Mat img_src;
-    cv::Mat img_pad;
+    nv12_frame img_src;     // 原图 NV12
+    letterbox_t lb;         // 整帧的 letterbox, 每个分辨率只算一次 (videoResize)
+    cv::Mat img_pad;        // 网络输入 RGB (分块或跳过检测时为空)
+    pooled_buffer pad_buf;  // img_pad 的内存, 用完回到池里
+    tile_t tile;
+    bool motion;            // 画面有变化 (见 MotionDetector), 为 false 时检测可以跳过
+    int model;              // 级联模式下用哪个检测模型 (见 cascade.h), 0 为完整模型
+    int stream;             // 多路时的路号 (见 multistream.h), 单路为 0
 };
 
 
+/*
+    跟随模式下被跟随轨迹的最新卡尔曼状态 (追踪线程写, videoResize 读, mtxFollow 保护)
+    frame: 状态对应的帧序号; cx, cy, w, h: 原图坐标; vx, vy: 每帧的速度
+    valid: 该帧轨迹已确认且刚被检测更新过
+*/
+struct follow_state {
+    int track_id;
+    int frame;
+    bool valid;
+    float cx, cy, w, h;
+    float vx, vy;
+};
+
 typedef struct _detect_result_group_t
 {
     int id;
     int count;
     std::vector<DetectBox> results;
+    bool skipped = false;  // 静止画面没跑检测, 追踪只做卡尔曼预测
 } detect_result_group_t;
 
 /*
     某一帧的所有合理预测结果 + 图片
-    img：     背景图
+    img：     背景图 (NV12)
     dets：    检测结果结构体数组
 */ 
 struct imageout_idx
 {
-	cv::Mat img; 
+	nv12_frame img;
 	detect_result_group_t dets;
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <memory>
+#include "opencv2/opencv.hpp"
+#include "image_processor.h"
+
+/*
+    NV12 帧, 从采集一直传到输出
+    data: (height * 3 / 2) x width 的 CV_8UC1, Y 平面后紧跟 UV 平面, 引用计数共享, 拷贝不复制像素
+    data 不是自己分配的内存 (缓冲池/映射的文件) 时由 owner 保持有效
+    需要 BGR/RGB 时再按需转换 (见 ImageProcessor)
+*/
+struct nv12_frame {
+    nv12_frame() : width(0), height(0), capture_ns(0), pts_ms(0) {}
+    nv12_frame(const cv::Mat &nv12)
+        : data(nv12), width(nv12.cols), height(nv12.rows * 2 / 3), capture_ns(0), pts_ms(0) {}
+    // 外部内存上的帧, 行跨度 stride, UV 平面紧跟 Y 平面
+    nv12_frame(uint8_t *p, int w, int h, int stride, std::shared_ptr<const void> keep)
+        : data(h * 3 / 2, w, CV_8UC1, p, stride), owner(keep), width(w), height(h), capture_ns(0), pts_ms(0) {}
+
+    bool empty() const { return data.empty(); }
+    int stride() const { return (int)data.step; }
+    const uint8_t *y() const { return data.data; }
+    const uint8_t *uv() const { return data.data + data.step * height; }
+    image_view view() const
+    {
+        image_view v = {data.data, data.data + data.step * height, width, height, (int)data.step, IMAGE_NV12};
+        return v;
+    }
+    // 整帧转 BGR (预览/编码)
+    void to_bgr(cv::Mat &bgr) const { cv::cvtColor(data, bgr, cv::COLOR_YUV2BGR_NV12); }
+
+    cv::Mat data;
+    std::shared_ptr<const void> owner;
+    int width;
+    int height;
+    double capture_ns;  // 进入流水线的时间 (what_time_is_it_now_ns)
+    double pts_ms;      // 媒体时间: 摄像头为距第一帧, 文件为播放位置, 图片序列/原始数据按帧率推算
+};
+
+#endif // FRAME_H
@@ -0,0 +1,42 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <string>
+
+#include "frame.h"
+#include "buffer_pool.h"
+
+/*
+    帧来源, 按 URI 选择 (open_frame_source):
+        camera:/dev/video-camera0?width=720&height=576&fps=15   V4L2 摄像头, GStreamer 直接出 NV12
+        gst:<pipeline>                                          自定义 GStreamer 管线, 以 appsink 结尾, 输出 NV12
+        file:data/test.mp4  或直接写路径                        视频文件, 有 GStreamer 时硬件解码到 NV12
+        images:data/seq?fps=25  或目录路径                      目录下按文件名排序的 jpg/png/bmp
+        raw:data/dump.nv12?size=1920x1080&format=nv12&fps=25    原始帧连续存放 (nv12 / rgb / bgr), 映射到内存读取
+        raw:data/rec.raw?rate=max                               tools/record_raw 录的文件 (见 raw_frames.h), 尺寸帧率在文件头
+            rate: 回放速度, max 为尽快 (默认), 数字为按该帧率放
+    非实时来源都可以加 start=N&frames=M, 只读第 N 帧起的 M 帧 (离线分段处理), 能定位的来源直接跳过去
+    帧的像素放在来源自己的缓冲池里 (原始 NV12 直接引用映射的文件), 带采集时间戳
+*/
+class FrameSource {
+public:
+    FrameSource() : frame_count(-1), fps(0), width(0), height(0), fourcc(0), live(false) {}
+    virtual ~FrameSource() {}
+    // 读下一帧, 结束或出错返回 false
+    virtual bool read(nv12_frame &frame) = 0;
+    virtual const char *name() const = 0;
+    // 下一次 read 从第 frame 帧开始, 不支持定位时返回 false
+    virtual bool seek(int frame) { return false; }
+
+    int frame_count;  // 总帧数, 摄像头为 -1
+    int fps;
+    int width;
+    int height;
+    double fourcc;    // 写结果视频时沿用
+    bool live;        // 实时来源 (camera: / gst:), 跟不上时可以丢帧; 文件等即使不知道总帧数也不丢
+};
+
+// 打不开返回 NULL
+FrameSource *open_frame_source(const std::string &uri);
+
+#endif // FRAME_SOURCE_H
@@ -0,0 +1,97 @@
+#ifndef IMAGE_PROCESSOR_H
+#define IMAGE_PROCESSOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#define LETTERBOX_PAD_VALUE 114  // letterbox 填充灰度
+
+/*
+    原图 -> 网络输入的几何关系
+    内容区域: 原图缩放到 resize_w x resize_h, 放在 (pad_left, pad_top)
+    net_x = src_x * scale_x + pad_left
+    net_y = src_y * scale_y + pad_top
+*/
+struct letterbox_t {
+    int src_w;
+    int src_h;
+    int dst_w;
+    int dst_h;
+    int resize_w;
+    int resize_h;
+    int pad_left;
+    int pad_top;
+    float scale_x;
+    float scale_y;
+};
+
+/*
+    keep_ratio: true 等比缩放 + 填充; false 直接拉伸到 dst_w x dst_h
+*/
+void letterbox_init(letterbox_t &lb, int src_w, int src_h, int dst_w, int dst_h, bool keep_ratio);
+
+enum image_format {
+    IMAGE_NV12 = 0,  // Y 平面 + 交织的 UV 平面
+    IMAGE_RGB888,
+    IMAGE_BGR888,
+};
+
+/*
+    不拥有内存的图像描述
+    data:   首行地址 (NV12 为 Y 平面)
+    uv:     NV12 的 UV 平面, 其余格式不用
+    stride: 每行字节数 (NV12 两个平面相同)
+*/
+struct image_view {
+    uint8_t *data;
+    uint8_t *uv;
+    int width;
+    int height;
+    int stride;
+    image_format format;
+};
+
+struct image_rect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// 连续存放的图像 (stride 为最小值, NV12 的 UV 紧跟 Y)
+image_view make_image_view(uint8_t *data, int width, int height, image_format format);
+
+/*
+    图像处理接口: 缩放 / 裁剪 / 颜色转换 / letterbox
+    CPU 后端: 双线性, NEON/SSE2/标量, 任何 Linux 主机可用
+    RGA 后端: RK 硬件, 仅在有 /dev/rga 的板子上
+    process 可在多个线程里同时调用
+*/
+class ImageProcessor {
+public:
+    virtual ~ImageProcessor() {}
+    virtual const char *name() const = 0;
+    /*
+        src 的 src_rect 区域双线性缩放到 dst 的 dst_rect 区域, 格式不同时同时转换
+        支持 NV12 -> RGB/BGR, RGB/BGR -> RGB/BGR; NV12 的 src_rect 起点向下取偶数
+        返回 0 成功
+    */
+    virtual int process(const image_view &src, const image_rect &src_rect,
+                        const image_view &dst, const image_rect &dst_rect) = 0;
+
+    int resize(const image_view &src, const image_view &dst);
+    int crop(const image_view &src, const image_rect &rect, const image_view &dst);
+    int cvt_color(const image_view &src, const image_view &dst);
+    // 只写内容区域, 填充区域见 fill_letterbox_pad
+    int letterbox(const image_view &src, const image_view &dst, const letterbox_t &lb);
+};
+
+void fill_letterbox_pad(const image_view &dst, const letterbox_t &lb, uint8_t value = LETTERBOX_PAD_VALUE);
+
+/*
+    backend: "cpu" / "rga" / "auto" (有 RGA 用 RGA, 否则 CPU)
+    要求的 RGA 不可用时退回 CPU
+*/
+ImageProcessor *create_image_processor(const char *backend);
+
+#endif // IMAGE_PROCESSOR_H
@@ -0,0 +1,60 @@
+#ifndef MJPEG_SERVER_H
+#define MJPEG_SERVER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define MJPEG_MAX_CLIENTS   8
+#define MJPEG_SEND_TIMEOUT  2     // s, 一帧这么久发不出去就断开该客户端
+#define MJPEG_SNDBUF        65536 // 发送缓冲限小, 慢客户端很快表现为 send 阻塞, 从而跳帧而不是在内核里积压
+
+typedef std::shared_ptr<const std::vector<uint8_t> > jpeg_buffer;
+
+/*
+    MJPEG over HTTP 预览, 只用 socket, 每个客户端一个线程
+        /           带 <img> 的页面
+        /stream     multipart/x-mixed-replace 的 MJPEG 流
+        /snapshot   最新一帧 JPEG
+    例: curl -s http://<ip>:<port>/snapshot -o a.jpg; curl -sN http://<ip>:<port>/stream | head -c 1000000 > s.mjpeg
+    publish 只换掉最新帧的指针 (同一份编码给所有客户端), 不等客户端;
+    客户端线程每次发最新的一帧, 慢的客户端中间的帧自然跳过, 不会拖住其他客户端和发布方
+*/
+class MjpegServer {
+public:
+    MjpegServer() : frames_sent(0), frames_skipped(0), listen_fd(-1), running(false), seq(0), n_clients(0), n_viewers(0) {}
+    ~MjpegServer() { stop(); }
+    // bind_addr: "0.0.0.0" 局域网 / "127.0.0.1" 本机
+    bool start(const char *bind_addr, int port);
+    void stop();
+    void publish(jpeg_buffer jpeg);
+    // 有客户端在看流 (或等着取快照) 时才需要编码; 只连着没请求、取页面的不算
+    bool has_clients() const { return n_viewers > 0; }
+
+    std::atomic<long> frames_sent;     // 所有客户端合计发出的帧
+    std::atomic<long> frames_skipped;  // 客户端太慢没发的帧
+
+private:
+    void accept_loop();
+    void serve(int fd);
+    // 等比 last 新的帧, 服务停止时返回空
+    jpeg_buffer wait_frame(uint64_t &last);
+
+    int listen_fd;
+    std::atomic<bool> running;
+    std::thread acceptor;
+    std::mutex mtx;
+    std::condition_variable cv;
+    jpeg_buffer latest;
+    uint64_t seq;             // latest 的序号
+    std::atomic<int> n_clients;
+    std::atomic<int> n_viewers;  // 订阅 /stream 和等待 /snapshot 的客户端
+    std::set<int> client_fds;  // stop 时 shutdown, 叫醒阻塞在 send 上的线程
+};
+
+#endif // MJPEG_SERVER_H
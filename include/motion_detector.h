@@ -0,0 +1,33 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "frame.h"
+
+#define MOTION_BLOCK        8      // Y 平面 8x8 块取平均为一个格子
+#define MOTION_BG_SHIFT     4      // 背景滑动平均, 每帧更新 1/16
+#define MOTION_CELL_THRESH  12     // 格子亮度与背景相差超过该值算变化
+#define MOTION_RATIO_THRESH 0.002  // 变化格子的比例超过该值算有运动
+#define MOTION_REFRESH      30     // 连续这么多帧静止时仍检测一次, 防止漏掉很慢的目标
+#define MOTION_TRACK_SPEED  0.5    // 确认轨迹的速度 (像素/帧) 超过该值算在动
+
+/*
+    运动检测: NV12 的 Y 平面缩小 MOTION_BLOCK 倍后与滑动平均的背景比较
+    只看亮度, 一帧 720x576 约 6500 个格子, 主要开销是缩小 (SIMD)
+*/
+class MotionDetector {
+public:
+    MotionDetector() : grid_w(0), grid_h(0) {}
+    // 返回变化格子的比例并更新背景; 第一帧或分辨率变化时返回 1
+    float update(const nv12_frame &frame);
+
+private:
+    std::vector<uint16_t> cells;       // 当前帧格子的 8x8 和
+    std::vector<uint16_t> background;  // 背景亮度 Q8
+    int grid_w;
+    int grid_h;
+};
+
+#endif // MOTION_DETECTOR_H
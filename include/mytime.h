@@ -1,4 +1,6 @@
 #include <unistd.h>
 #include <sys/time.h>
 
-double what_time_is_it_now();
\ No newline at end of file
+double what_time_is_it_now();
+// 单位: ns, 单调时钟, 用于统计短耗时
+double what_time_is_it_now_ns();
@@ -0,0 +1,58 @@
+#ifndef RAW_FRAMES_H
+#define RAW_FRAMES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "frame.h"
+
+/*
+    原始帧录像文件 (tools/record_raw 写, raw: 来源映射回放)
+        [raw_file_header, 补齐到 header_bytes]
+        [帧 0: raw_frame_header + NV12 (Y 行跨度 stride, UV 紧跟 Y), 补齐到 frame_bytes]
+        [帧 1] ...
+    帧大小固定, 第 n 帧在 header_bytes + n * frame_bytes, 都按页对齐, 映射后直接引用不拷贝
+*/
+#define RAW_MAGIC          "NV12RAW"
+#define RAW_VERSION        1
+#define RAW_PAGE           4096
+#define RAW_STRIDE_ALIGN   64
+#define RAW_FRAME_HEADER   64   // 帧头占用, Y 平面从这里开始, 保持 64 字节对齐
+
+struct raw_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;        // Y/UV 行跨度
+    uint32_t header_bytes;  // 第一帧的偏移
+    uint32_t frame_bytes;   // 每帧占用 (含帧头)
+    uint32_t fps;           // 录制时的帧率
+    uint32_t reserved;
+    uint64_t frame_count;   // 录制结束时写入
+};
+
+struct raw_frame_header {
+    uint64_t index;
+    double pts_ms;
+    double capture_ns;
+};
+
+// 逐帧追加写, close 时补写帧数
+class RawFrameWriter {
+public:
+    RawFrameWriter() : fp(NULL) {}
+    ~RawFrameWriter() { close(); }
+    bool open(const char *path, int width, int height, int fps);
+    bool write(const nv12_frame &frame);
+    void close();
+    uint64_t frames() const { return header.frame_count; }
+
+private:
+    FILE *fp;
+    raw_file_header header;
+    std::vector<uint8_t> slot;  // 一帧的写缓冲, 补齐部分保持为 0
+};
+
+#endif // RAW_FRAMES_H
@@ -1,8 +1,13 @@
 #ifndef RKNN_FP
 #define RKNN_FP
 
+#include <vector>
+#include <utility>
+
 #include "rknn_api.h"
 
+#define RKNN_MAX_OUTPUT 12  // yolov8 多头输出最多 4*3 个
+
 class rknn_fp{
 public:
     /*
@@ -14,19 +19,44 @@ public:
     rknn_fp(const char *, int, rknn_core_mask, int, int);
     ~rknn_fp(void);
     void dump_tensor_attr(rknn_tensor_attr*);
+    // data 为紧密排列的 batch * h * w * c 输入, 可以直接是 input_buffer()
     int inference(unsigned char *);
+    /*
+        紧密排列 (行距 w * c) 的输入, 调用者都按这个写
+        NPU 要求行对齐 (w_stride != w) 时为暂存区, inference 按 w_stride 逐行拷进输入 tensor; 否则就是输入 tensor
+    */
+    unsigned char *input_buffer() { return _input_packed.empty() ? (unsigned char *)_input_mems[0]->virt_addr : _input_packed.data(); }
+    int input_h() const { return _input_attrs[0].dims[1]; }
+    int input_w() const { return _input_attrs[0].dims[2]; }
+    // 模型导出时的 batch (输入 dims[0]), 一次推理处理这么多张输入
+    int batch() const { return _input_attrs[0].dims[0] > 1 ? _input_attrs[0].dims[0] : 1; }
+    // batch 里第 b 张的输入 / 第 i 个输出 (各张按 batch 维连续存放, 输出为 int8)
+    unsigned char *input_buffer(int b) { return input_buffer() + (size_t)b * input_h() * input_w() * _input_attrs[0].dims[3]; }
+    void *output_buffer(int i, int b) { return (int8_t *)_output_buff[i] + (size_t)b * (_output_attrs[i].n_elems / batch()); }
+    /*
+        切换输入尺寸, 只对动态形状模型有效 (尺寸须在 input_sizes 里)
+        同时更新当前形状下的输入/输出属性, 返回 0 成功
+    */
+    int set_input_size(int h, int w);
     float cal_NPU_performance(std::queue<float> &, float &, float);
 public:
     int _cpu_id;
+    rknn_core_mask _core_mask;
     int _n_input;
     int _n_output;
     //Inputs and Output sets
     rknn_context ctx;
     rknn_tensor_attr _input_attrs[1];
-    rknn_tensor_attr _output_attrs[3];
+    rknn_tensor_attr _output_attrs[RKNN_MAX_OUTPUT];
     rknn_tensor_mem* _input_mems[1];
-    rknn_tensor_mem* _output_mems[3];
-    void* _output_buff[3];
+    rknn_tensor_mem* _output_mems[RKNN_MAX_OUTPUT];
+    void* _output_buff[RKNN_MAX_OUTPUT];
+    std::vector<std::pair<int, int> > input_sizes;  // 动态形状模型支持的输入 (h, w), 普通模型为空
+
+private:
+    // 按当前输入属性决定要不要紧密排列的暂存区
+    void update_input_layout();
+    std::vector<unsigned char> _input_packed;
 };
 
 #endif
\ No newline at end of file
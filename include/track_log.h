@@ -0,0 +1,132 @@
+#ifndef TRACK_LOG_H
+#define TRACK_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/*
+    追踪结果日志, 只追加写 (TrackLogWriter), 映射读 (TrackLogReader, tools/track_log)
+        [track_log_header]
+        [帧块: track_frame_header + count 条 track_record] ...
+        [索引块: track_index_header + count 条 track_index_entry, 指向前面 TRACKLOG_INDEX_INTERVAL 个帧块] ...
+        [track_log_trailer, close 时写入, 指向最后一个索引块]
+    索引块从后往前用 prev 串起来, 读取时只走索引链, 不扫帧块; 没有结尾 (写入时中断) 时顺序扫一遍帧块头重建
+    时间为帧的媒体时间 (nv12_frame::pts_ms), 同一日志内单调不减
+*/
+#define TRACKLOG_MAGIC           "TRKLOG1"
+#define TRACKLOG_VERSION         1
+#define TRACKLOG_INDEX_INTERVAL  256         // 每这么多帧写一个索引块并刷到文件
+#define TRACKLOG_FRAME_TAG       0x454d5246  // "FRME"
+#define TRACKLOG_INDEX_TAG       0x58444e49  // "INDX"
+#define TRACKLOG_END_TAG         0x21444e45  // "END!"
+
+struct track_log_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;     // sizeof(track_record), 读取时校验
+    uint32_t index_interval;
+    uint32_t reserved;
+    double created_ms;         // 开始写的时间 (what_time_is_it_now)
+};
+
+struct track_frame_header {
+    uint32_t tag;              // TRACKLOG_FRAME_TAG
+    uint32_t count;            // 本帧的轨迹条数
+    int64_t frame;             // 帧序号
+    double pts_ms;             // 帧的媒体时间
+};
+
+// 24 字节, 原图坐标
+struct track_record {
+    int32_t track_id;
+    int16_t class_id;
+    uint16_t confidence;       // 置信度 * 65535
+    float x1, y1, x2, y2;
+};
+
+struct track_index_header {
+    uint32_t tag;              // TRACKLOG_INDEX_TAG
+    uint32_t count;
+    uint64_t prev;             // 上一个索引块的偏移, 0 为没有
+};
+
+struct track_index_entry {
+    int64_t frame;
+    double pts_ms;
+    uint64_t offset;           // 帧块的偏移
+};
+
+struct track_log_trailer {
+    uint32_t tag;              // TRACKLOG_END_TAG
+    uint32_t reserved;
+    uint64_t last_index;       // 最后一个索引块的偏移, 0 为没有
+};
+
+class TrackLogWriter {
+public:
+    TrackLogWriter() : fp(NULL), offset(0), last_index(0), frames(0), records(0) {}
+    ~TrackLogWriter() { close(); }
+    bool open(const char *path);
+    // 追加一帧, records 可以为空 (该帧没有轨迹, 仍记下帧号和时间)
+    bool write(int64_t frame, double pts_ms, const track_record *records, int count);
+    // 写最后的索引块和结尾
+    void close();
+    uint64_t frame_count() const { return frames; }
+    uint64_t record_count() const { return records; }
+
+private:
+    bool flush_index();
+    FILE *fp;
+    uint64_t offset;                         // 下一块的偏移
+    uint64_t last_index;
+    uint64_t frames;
+    uint64_t records;
+    std::vector<track_index_entry> pending;  // 还没写进索引块的帧
+};
+
+/*
+    映射整个文件, 帧块里的记录直接指向映射区
+    用法: open -> seek(t0) -> while (next(f) && f.pts_ms <= t1) ...
+*/
+class TrackLogReader {
+public:
+    struct frame_view {
+        int64_t frame;
+        double pts_ms;
+        int count;
+        const track_record *records;
+    };
+
+    TrackLogReader() : map(NULL), map_len(0), end(0), pos(0), recovered(false) {}
+    ~TrackLogReader() { close(); }
+    bool open(const char *path);
+    void close();
+    // 定位到第一个 pts_ms >= t_ms 的帧
+    void seek(double t_ms);
+    void rewind() { pos = sizeof(track_log_header); }
+    bool next(frame_view &f);
+
+    size_t index_size() const { return index.size(); }
+    // 索引里的帧数 (与帧块数相同), 没有帧时为 0
+    uint64_t frame_count() const { return index.size(); }
+    double first_ms() const { return index.empty() ? 0 : index.front().pts_ms; }
+    double last_ms() const { return index.empty() ? 0 : index.back().pts_ms; }
+    size_t file_bytes() const { return map_len; }
+    // 没有结尾, 索引是顺序扫描重建的
+    bool was_recovered() const { return recovered; }
+    const track_log_header &header() const { return *(const track_log_header *)map; }
+
+private:
+    bool load_index(uint64_t last_index);
+    void scan_index();
+    const uint8_t *map;
+    size_t map_len;
+    uint64_t end;      // 帧块/索引块的结束位置 (不含结尾)
+    uint64_t pos;
+    bool recovered;
+    std::vector<track_index_entry> index;  // 每帧一条, 按时间排序
+};
+
+#endif // TRACK_LOG_H
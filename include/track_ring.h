@@ -0,0 +1,130 @@
+#ifndef TRACK_RING_H
+#define TRACK_RING_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "track_log.h"
+
+/*
+    追踪结果放在 POSIX 共享内存里的环形缓冲, 一个写者 (本程序) 多个读者 (规划/记录等本机进程)
+        [track_ring_header] [slot 0] [slot 1] ... [slot slots-1]
+    每个 slot 一帧: track_ring_slot + max_records 条 track_record (格式同 track_log.h)
+    写者从不等读者: 第 n 帧写进 slot n % slots, 用 seqlock 保护 (写前 seq 变奇数, 写完变偶数),
+    读者读前后 seq 相同且为偶数、slot 的 index 还是要的那一帧, 才算读到完整的一帧, 否则被覆盖了, 重读最新的
+    读者可以轮询 head, 也可以在 futex 上等新帧 (写者只在有人等时才 FUTEX_WAKE); 数据不经过 socket, 不拷贝
+    写者重启时 generation 改变, head 从 0 重新计, 读者据此重新同步; 大小不同时写者换一个新的共享内存对象, 不在原对象上改大小
+*/
+#define TRACKRING_MAGIC        "TRKRING"
+#define TRACKRING_VERSION      1
+#define TRACKRING_NAME         "/yolov5_deepsort_tracks"  // shm_open 的名字, 在 /dev/shm 下
+#define TRACKRING_SLOTS        64                          // 约 2 s @30fps, 读者落后更多时只能跳到最新
+#define TRACKRING_MAX_RECORDS  256                         // 每帧最多这么多条, 多的截掉 (truncated 计数)
+
+struct track_ring_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;               // sizeof(track_record), 读者校验
+    uint32_t slots;
+    uint32_t max_records;
+    uint32_t slot_bytes;                 // 每个 slot 的字节数, 含记录
+    uint32_t writer_pid;
+    double generation;                   // 写者打开的时间 (what_time_is_it_now), 重启后改变
+    std::atomic<uint64_t> head;          // 已写完的帧数, 最新一帧为 head - 1
+    std::atomic<uint32_t> futex;         // 每写完一帧加 1, 读者在上面 FUTEX_WAIT
+    std::atomic<uint32_t> waiters;       // 正在等的读者数, 为 0 时写者不做 FUTEX_WAKE 系统调用
+    std::atomic<uint32_t> closed;        // 写者正常退出
+    uint32_t reserved;
+};
+
+struct track_ring_slot {
+    std::atomic<uint32_t> seq;           // 奇数为正在写
+    uint32_t count;
+    uint64_t index;                      // 环里的帧序号 (第几次写)
+    int64_t frame;                       // 帧序号
+    double pts_ms;                       // 帧的媒体时间
+    uint32_t truncated;                  // 超出 max_records 没放下的条数
+    uint32_t reserved;
+    // 后面紧跟 max_records 条 track_record
+};
+
+class TrackRingWriter {
+public:
+    TrackRingWriter() : hdr(NULL), map_len(0), truncated(0) {}
+    ~TrackRingWriter() { close(); }
+    bool open(const char *name = TRACKRING_NAME, int slots = TRACKRING_SLOTS, int max_records = TRACKRING_MAX_RECORDS);
+    // 写一帧并叫醒等着的读者, 不阻塞
+    void write(int64_t frame, double pts_ms, const track_record *records, int count);
+    // 标记结束并叫醒读者; 不删共享内存, 读者读完最后几帧后自己退出
+    void close();
+    uint64_t frame_count() const { return hdr != NULL ? hdr->head.load() : 0; }
+    uint64_t truncated_records() const { return truncated; }
+
+private:
+    track_ring_slot *slot(uint64_t index);
+    track_ring_header *hdr;
+    size_t map_len;
+    uint64_t truncated;
+};
+
+/*
+    读者, 映射同一块共享内存, 只改头里的 waiters
+    轮询: while (...) { uint64_t h = reader.head(); if (h > last) { reader.read(h - 1, f); last = h; } }
+    等待: uint64_t next = reader.head(); while (reader.wait(next, 1000) >= 0) { while (reader.read(next, f)) next++; ... }
+    read 把记录拷到 f 里 (每帧几 KB 以内); visit 直接在共享内存上回调, 回调里的数据要等 visit 返回 true 才可信
+*/
+class TrackRingReader {
+public:
+    struct frame_data {
+        uint64_t index;
+        int64_t frame;
+        double pts_ms;
+        uint32_t truncated;
+        std::vector<track_record> records;
+    };
+
+    TrackRingReader() : hdr(NULL), map_len(0), generation(0), slots(0), slot_size(0), max_records(0) {}
+    ~TrackRingReader() { close(); }
+    // 写者还没建好时返回 false, 可以过一会儿重试
+    bool open(const char *name = TRACKRING_NAME);
+    void close();
+    // 已写完的帧数
+    uint64_t head() const { return hdr->head.load(std::memory_order_acquire); }
+    // 读环里第 index 帧; 还没写到或已被覆盖返回 false (覆盖时 index < head() - slots)
+    bool read(uint64_t index, frame_data &f) const;
+    // 等到 head() > index 或超时; 返回 1 有新帧, 0 超时, -1 写者已结束且没有更多帧
+    int wait(uint64_t index, int timeout_ms) const;
+    // 写者重启过或环的布局变了 (重新 open 后继续读, open 会按新的大小重新校验)
+    bool writer_restarted() const;
+    bool writer_closed() const { return hdr->closed.load(std::memory_order_acquire) != 0; }
+    const track_ring_header &header() const { return *hdr; }
+    // 打开时的槽数, 判断落后多少用这个
+    uint32_t slot_count() const { return slots; }
+
+    // fn(const track_ring_slot &, const track_record *records, int count), 读到完整的一帧返回 true
+    template <typename F> bool visit(uint64_t index, F fn) const
+    {
+        const track_ring_slot *s = slot(index);
+        uint32_t seq = s->seq.load(std::memory_order_acquire);
+        if ((seq & 1) || s->index != index || index >= head())
+            return false;
+        // 写者正在改时 count 可能是半截的, 先限在 max_records 内, 结果由下面的 seq 判废
+        fn(*s, (const track_record *)(s + 1), (int)std::min(s->count, max_records));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s->seq.load(std::memory_order_relaxed) == seq;
+    }
+
+private:
+    const track_ring_slot *slot(uint64_t index) const;
+    track_ring_header *hdr;
+    size_t map_len;
+    double generation;
+    uint32_t slots;
+    uint32_t slot_size;
+    uint32_t max_records;
+};
+
+#endif // TRACK_RING_H
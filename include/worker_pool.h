@@ -0,0 +1,38 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    常驻线程池, 用于把一帧内的小任务 (如 Re-ID 裁剪) 分到多个核上
+    parallel_for 由一个线程调用; 调用线程同样参与计算, 返回时所有任务已完成
+*/
+class WorkerPool {
+public:
+    // cpus 非空时 worker 依次绑定到这些核
+    WorkerPool(int n_threads, const std::vector<int> &cpus = std::vector<int>());
+    ~WorkerPool();
+    void parallel_for(int n, const std::function<void(int)> &fn);
+    int size() const { return threads.size() + 1; }
+
+private:
+    void worker(int cpuid);
+
+    std::vector<std::thread> threads;
+    std::mutex mtx;
+    std::condition_variable cv_task;
+    std::condition_variable cv_done;
+    const std::function<void(int)> *task;
+    std::atomic<int> next;
+    int total;
+    int pending;          // 还没做完本轮的 worker 数
+    unsigned generation;  // 每次 parallel_for 加一
+    bool stop;
+};
+
+#endif // WORKER_POOL_H
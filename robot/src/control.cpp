@@ -7,13 +7,16 @@
 #include "chassis.h"
 
 #include <mutex>
+#include <atomic>
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
 #include <sys/ioctl.h>
 
 extern std::mutex mtxQueueOutput;
 extern std::queue<imageout_idx> queueOutput; // output queue 目标追踪输出队列
+extern std::mutex mtxResult;
 extern detect_result_group_t result;
+extern std::atomic<int> followTrackID;  // 通知检测/追踪线程跟随的目标
 int i2c_file;
 
 Motor CMFL(&i2c_file, 0);
@@ -44,8 +47,15 @@ int deadBand(int val, const int& min, const int& max) {
 void controlLoop() {
     static int id = -1;
     if (id != -1) {
-        if (result.count != 0) {
-            for (auto det_result: result.results) {
+        // videoWrite 在 mtxResult 下整体替换 result, 拷一份再用, 同时标记已处理
+        detect_result_group_t latest;
+        {
+            std::lock_guard<std::mutex> lock(mtxResult);
+            latest = result;
+            result.count = 0;
+        }
+        if (latest.count != 0) {
+            for (auto det_result: latest.results) {
                 if (det_result.trackID == id) {
                     int x = (det_result.x1 + det_result.x2) / 2 - NET_INPUTWIDTH / 2;
                     int y = (det_result.y1 + det_result.y2) / 2 - NET_INPUTHEIGHT / 2;
@@ -64,11 +74,11 @@ void controlLoop() {
                 chassis.follow(0, 0);
             }
             chassis.handle();
-            result.count = 0;
         }
     } else {
         std::cout << "Enter an id" << std::endl;
         std::cin >> id;
+        followTrackID = id;
     }
 }
 
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "buffer_pool.h"
+
+BufferPool::BufferPool(size_t bytes, const std::function<void(uint8_t *)> &on_create)
+    : bytes(bytes), on_create(on_create), state(new shared_state())
+{
+}
+
+BufferPool::~BufferPool()
+{
+    std::lock_guard<std::mutex> lock(state->mtx);
+    state->alive = false;
+    for (uint8_t *p : state->free_list)
+        free(p);
+    state->free_list.clear();
+}
+
+pooled_buffer BufferPool::acquire()
+{
+    uint8_t *p = NULL;
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        if (!state->free_list.empty()) {
+            p = state->free_list.back();
+            state->free_list.pop_back();
+        }
+    }
+    if (p == NULL) {
+        // 64 字节对齐, 方便 SIMD 和 RGA
+        if (posix_memalign((void **)&p, 64, bytes) != 0) {
+            printf("BufferPool: alloc %zu bytes fail!\n", bytes);
+            exit(-1);
+        }
+        if (on_create)
+            on_create(p);
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->allocated++;
+    }
+    std::shared_ptr<shared_state> st = state;
+    return pooled_buffer(p, [st](uint8_t *buf) {
+        std::lock_guard<std::mutex> lock(st->mtx);
+        if (st->alive)
+            st->free_list.push_back(buf);
+        else
+            free(buf);
+    });
+}
+
+int BufferPool::allocated() const
+{
+    std::lock_guard<std::mutex> lock(state->mtx);
+    return state->allocated;
+}
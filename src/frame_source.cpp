@@ -0,0 +1,517 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "frame_source.h"
+#include "raw_frames.h"
+#include "mytime.h"
+
+// scheme:path?key=value&key=value
+struct source_uri {
+    std::string scheme;
+    std::string path;
+    std::map<std::string, std::string> params;
+
+    int get_int(const char *key, int def) const
+    {
+        std::map<std::string, std::string>::const_iterator it = params.find(key);
+        return it == params.end() ? def : atoi(it->second.c_str());
+    }
+    std::string get(const char *key, const char *def) const
+    {
+        std::map<std::string, std::string>::const_iterator it = params.find(key);
+        return it == params.end() ? def : it->second;
+    }
+};
+
+static bool has_suffix(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && !strcasecmp(s.c_str() + s.size() - n, suffix);
+}
+
+static source_uri parse_uri(const std::string &uri)
+{
+    source_uri u;
+    size_t colon = uri.find(':');
+    std::string rest = uri;
+    if (colon != std::string::npos && colon > 1 && uri.find('/') > colon) {
+        u.scheme = uri.substr(0, colon);
+        rest = uri.substr(colon + 1);
+    }
+    // gst 管线里可能有 '?', 整串都是管线
+    size_t q = u.scheme == "gst" ? std::string::npos : rest.find('?');
+    u.path = rest.substr(0, q);
+    if (q != std::string::npos) {
+        std::string query = rest.substr(q + 1);
+        size_t begin = 0;
+        while (begin < query.size()) {
+            size_t end = query.find('&', begin);
+            if (end == std::string::npos)
+                end = query.size();
+            std::string kv = query.substr(begin, end - begin);
+            size_t eq = kv.find('=');
+            if (eq != std::string::npos)
+                u.params[kv.substr(0, eq)] = kv.substr(eq + 1);
+            begin = end + 1;
+        }
+    }
+    if (u.scheme.empty()) {
+        // 没写 scheme 时按路径猜
+        struct stat st;
+        if (stat(u.path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            u.scheme = "images";
+        else if (has_suffix(u.path, ".nv12") || has_suffix(u.path, ".yuv") || has_suffix(u.path, ".rgb")
+                 || has_suffix(u.path, ".raw"))
+            u.scheme = "raw";
+        else
+            u.scheme = "file";
+    }
+    return u;
+}
+
+// BGR/RGB (code 为对应的 COLOR_*2YUV_I420) 转成紧凑的 NV12; OpenCV 只有 I420, 再交织 UV
+static void to_nv12(const cv::Mat &src, int code, uint8_t *dst, cv::Mat &i420)
+{
+    int w = src.cols, h = src.rows;
+    cv::cvtColor(src, i420, code);
+    memcpy(dst, i420.data, (size_t)w * h);
+    const uint8_t *u = i420.data + (size_t)w * h;
+    const uint8_t *v = u + (size_t)(w / 2) * (h / 2);
+    uint8_t *uv = dst + (size_t)w * h;
+    for (int i = 0; i < (w / 2) * (h / 2); i++) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+}
+
+// 来源共用: 按分辨率建的帧缓冲池
+class PooledSource : public FrameSource {
+public:
+    PooledSource() : pool(NULL) {}
+    ~PooledSource() { delete pool; }
+
+protected:
+    pooled_buffer acquire(int w, int h)
+    {
+        if (pool == NULL || pool->buffer_size() != (size_t)w * h * 3 / 2) {
+            delete pool;
+            pool = new BufferPool((size_t)w * h * 3 / 2);
+        }
+        return pool->acquire();
+    }
+    BufferPool *pool;
+    cv::Mat i420;  // 颜色转换的中间结果, 复用
+};
+
+/*
+    cv::VideoCapture: 摄像头 / 自定义管线 / 视频文件
+    nv12: 管线直接输出 NV12 ((h * 3 / 2) x w 单通道), 否则输出 BGR 再转换
+*/
+class CaptureSource : public PooledSource {
+public:
+    CaptureSource(const char *kind, bool live) : kind(kind), nv12(false), first_ns(0) { this->live = live; }
+
+    bool open_gst(const std::string &pipeline)
+    {
+        if (!cap.open(pipeline, cv::CAP_GSTREAMER))
+            return false;
+        nv12 = true;
+        query();
+        return true;
+    }
+    bool open_any(const std::string &path)
+    {
+        if (!cap.open(path))
+            return false;
+        nv12 = false;
+        query();
+        return true;
+    }
+    const char *name() const { return kind; }
+    bool seek(int frame)
+    {
+        // GStreamer 的 appsink 多半不支持, 由调用方读掉前面的帧
+        if (live)
+            return false;
+        if (cap.set(cv::CAP_PROP_POS_FRAMES, frame) && (int)cap.get(cv::CAP_PROP_POS_FRAMES) == frame)
+            return true;
+        // 按帧号定位不了的, 按时间定位, 落在目标帧半帧以内都算
+        if (fps <= 0)
+            return false;
+        double target = frame * 1000.0 / fps;
+        return cap.set(cv::CAP_PROP_POS_MSEC, target) && fabs(cap.get(cv::CAP_PROP_POS_MSEC) - target) <= 500.0 / fps;
+    }
+
+    bool read(nv12_frame &frame)
+    {
+        double now = what_time_is_it_now_ns();
+        if (nv12) {
+            // 尺寸已知时直接读进池里的缓冲, OpenCV 尺寸相同时不会重新分配
+            pooled_buffer buf;
+            cv::Mat m;
+            if (width > 0 && height > 0) {
+                buf = acquire(width, height);
+                m = cv::Mat(height * 3 / 2, width, CV_8UC1, buf.get());
+            }
+            if (!cap.read(m))
+                return false;
+            if (buf && m.data == buf.get()) {
+                frame = nv12_frame(buf.get(), width, height, width, buf);
+            }
+            else {
+                frame = nv12_frame(m);
+                width = frame.width;
+                height = frame.height;
+            }
+        }
+        else {
+            if (!cap.read(bgr))
+                return false;
+            int w = bgr.cols & ~1, h = bgr.rows & ~1;
+            pooled_buffer buf = acquire(w, h);
+            to_nv12(bgr(cv::Rect(0, 0, w, h)), cv::COLOR_BGR2YUV_I420, buf.get(), i420);
+            frame = nv12_frame(buf.get(), w, h, w, buf);
+            width = w;
+            height = h;
+        }
+        frame.capture_ns = now;
+        if (first_ns == 0)
+            first_ns = now;
+        frame.pts_ms = live ? (now - first_ns) / 1e6 : cap.get(cv::CAP_PROP_POS_MSEC);
+        return true;
+    }
+
+private:
+    void query()
+    {
+        frame_count = live ? -1 : (int)cap.get(cv::CAP_PROP_FRAME_COUNT);
+        fps = (int)cap.get(cv::CAP_PROP_FPS);
+        width = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH) & ~1;
+        height = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT) & ~1;
+        fourcc = cap.get(cv::CAP_PROP_FOURCC);
+    }
+
+    const char *kind;
+    bool nv12;
+    double first_ns;
+    cv::VideoCapture cap;
+    cv::Mat bgr;
+};
+
+// 目录下按文件名排序的图片
+class ImageSequenceSource : public PooledSource {
+public:
+    bool open(const std::string &dir, int fps_)
+    {
+        DIR *d = opendir(dir.c_str());
+        if (d == NULL)
+            return false;
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            std::string n = e->d_name;
+            if (has_suffix(n, ".jpg") || has_suffix(n, ".jpeg") || has_suffix(n, ".png") || has_suffix(n, ".bmp"))
+                files.push_back(dir + "/" + n);
+        }
+        closedir(d);
+        std::sort(files.begin(), files.end());
+        if (files.empty())
+            return false;
+        next = 0;
+        fps = fps_;
+        frame_count = files.size();
+        cv::Mat first = cv::imread(files[0], cv::IMREAD_COLOR);
+        width = first.cols & ~1;
+        height = first.rows & ~1;
+        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+        return true;
+    }
+    const char *name() const { return "images"; }
+    bool seek(int frame)
+    {
+        next = frame;
+        return true;
+    }
+
+    bool read(nv12_frame &frame)
+    {
+        while (next < files.size()) {
+            cv::Mat bgr = cv::imread(files[next], cv::IMREAD_COLOR);
+            int index = next++;
+            if (bgr.empty()) {
+                printf("skip unreadable image %s\n", files[index].c_str());
+                continue;
+            }
+            int w = bgr.cols & ~1, h = bgr.rows & ~1;
+            pooled_buffer buf = acquire(w, h);
+            to_nv12(bgr(cv::Rect(0, 0, w, h)), cv::COLOR_BGR2YUV_I420, buf.get(), i420);
+            frame = nv12_frame(buf.get(), w, h, w, buf);
+            frame.capture_ns = what_time_is_it_now_ns();
+            frame.pts_ms = index * 1000.0 / fps;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::vector<std::string> files;
+    size_t next;
+};
+
+/*
+    原始帧文件映射到内存, 帧大小固定、首尾相接; 有 raw_file_header 时按文件头 (行跨度, 帧头)
+    NV12 不拷贝, 帧直接引用映射 (映射在最后一帧释放后才解除); RGB/BGR 转换到池里
+    rate > 0 时按该帧率放, 否则尽快
+*/
+class RawSource : public PooledSource {
+public:
+    RawSource()
+        : map(NULL), map_len(0), frame_bytes(0), data_offset(0), frame_offset(0), stride(0), next(0), first(0),
+          code(-1), rate(0), recorded(false), start_ns(0) {}
+
+    bool open(const source_uri &u)
+    {
+        if (!map_file(u.path))
+            return false;
+        std::string r = u.get("rate", "max");
+        rate = r == "max" ? 0 : atof(r.c_str());
+        const raw_file_header *h = (const raw_file_header *)map;
+        if (map_len >= sizeof(raw_file_header) && !memcmp(h->magic, RAW_MAGIC, sizeof(RAW_MAGIC))) {
+            if (h->version != RAW_VERSION || h->frame_bytes == 0) {
+                printf("raw source %s: unsupported version %u\n", u.path.c_str(), h->version);
+                return false;
+            }
+            recorded = true;
+            width = h->width;
+            height = h->height;
+            stride = h->stride;
+            fps = h->fps;
+            frame_bytes = h->frame_bytes;
+            data_offset = h->header_bytes;
+            frame_offset = RAW_FRAME_HEADER;
+            // 录制中断时帧数没写进文件头, 按文件长度算
+            frame_count = h->frame_count > 0 ? h->frame_count : (map_len - data_offset) / frame_bytes;
+            fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+            return frame_count > 0;
+        }
+        std::string size = u.get("size", "");
+        std::string format = u.get("format", has_suffix(u.path, ".rgb") ? "rgb" : "nv12");
+        if (sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            printf("raw source %s: need size=WxH\n", u.path.c_str());
+            return false;
+        }
+        if (format == "nv12") {
+            width &= ~1;
+            height &= ~1;
+            stride = width;
+            frame_bytes = (size_t)width * height * 3 / 2;
+        }
+        else if (format == "rgb" || format == "bgr") {
+            code = format == "rgb" ? cv::COLOR_RGB2YUV_I420 : cv::COLOR_BGR2YUV_I420;
+            frame_bytes = (size_t)width * height * 3;
+        }
+        else {
+            printf("raw source %s: unknown format %s\n", u.path.c_str(), format.c_str());
+            return false;
+        }
+        fps = u.get_int("fps", 25);
+        frame_count = map_len / frame_bytes;
+        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+        return frame_count > 0;
+    }
+    const char *name() const { return "raw"; }
+    bool seek(int frame)
+    {
+        next = first = frame;
+        return true;
+    }
+
+    bool read(nv12_frame &frame)
+    {
+        if ((int)next >= frame_count)
+            return false;
+        if (rate > 0) {
+            // 模拟采集帧率: 第 n 帧在开始后 n / rate 秒交出
+            double now = what_time_is_it_now_ns();
+            if (next == first)
+                start_ns = now;
+            double due = start_ns + (next - first) * 1e9 / rate;
+            if (due > now)
+                usleep((useconds_t)((due - now) / 1e3));
+        }
+        uint8_t *slot = (uint8_t *)map + data_offset + next * frame_bytes;
+        uint8_t *p = slot + frame_offset;
+        if (code < 0) {
+            frame = nv12_frame(p, width, height, stride, mapping);
+        }
+        else {
+            int w = width & ~1, h = height & ~1;
+            cv::Mat src(height, width, CV_8UC3, p);
+            pooled_buffer buf = acquire(w, h);
+            to_nv12(src(cv::Rect(0, 0, w, h)), code, buf.get(), i420);
+            frame = nv12_frame(buf.get(), w, h, w, buf);
+        }
+        frame.capture_ns = what_time_is_it_now_ns();
+        frame.pts_ms = next * 1000.0 / fps;
+        if (recorded)
+            frame.pts_ms = ((const raw_frame_header *)slot)->pts_ms;
+        next++;
+        return true;
+    }
+
+private:
+    bool map_file(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            printf("raw source: open %s fail\n", path.c_str());
+            return false;
+        }
+        struct stat st;
+        fstat(fd, &st);
+        map_len = st.st_size;
+        map = map_len > 0 ? mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            printf("raw source: mmap %s fail\n", path.c_str());
+            map = NULL;
+            return false;
+        }
+        madvise(map, map_len, MADV_SEQUENTIAL);
+        size_t len = map_len;
+        mapping = std::shared_ptr<const void>(map, [len](const void *p) { munmap((void *)p, len); });
+        return true;
+    }
+
+    void *map;
+    size_t map_len;
+    std::shared_ptr<const void> mapping;  // 源和所有帧共同持有, 都释放后解除映射
+    size_t frame_bytes;
+    size_t data_offset;   // 第一帧在文件中的偏移
+    size_t frame_offset;  // 像素在一帧中的偏移 (帧头)
+    int stride;
+    size_t next;
+    size_t first;  // 开始读的帧 (seek), 按帧率放时从这里计时
+    int code;  // RGB/BGR 转 I420 的颜色转换码, NV12 为 -1
+    double rate;
+    bool recorded;  // 有文件头 (record_raw 录的)
+    double start_ns;
+};
+
+/*
+    只读 [start, start + frames) 一段, 第一次 read 时才定位 (不能定位的来源要读掉前面的帧, 放在读帧线程里做)
+    帧的媒体时间仍是在整个文件中的时间
+*/
+class SegmentSource : public FrameSource {
+public:
+    SegmentSource(FrameSource *inner, int start, int frames) : inner(inner), start(start), left(0), positioned(false)
+    {
+        fps = inner->fps;
+        width = inner->width;
+        height = inner->height;
+        fourcc = inner->fourcc;
+        live = inner->live;
+        frame_count = inner->frame_count >= 0 ? std::max(0, std::min(frames, inner->frame_count - start)) : frames;
+        left = frame_count;
+    }
+    ~SegmentSource() { delete inner; }
+    const char *name() const { return inner->name(); }
+
+    bool read(nv12_frame &frame)
+    {
+        if (!positioned) {
+            positioned = true;
+            if (start > 0 && !inner->seek(start)) {
+                printf("frame source %s: cannot seek to frame %d, reading through\n", inner->name(), start);
+                for (int i = 0; i < start; i++)
+                    if (!inner->read(frame))
+                        return false;
+            }
+        }
+        if (left <= 0 || !inner->read(frame))
+            return false;
+        left--;
+        return true;
+    }
+
+private:
+    FrameSource *inner;
+    int start;
+    int left;
+    bool positioned;
+};
+
+FrameSource *open_frame_source(const std::string &uri)
+{
+    source_uri u = parse_uri(uri);
+    FrameSource *src = NULL;
+    if (u.scheme == "camera") {
+        char pipeline[512];
+        snprintf(pipeline, sizeof(pipeline),
+                 "v4l2src device=%s io-mode=4 ! video/x-raw,format=NV12,width=%d,height=%d,framerate=%d/1 ! appsink",
+                 u.path.c_str(), u.get_int("width", 720), u.get_int("height", 576), u.get_int("fps", 15));
+        CaptureSource *s = new CaptureSource("camera", true);
+        if (s->open_gst(pipeline))
+            src = s;
+        else
+            delete s;
+    }
+    else if (u.scheme == "gst") {
+        CaptureSource *s = new CaptureSource("gst", true);
+        if (s->open_gst(u.path))
+            src = s;
+        else
+            delete s;
+    }
+    else if (u.scheme == "file") {
+        // 先试 GStreamer 解码到 NV12 (RK 上 decodebin 会选 MPP 硬解), 不行再用默认后端出 BGR
+        // 分段 (start=) 时反过来: appsink 基本不能定位, 每段都得从头解码到自己的起点, 默认后端 (FFmpeg) 能直接跳过去
+        std::string pipeline = "filesrc location=" + u.path
+                             + " ! decodebin ! videoconvert ! video/x-raw,format=NV12 ! appsink sync=false";
+        CaptureSource *s = new CaptureSource("file", false);
+        bool ok = u.get_int("start", 0) > 0 ? s->open_any(u.path) || s->open_gst(pipeline)
+                                            : s->open_gst(pipeline) || s->open_any(u.path);
+        if (ok)
+            src = s;
+        else
+            delete s;
+    }
+    else if (u.scheme == "images") {
+        ImageSequenceSource *s = new ImageSequenceSource();
+        if (s->open(u.path, u.get_int("fps", 25)))
+            src = s;
+        else
+            delete s;
+    }
+    else if (u.scheme == "raw") {
+        RawSource *s = new RawSource();
+        if (s->open(u))
+            src = s;
+        else
+            delete s;
+    }
+    else {
+        printf("unknown frame source scheme: %s\n", u.scheme.c_str());
+        return NULL;
+    }
+    if (src != NULL && src->frame_count >= 0 && (u.params.count("start") || u.params.count("frames"))) {
+        int start = u.get_int("start", 0);
+        src = new SegmentSource(src, start, u.get_int("frames", src->frame_count - start));
+    }
+    if (src == NULL)
+        printf("Fail to open frame source %s\n", uri.c_str());
+    else
+        printf("frame source %s: %s %dx%d, %d fps, %d frames\n", src->name(), u.path.c_str(), src->width,
+               src->height, src->fps, src->frame_count);
+    return src;
+}
@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <unistd.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "image_processor.h"
+#ifndef NO_RGA
+#include "im2d.h"
+#include "RgaUtils.h"
+#include "rga.h"
+#endif
+
+void letterbox_init(letterbox_t &lb, int src_w, int src_h, int dst_w, int dst_h, bool keep_ratio)
+{
+    lb.src_w = src_w;
+    lb.src_h = src_h;
+    lb.dst_w = dst_w;
+    lb.dst_h = dst_h;
+    if (!keep_ratio) {
+        lb.resize_w = dst_w;
+        lb.resize_h = dst_h;
+        lb.scale_x = (float)dst_w / src_w;
+        lb.scale_y = (float)dst_h / src_h;
+    }
+    else {
+        float scale = fminf((float)dst_w / src_w, (float)dst_h / src_h);
+        lb.resize_w = (int)(src_w * scale + 0.5f);
+        lb.resize_h = (int)(src_h * scale + 0.5f);
+        if (lb.resize_w > dst_w) lb.resize_w = dst_w;
+        if (lb.resize_h > dst_h) lb.resize_h = dst_h;
+        lb.scale_x = scale;
+        lb.scale_y = scale;
+    }
+    lb.pad_left = (dst_w - lb.resize_w) / 2;
+    lb.pad_top = (dst_h - lb.resize_h) / 2;
+}
+
+image_view make_image_view(uint8_t *data, int width, int height, image_format format)
+{
+    image_view v;
+    v.data = data;
+    v.width = width;
+    v.height = height;
+    v.format = format;
+    v.stride = format == IMAGE_NV12 ? width : width * 3;
+    v.uv = format == IMAGE_NV12 ? data + (size_t)width * height : NULL;
+    return v;
+}
+
+void fill_letterbox_pad(const image_view &dst, const letterbox_t &lb, uint8_t value)
+{
+    int row_bytes = lb.dst_w * 3;
+    for (int i = 0; i < lb.pad_top; i++)
+        memset(dst.data + (size_t)i * dst.stride, value, row_bytes);
+    int bottom = lb.pad_top + lb.resize_h;
+    for (int i = bottom; i < lb.dst_h; i++)
+        memset(dst.data + (size_t)i * dst.stride, value, row_bytes);
+    int right = lb.pad_left + lb.resize_w;
+    if (lb.pad_left == 0 && right == lb.dst_w)
+        return;
+    for (int i = lb.pad_top; i < bottom; i++) {
+        uint8_t *row = dst.data + (size_t)i * dst.stride;
+        memset(row, value, lb.pad_left * 3);
+        memset(row + right * 3, value, (lb.dst_w - right) * 3);
+    }
+}
+
+int ImageProcessor::resize(const image_view &src, const image_view &dst)
+{
+    image_rect s = {0, 0, src.width, src.height};
+    image_rect d = {0, 0, dst.width, dst.height};
+    return process(src, s, dst, d);
+}
+
+int ImageProcessor::crop(const image_view &src, const image_rect &rect, const image_view &dst)
+{
+    image_rect d = {0, 0, dst.width, dst.height};
+    return process(src, rect, dst, d);
+}
+
+int ImageProcessor::cvt_color(const image_view &src, const image_view &dst)
+{
+    if (src.width != dst.width || src.height != dst.height)
+        return -1;
+    return resize(src, dst);
+}
+
+int ImageProcessor::letterbox(const image_view &src, const image_view &dst, const letterbox_t &lb)
+{
+    image_rect s = {0, 0, lb.src_w, lb.src_h};
+    image_rect d = {lb.pad_left, lb.pad_top, lb.resize_w, lb.resize_h};
+    return process(src, s, dst, d);
+}
+
+/*---------------------------------------------------------
+    CPU 后端
+    双线性缩放, 权重 Q7; 颜色转换 BT.601 limited range (与 cv::COLOR_YUV2RGB_NV12 一致), 系数 Q6:
+        R = 1.164(Y-16) + 1.596(V-128)
+        G = 1.164(Y-16) - 0.391(U-128) - 0.813(V-128)
+        B = 1.164(Y-16) + 2.018(U-128)
+    每个输出行: 需要的源行先做水平插值 (行缓存, 相邻输出行复用), 再做垂直插值 (+ 颜色转换) (SIMD)
+    SIMD 与标量的整数运算完全一致, 输出逐字节相同
+----------------------------------------------------------*/
+#define LB_W_BITS 7
+#define LB_W_ONE  (1 << LB_W_BITS)
+
+// 一维插值表: 源坐标 x0, x1 与 x1 的权重
+static void build_axis(int dst_len, int src_len, float scale, std::vector<int> &ofs0, std::vector<int> &ofs1,
+                       std::vector<uint8_t> &alpha)
+{
+    ofs0.resize(dst_len);
+    ofs1.resize(dst_len);
+    alpha.resize(dst_len);
+    for (int i = 0; i < dst_len; i++) {
+        float s = (i + 0.5f) / scale - 0.5f;
+        if (s < 0) s = 0;
+        int s0 = (int)s;
+        if (s0 > src_len - 1) s0 = src_len - 1;
+        int a = (int)((s - s0) * LB_W_ONE + 0.5f);
+        if (a >= LB_W_ONE) a = LB_W_ONE - 1;
+        ofs0[i] = s0;
+        ofs1[i] = s0 + 1 < src_len ? s0 + 1 : src_len - 1;
+        alpha[i] = a;
+    }
+}
+
+static inline uint8_t lerp_u8(int a, int b, int w)
+{
+    return (uint8_t)((a * (LB_W_ONE - w) + b * w + (LB_W_ONE >> 1)) >> LB_W_BITS);
+}
+
+static inline uint8_t clip_q6(int v)
+{
+    v = (v + 32) >> 6;
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// 垂直插值 + YUV -> RGB, 处理 [start, n) 的标量部分; ri 为 R 通道位置 (0: RGB, 2: BGR)
+static void blend_convert_scalar(const uint8_t *y0, const uint8_t *y1, int wy, const uint8_t *c0, const uint8_t *c1,
+                                 int wc, int width, int start, int n, int ri, uint8_t *dst)
+{
+    int bi = 2 - ri;
+    for (int i = start; i < n; i++) {
+        int yy = lerp_u8(y0[i], y1[i], wy) - 16;
+        int u = lerp_u8(c0[i], c1[i], wc) - 128;
+        int v = lerp_u8(c0[width + i], c1[width + i], wc) - 128;
+        int yc = yy * 74;
+        dst[i * 3 + ri] = clip_q6(yc + v * 102);
+        dst[i * 3 + 1] = clip_q6(yc - u * 25 - v * 52);
+        dst[i * 3 + bi] = clip_q6(yc + u * 129);
+    }
+}
+
+#if defined(__ARM_NEON)
+static void blend_convert(const uint8_t *y0, const uint8_t *y1, int wy, const uint8_t *c0, const uint8_t *c1, int wc,
+                          int n, int ri, uint8_t *dst)
+{
+    uint8x8_t wy1 = vdup_n_u8(wy), wy0 = vdup_n_u8(LB_W_ONE - wy);
+    uint8x8_t wc1 = vdup_n_u8(wc), wc0 = vdup_n_u8(LB_W_ONE - wc);
+    int16x8_t k16 = vdupq_n_s16(16), k128 = vdupq_n_s16(128);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8x8_t ys = vrshrn_n_u16(vmlal_u8(vmull_u8(vld1_u8(y0 + i), wy0), vld1_u8(y1 + i), wy1), LB_W_BITS);
+        uint8x8_t us = vrshrn_n_u16(vmlal_u8(vmull_u8(vld1_u8(c0 + i), wc0), vld1_u8(c1 + i), wc1), LB_W_BITS);
+        uint8x8_t vs = vrshrn_n_u16(vmlal_u8(vmull_u8(vld1_u8(c0 + n + i), wc0), vld1_u8(c1 + n + i), wc1), LB_W_BITS);
+        int16x8_t yc = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(ys)), k16), 74);
+        int16x8_t u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(us)), k128);
+        int16x8_t v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vs)), k128);
+        uint8x8x3_t rgb;
+        rgb.val[ri] = vqrshrun_n_s16(vqaddq_s16(yc, vmulq_n_s16(v, 102)), 6);
+        rgb.val[1] = vqrshrun_n_s16(vqsubq_s16(vqsubq_s16(yc, vmulq_n_s16(u, 25)), vmulq_n_s16(v, 52)), 6);
+        rgb.val[2 - ri] = vqrshrun_n_s16(vqaddq_s16(yc, vmulq_n_s16(u, 129)), 6);
+        vst3_u8(dst + i * 3, rgb);
+    }
+    blend_convert_scalar(y0, y1, wy, c0, c1, wc, n, i, n, ri, dst);
+}
+#elif defined(__SSE2__)
+static inline __m128i lerp_epi16(const uint8_t *a, const uint8_t *b, __m128i w0, __m128i w1)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)a), zero);
+    __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)b), zero);
+    __m128i s = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(va, w0), _mm_mullo_epi16(vb, w1)),
+                              _mm_set1_epi16(LB_W_ONE >> 1));
+    return _mm_srli_epi16(s, LB_W_BITS);
+}
+
+static inline __m128i round_q6(__m128i v)
+{
+    return _mm_srai_epi16(_mm_adds_epi16(v, _mm_set1_epi16(32)), 6);
+}
+
+static void blend_convert(const uint8_t *y0, const uint8_t *y1, int wy, const uint8_t *c0, const uint8_t *c1, int wc,
+                          int n, int ri, uint8_t *dst)
+{
+    __m128i wy1 = _mm_set1_epi16(wy), wy0 = _mm_set1_epi16(LB_W_ONE - wy);
+    __m128i wc1 = _mm_set1_epi16(wc), wc0 = _mm_set1_epi16(LB_W_ONE - wc);
+    __m128i k16 = _mm_set1_epi16(16), k128 = _mm_set1_epi16(128);
+    __m128i k74 = _mm_set1_epi16(74), k102 = _mm_set1_epi16(102), k25 = _mm_set1_epi16(25);
+    __m128i k52 = _mm_set1_epi16(52), k129 = _mm_set1_epi16(129);
+    uint8_t r[16], g[16], b[16];
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i yc = _mm_mullo_epi16(_mm_sub_epi16(lerp_epi16(y0 + i, y1 + i, wy0, wy1), k16), k74);
+        __m128i u = _mm_sub_epi16(lerp_epi16(c0 + i, c1 + i, wc0, wc1), k128);
+        __m128i v = _mm_sub_epi16(lerp_epi16(c0 + n + i, c1 + n + i, wc0, wc1), k128);
+        __m128i vr = round_q6(_mm_adds_epi16(yc, _mm_mullo_epi16(v, k102)));
+        __m128i vg = round_q6(_mm_subs_epi16(_mm_subs_epi16(yc, _mm_mullo_epi16(u, k25)), _mm_mullo_epi16(v, k52)));
+        __m128i vb = round_q6(_mm_adds_epi16(yc, _mm_mullo_epi16(u, k129)));
+        _mm_storeu_si128((__m128i *)r, _mm_packus_epi16(vr, vr));
+        _mm_storeu_si128((__m128i *)g, _mm_packus_epi16(vg, vg));
+        _mm_storeu_si128((__m128i *)b, _mm_packus_epi16(vb, vb));
+        uint8_t *d = dst + i * 3;
+        for (int k = 0; k < 8; k++) {
+            d[k * 3 + ri] = r[k];
+            d[k * 3 + 1] = g[k];
+            d[k * 3 + 2 - ri] = b[k];
+        }
+    }
+    blend_convert_scalar(y0, y1, wy, c0, c1, wc, n, i, n, ri, dst);
+}
+#else
+static void blend_convert(const uint8_t *y0, const uint8_t *y1, int wy, const uint8_t *c0, const uint8_t *c1, int wc,
+                          int n, int ri, uint8_t *dst)
+{
+    blend_convert_scalar(y0, y1, wy, c0, c1, wc, n, 0, n, ri, dst);
+}
+#endif
+
+
+// 垂直插值两行打包像素 (RGB/BGR), n 为字节数
+static void blend_rows(const uint8_t *r0, const uint8_t *r1, int w, int n, uint8_t *dst)
+{
+    int i = 0;
+#if defined(__ARM_NEON)
+    uint8x8_t w1 = vdup_n_u8(w), w0 = vdup_n_u8(LB_W_ONE - w);
+    for (; i + 8 <= n; i += 8)
+        vst1_u8(dst + i, vrshrn_n_u16(vmlal_u8(vmull_u8(vld1_u8(r0 + i), w0), vld1_u8(r1 + i), w1), LB_W_BITS));
+#elif defined(__SSE2__)
+    __m128i w1 = _mm_set1_epi16(w), w0 = _mm_set1_epi16(LB_W_ONE - w);
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = lerp_epi16(r0 + i, r1 + i, w0, w1);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(v, v));
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = lerp_u8(r0[i], r1[i], w);
+}
+
+/*
+    每个线程一份插值表和行缓存, 预热后不再分配内存
+    row:    Y 行或打包像素行的水平插值结果
+    chroma: U 在前 dst 宽度字节, V 在后
+*/
+struct cpu_scratch {
+    std::vector<int> xofs0, xofs1, yofs0, yofs1, cxofs0, cxofs1, cyofs0, cyofs1;
+    std::vector<uint8_t> xalpha, yalpha, cxalpha, cyalpha;
+    std::vector<uint8_t> row_buf[2];
+    std::vector<uint8_t> chroma_buf[2];
+    int row_id[2];
+    int chroma_id[2];
+};
+
+// 源行 r 所在的缓存槽, 不淘汰同时在用的 keep 行
+static int cached_slot(const int rows[2], int r, int keep)
+{
+    if (rows[0] == r) return 0;
+    if (rows[1] == r) return 1;
+    return rows[0] == keep ? 1 : 0;
+}
+
+class CpuImageProcessor : public ImageProcessor {
+public:
+    const char *name() const override { return "cpu"; }
+
+    int process(const image_view &src, const image_rect &src_rect,
+                const image_view &dst, const image_rect &dst_rect) override
+    {
+        if (dst.format == IMAGE_NV12 || src_rect.width < 2 || src_rect.height < 2
+            || dst_rect.width <= 0 || dst_rect.height <= 0)
+            return -1;
+        int ri = dst.format == IMAGE_BGR888 ? 2 : 0;
+        if (src.format == IMAGE_NV12)
+            return nv12_to_packed(src, src_rect, dst, dst_rect, ri);
+        // RGB <-> BGR 交换 R/B
+        bool swap = src.format != dst.format;
+        return packed_to_packed(src, src_rect, dst, dst_rect, swap);
+    }
+
+private:
+    static int nv12_to_packed(const image_view &src, image_rect sr, const image_view &dst, const image_rect &dr, int ri)
+    {
+        static thread_local cpu_scratch sc;
+        sr.width += sr.x & 1;
+        sr.height += sr.y & 1;
+        sr.x &= ~1;
+        sr.y &= ~1;
+        float scale_x = (float)dr.width / sr.width;
+        float scale_y = (float)dr.height / sr.height;
+        int w = dr.width;
+        build_axis(w, sr.width, scale_x, sc.xofs0, sc.xofs1, sc.xalpha);
+        build_axis(dr.height, sr.height, scale_y, sc.yofs0, sc.yofs1, sc.yalpha);
+        build_axis(w, (sr.width + 1) / 2, scale_x * 2, sc.cxofs0, sc.cxofs1, sc.cxalpha);
+        build_axis(dr.height, (sr.height + 1) / 2, scale_y * 2, sc.cyofs0, sc.cyofs1, sc.cyalpha);
+        for (int s = 0; s < 2; s++) {
+            sc.row_buf[s].resize(w);
+            sc.chroma_buf[s].resize(w * 2);
+            sc.row_id[s] = sc.chroma_id[s] = -1;
+        }
+        const uint8_t *y = src.data + (size_t)sr.y * src.stride + sr.x;
+        const uint8_t *uv = src.uv + (size_t)(sr.y / 2) * src.stride + sr.x;
+
+        for (int i = 0; i < dr.height; i++) {
+            const uint8_t *l[2], *c[2];
+            for (int k = 0; k < 2; k++) {
+                int r = k ? sc.yofs1[i] : sc.yofs0[i];
+                int s = cached_slot(sc.row_id, r, k ? sc.yofs0[i] : sc.yofs1[i]);
+                if (sc.row_id[s] != r) {
+                    const uint8_t *row = y + (size_t)r * src.stride;
+                    uint8_t *d = sc.row_buf[s].data();
+                    for (int j = 0; j < w; j++)
+                        d[j] = lerp_u8(row[sc.xofs0[j]], row[sc.xofs1[j]], sc.xalpha[j]);
+                    sc.row_id[s] = r;
+                }
+                l[k] = sc.row_buf[s].data();
+
+                r = k ? sc.cyofs1[i] : sc.cyofs0[i];
+                s = cached_slot(sc.chroma_id, r, k ? sc.cyofs0[i] : sc.cyofs1[i]);
+                if (sc.chroma_id[s] != r) {
+                    const uint8_t *row = uv + (size_t)r * src.stride;
+                    uint8_t *du = sc.chroma_buf[s].data();
+                    uint8_t *dv = du + w;
+                    for (int j = 0; j < w; j++) {
+                        int a = sc.cxofs0[j] * 2, b = sc.cxofs1[j] * 2;
+                        du[j] = lerp_u8(row[a], row[b], sc.cxalpha[j]);
+                        dv[j] = lerp_u8(row[a + 1], row[b + 1], sc.cxalpha[j]);
+                    }
+                    sc.chroma_id[s] = r;
+                }
+                c[k] = sc.chroma_buf[s].data();
+            }
+            uint8_t *out = dst.data + (size_t)(dr.y + i) * dst.stride + dr.x * 3;
+            blend_convert(l[0], l[1], sc.yalpha[i], c[0], c[1], sc.cyalpha[i], w, ri, out);
+        }
+        return 0;
+    }
+
+    static int packed_to_packed(const image_view &src, const image_rect &sr, const image_view &dst,
+                                const image_rect &dr, bool swap)
+    {
+        static thread_local cpu_scratch sc;
+        int w = dr.width;
+        build_axis(w, sr.width, (float)dr.width / sr.width, sc.xofs0, sc.xofs1, sc.xalpha);
+        build_axis(dr.height, sr.height, (float)dr.height / sr.height, sc.yofs0, sc.yofs1, sc.yalpha);
+        for (int s = 0; s < 2; s++) {
+            sc.row_buf[s].resize(w * 3);
+            sc.row_id[s] = -1;
+        }
+        int c0 = swap ? 2 : 0, c2 = 2 - c0;
+        const uint8_t *base = src.data + (size_t)sr.y * src.stride + sr.x * 3;
+
+        for (int i = 0; i < dr.height; i++) {
+            const uint8_t *l[2];
+            for (int k = 0; k < 2; k++) {
+                int r = k ? sc.yofs1[i] : sc.yofs0[i];
+                int s = cached_slot(sc.row_id, r, k ? sc.yofs0[i] : sc.yofs1[i]);
+                if (sc.row_id[s] != r) {
+                    const uint8_t *row = base + (size_t)r * src.stride;
+                    uint8_t *d = sc.row_buf[s].data();
+                    for (int j = 0; j < w; j++) {
+                        const uint8_t *a = row + sc.xofs0[j] * 3, *b = row + sc.xofs1[j] * 3;
+                        int t = sc.xalpha[j];
+                        d[j * 3 + 0] = lerp_u8(a[c0], b[c0], t);
+                        d[j * 3 + 1] = lerp_u8(a[1], b[1], t);
+                        d[j * 3 + 2] = lerp_u8(a[c2], b[c2], t);
+                    }
+                    sc.row_id[s] = r;
+                }
+                l[k] = sc.row_buf[s].data();
+            }
+            uint8_t *out = dst.data + (size_t)(dr.y + i) * dst.stride + dr.x * 3;
+            blend_rows(l[0], l[1], sc.yalpha[i], w * 3, out);
+        }
+        return 0;
+    }
+};
+
+/*---------------------------------------------------------
+    RGA 后端: 缩放和颜色转换一次完成
+    NV12 要求 uv 平面紧跟在 y 平面之后
+----------------------------------------------------------*/
+#ifndef NO_RGA
+static int rga_format(image_format f)
+{
+    return f == IMAGE_NV12 ? RK_FORMAT_YCbCr_420_SP : (f == IMAGE_BGR888 ? RK_FORMAT_BGR_888 : RK_FORMAT_RGB_888);
+}
+
+static rga_buffer_t rga_wrap(const image_view &v)
+{
+    int wstride = v.format == IMAGE_NV12 ? v.stride : v.stride / 3;
+    return wrapbuffer_virtualaddr((void *)v.data, v.width, v.height, rga_format(v.format), wstride, v.height);
+}
+
+class RgaImageProcessor : public ImageProcessor {
+public:
+    const char *name() const override { return "rga"; }
+
+    int process(const image_view &src, const image_rect &sr,
+                const image_view &dst, const image_rect &dr) override
+    {
+        if (src.format == IMAGE_NV12 && src.uv != src.data + (size_t)src.stride * src.height) {
+            printf("rga: NV12 planes are not contiguous\n");
+            return -1;
+        }
+        rga_buffer_t in = rga_wrap(src);
+        rga_buffer_t out = rga_wrap(dst);
+        rga_buffer_t pat;
+        im_rect src_rect, dst_rect, pat_rect;
+        memset(&pat, 0, sizeof(pat));
+        memset(&pat_rect, 0, sizeof(pat_rect));
+        src_rect.x = src.format == IMAGE_NV12 ? sr.x & ~1 : sr.x;
+        src_rect.y = src.format == IMAGE_NV12 ? sr.y & ~1 : sr.y;
+        src_rect.width = sr.width;
+        src_rect.height = sr.height;
+        dst_rect.x = dr.x;
+        dst_rect.y = dr.y;
+        dst_rect.width = dr.width;
+        dst_rect.height = dr.height;
+        int ret = imcheck(in, out, src_rect, dst_rect);
+        if (IM_STATUS_NOERROR != ret) {
+            fprintf(stderr, "rga check error! %s", imStrError((IM_STATUS)ret));
+            return -1;
+        }
+        ret = improcess(in, out, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+        return ret == IM_STATUS_SUCCESS ? 0 : -1;
+    }
+};
+#endif
+
+ImageProcessor *create_image_processor(const char *backend)
+{
+    bool has_rga = access("/dev/rga", F_OK) == 0;
+#ifdef NO_RGA
+    has_rga = false;
+#endif
+    bool want_rga = !strcasecmp(backend, "rga") || (!strcasecmp(backend, "auto") && has_rga);
+    ImageProcessor *p = NULL;
+#ifndef NO_RGA
+    if (want_rga && has_rga)
+        p = new RgaImageProcessor();
+#endif
+    if (want_rga && !has_rga)
+        printf("image processor: RGA not available, fall back to CPU\n");
+    if (p == NULL)
+        p = new CpuImageProcessor();
+    printf("image processor: %s\n", p->name());
+    return p;
+}
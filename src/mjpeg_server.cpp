@@ -0,0 +1,185 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+#include "mjpeg_server.h"
+
+#define MJPEG_BOUNDARY "mjpegframe"
+
+static const char *INDEX_PAGE =
+    "<html><head><title>DeepSORT</title></head>"
+    "<body style=\"margin:0;background:#000\"><img src=\"/stream\" style=\"max-width:100%\"></body></html>";
+
+// 全部发完返回 true; 超时或对端关闭返回 false
+static bool send_all(int fd, const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool send_str(int fd, const std::string &s)
+{
+    return send_all(fd, s.data(), s.size());
+}
+
+bool MjpegServer::start(const char *bind_addr, int port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        printf("mjpeg: socket fail\n");
+        return false;
+    }
+    int on = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, bind_addr, &addr.sin_addr) != 1 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, MJPEG_MAX_CLIENTS) < 0) {
+        printf("mjpeg: cannot listen on %s:%d\n", bind_addr, port);
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    running = true;
+    acceptor = std::thread(&MjpegServer::accept_loop, this);
+    printf("mjpeg: serving http://%s:%d/stream\n", bind_addr, port);
+    return true;
+}
+
+void MjpegServer::stop()
+{
+    if (!running)
+        return;
+    running = false;
+    acceptor.join();
+    ::close(listen_fd);
+    listen_fd = -1;
+    std::unique_lock<std::mutex> lock(mtx);
+    for (int fd : client_fds)
+        shutdown(fd, SHUT_RDWR);
+    cv.notify_all();
+    cv.wait(lock, [this] { return n_clients == 0; });
+}
+
+void MjpegServer::publish(jpeg_buffer jpeg)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    latest = jpeg;
+    seq++;
+    cv.notify_all();
+}
+
+jpeg_buffer MjpegServer::wait_frame(uint64_t &last)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [&] { return !running || (latest && seq != last); });
+    if (!running)
+        return jpeg_buffer();
+    if (last != 0 && seq > last + 1)
+        frames_skipped += seq - last - 1;
+    last = seq;
+    return latest;
+}
+
+void MjpegServer::accept_loop()
+{
+    while (running) {
+        pollfd p = {listen_fd, POLLIN, 0};
+        if (poll(&p, 1, 200) <= 0)
+            continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        if (n_clients >= MJPEG_MAX_CLIENTS) {
+            send_str(fd, "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+            ::close(fd);
+            continue;
+        }
+        timeval tv = {MJPEG_SEND_TIMEOUT, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        int sndbuf = MJPEG_SNDBUF;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            client_fds.insert(fd);
+            n_clients++;
+        }
+        std::thread(&MjpegServer::serve, this, fd).detach();
+    }
+}
+
+void MjpegServer::serve(int fd)
+{
+    // 只看请求行的路径, 其余头部忽略
+    char req[2048];
+    size_t got = 0;
+    while (got < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+        if (n <= 0)
+            break;
+        got += n;
+        req[got] = 0;
+        if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+            break;
+    }
+    req[got] = 0;
+    char method[8] = {0}, path[256] = {0};
+    sscanf(req, "%7s %255s", method, path);
+
+    uint64_t last = 0;
+    if (!strcmp(path, "/") || !strcmp(path, "/index.html")) {
+        send_str(fd, "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\nContent-Length: " +
+                         std::to_string(strlen(INDEX_PAGE)) + "\r\n\r\n" + INDEX_PAGE);
+    }
+    else if (!strcmp(path, "/snapshot") || !strcmp(path, "/snapshot.jpg")) {
+        n_viewers++;
+        jpeg_buffer jpeg = wait_frame(last);
+        n_viewers--;
+        if (jpeg) {
+            send_str(fd, "HTTP/1.0 200 OK\r\nContent-Type: image/jpeg\r\nCache-Control: no-cache\r\nContent-Length: " +
+                             std::to_string(jpeg->size()) + "\r\n\r\n");
+            send_all(fd, jpeg->data(), jpeg->size());
+            frames_sent++;
+        }
+    }
+    else if (!strcmp(path, "/stream")) {
+        bool ok = send_str(fd, "HTTP/1.0 200 OK\r\nCache-Control: no-cache\r\nConnection: close\r\n"
+                               "Content-Type: multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY "\r\n\r\n");
+        n_viewers++;
+        while (ok) {
+            jpeg_buffer jpeg = wait_frame(last);
+            if (!jpeg)
+                break;
+            ok = send_str(fd, "--" MJPEG_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: " +
+                                  std::to_string(jpeg->size()) + "\r\n\r\n") &&
+                 send_all(fd, jpeg->data(), jpeg->size()) && send_str(fd, "\r\n");
+            if (ok)
+                frames_sent++;
+        }
+        n_viewers--;
+    }
+    else {
+        send_str(fd, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    client_fds.erase(fd);
+    ::close(fd);
+    n_clients--;
+    cv.notify_all();
+}
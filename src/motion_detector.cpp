@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "motion_detector.h"
+
+// 一行像素每 8 个求和, 累加到 acc (最多 8 行, uint16 不会溢出)
+static void row_block_sums_scalar(const uint8_t *row, int begin, int n, uint16_t *acc)
+{
+    for (int c = begin; c < n; c++) {
+        const uint8_t *p = row + c * MOTION_BLOCK;
+        acc[c] += p[0] + p[1] + p[2] + p[3] + p[4] + p[5] + p[6] + p[7];
+    }
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static void row_block_sums(const uint8_t *row, int n, uint16_t *acc)
+{
+    int c = 0;
+    for (; c + 8 <= n; c += 8) {
+        const uint8_t *p = row + c * MOTION_BLOCK;
+        uint16x8_t p0 = vpaddlq_u8(vld1q_u8(p));
+        uint16x8_t p1 = vpaddlq_u8(vld1q_u8(p + 16));
+        uint16x8_t p2 = vpaddlq_u8(vld1q_u8(p + 32));
+        uint16x8_t p3 = vpaddlq_u8(vld1q_u8(p + 48));
+        uint16x8_t s = vpaddq_u16(vpaddq_u16(p0, p1), vpaddq_u16(p2, p3));
+        vst1q_u16(acc + c, vaddq_u16(vld1q_u16(acc + c), s));
+    }
+    row_block_sums_scalar(row, c, n, acc);
+}
+#elif defined(__SSE2__)
+static void row_block_sums(const uint8_t *row, int n, uint16_t *acc)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int c = 0;
+    for (; c + 2 <= n; c += 2) {
+        // 两个 64 位通道各得 8 个字节的和
+        __m128i s = _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(row + c * MOTION_BLOCK)), zero);
+        acc[c] += _mm_cvtsi128_si32(s);
+        acc[c + 1] += _mm_extract_epi16(s, 4);
+    }
+    row_block_sums_scalar(row, c, n, acc);
+}
+#else
+static void row_block_sums(const uint8_t *row, int n, uint16_t *acc)
+{
+    row_block_sums_scalar(row, 0, n, acc);
+}
+#endif
+
+float MotionDetector::update(const nv12_frame &frame)
+{
+    int gw = frame.width / MOTION_BLOCK, gh = frame.height / MOTION_BLOCK;
+    if (gw <= 0 || gh <= 0)
+        return 1.f;
+    bool reset = gw != grid_w || gh != grid_h;
+    grid_w = gw;
+    grid_h = gh;
+    cells.assign(gw * gh, 0);
+
+    const uint8_t *y = frame.y();
+    int stride = frame.stride();
+    for (int gy = 0; gy < gh; gy++) {
+        uint16_t *acc = &cells[gy * gw];
+        for (int r = 0; r < MOTION_BLOCK; r++)
+            row_block_sums(y + (size_t)(gy * MOTION_BLOCK + r) * stride, gw, acc);
+    }
+
+    int n = gw * gh;
+    if (reset) {
+        background.resize(n);
+        for (int i = 0; i < n; i++)
+            background[i] = (uint16_t)(cells[i] << 2);  // 和 / 64 * 256
+        return 1.f;
+    }
+    int changed = 0;
+    for (int i = 0; i < n; i++) {
+        int cur = cells[i] << 2;  // Q8
+        int bg = background[i];
+        changed += abs(cur - bg) > (MOTION_CELL_THRESH << 8);
+        background[i] = (uint16_t)(bg + ((cur - bg) >> MOTION_BG_SHIFT));
+    }
+    return (float)changed / n;
+}
@@ -1,3 +1,4 @@
+#include <time.h>
 #include "mytime.h"
 double what_time_is_it_now()
 {
@@ -7,4 +8,13 @@ double what_time_is_it_now()
         return 0;
     }
     return (double)time.tv_sec * 1000 + (double)time.tv_usec * .001;
-}
\ No newline at end of file
+}
+
+double what_time_is_it_now_ns()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts)){
+        return 0;
+    }
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
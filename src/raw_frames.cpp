@@ -0,0 +1,62 @@
+#include <string.h>
+#include <vector>
+
+#include "raw_frames.h"
+
+static uint32_t align_up(uint32_t v, uint32_t a)
+{
+    return (v + a - 1) / a * a;
+}
+
+bool RawFrameWriter::open(const char *path, int width, int height, int fps)
+{
+    close();
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return false;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RAW_MAGIC, sizeof(RAW_MAGIC));
+    header.version = RAW_VERSION;
+    header.width = width & ~1;
+    header.height = height & ~1;
+    header.stride = align_up(header.width, RAW_STRIDE_ALIGN);
+    header.header_bytes = RAW_PAGE;
+    header.frame_bytes = align_up(RAW_FRAME_HEADER + header.stride * header.height * 3 / 2, RAW_PAGE);
+    header.fps = fps;
+    slot.assign(header.frame_bytes, 0);
+
+    std::vector<uint8_t> head(header.header_bytes, 0);
+    memcpy(&head[0], &header, sizeof(header));
+    return fwrite(&head[0], 1, head.size(), fp) == head.size();
+}
+
+bool RawFrameWriter::write(const nv12_frame &frame)
+{
+    if (fp == NULL || frame.width < (int)header.width || frame.height < (int)header.height)
+        return false;
+    raw_frame_header fh = {header.frame_count, frame.pts_ms, frame.capture_ns};
+    memcpy(&slot[0], &fh, sizeof(fh));
+    // 按文件的行跨度重新排列, 分辨率比录制时大的帧只取左上角
+    uint8_t *dst = &slot[RAW_FRAME_HEADER];
+    for (uint32_t r = 0; r < header.height; r++)
+        memcpy(dst + (size_t)r * header.stride, frame.y() + (size_t)r * frame.stride(), header.width);
+    dst += (size_t)header.stride * header.height;
+    for (uint32_t r = 0; r < header.height / 2; r++)
+        memcpy(dst + (size_t)r * header.stride, frame.uv() + (size_t)r * frame.stride(), header.width);
+    if (fwrite(&slot[0], 1, slot.size(), fp) != slot.size())
+        return false;
+    header.frame_count++;
+    return true;
+}
+
+void RawFrameWriter::close()
+{
+    if (fp == NULL)
+        return;
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&header, 1, sizeof(header), fp);
+    fclose(fp);
+    fp = NULL;
+}
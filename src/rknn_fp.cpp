@@ -21,6 +21,7 @@ rknn_fp::rknn_fp(const char *model_path, int cpuid, rknn_core_mask core_mask,
 	printf("Bind NPU process on CPU %d\n", cpuid);
 
     _cpu_id   = cpuid;
+    _core_mask = core_mask;
     _n_input  = n_input;
     _n_output = n_output;
 
@@ -64,6 +65,18 @@ rknn_fp::rknn_fp(const char *model_path, int cpuid, rknn_core_mask core_mask,
 	printf("api version: %s\n", version.api_version);
 	printf("driver version: %s\n", version.drv_version);
 
+	// 以模型实际的输出个数为准
+	rknn_input_output_num io_num;
+	ret = rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
+	if (ret == RKNN_SUCC && (int)io_num.n_output != _n_output) {
+		printf("model has %d outputs (expected %d)\n", io_num.n_output, _n_output);
+		_n_output = io_num.n_output;
+	}
+	if (_n_output > RKNN_MAX_OUTPUT) {
+		printf("too many outputs: %d > %d\n", _n_output, RKNN_MAX_OUTPUT);
+		exit(-1);
+	}
+
     // rknn inputs
 	printf("input tensors:\n");
 	memset(_input_attrs, 0, _n_input * sizeof(rknn_tensor_attr));
@@ -78,12 +91,33 @@ rknn_fp::rknn_fp(const char *model_path, int cpuid, rknn_core_mask core_mask,
 		dump_tensor_attr(&_input_attrs[i]);
 	}
 
+	// 动态形状模型: 记下支持的输入尺寸, 内存按最大的分配
+	float max_area_ratio = 1.f;
+	rknn_input_range range;
+	memset(&range, 0, sizeof(range));
+	range.index = 0;
+	ret = rknn_query(ctx, RKNN_QUERY_INPUT_DYNAMIC_RANGE, &range, sizeof(range));
+	if (ret == RKNN_SUCC && range.shape_number > 1) {
+		int hi = range.fmt == RKNN_TENSOR_NCHW ? 2 : 1;
+		float area = (float)_input_attrs[0].dims[1] * _input_attrs[0].dims[2];
+		printf("dynamic input shapes:");
+		for (uint32_t i = 0; i < range.shape_number; i++) {
+			int h = range.dyn_range[i][hi], w = range.dyn_range[i][hi + 1];
+			input_sizes.push_back(std::make_pair(h, w));
+			if (h * w / area > max_area_ratio)
+				max_area_ratio = h * w / area;
+			printf(" %dx%d", w, h);
+		}
+		printf("\n");
+	}
+
 	// Create input tensor memory
 	rknn_tensor_type   input_type   = RKNN_TENSOR_UINT8; // default input type is int8 (normalize and quantize need compute in outside)
 	rknn_tensor_format input_layout = RKNN_TENSOR_NHWC; // default fmt is NHWC, npu only support NHWC in zero copy mode
 	_input_attrs[0].type = input_type;
 	_input_attrs[0].fmt = input_layout;
-	_input_mems[0] = rknn_create_mem(ctx, _input_attrs[0].size_with_stride);
+	_input_mems[0] = rknn_create_mem(ctx, _input_attrs[0].size_with_stride * max_area_ratio);
+	update_input_layout();
 
 	// rknn outputs
 	printf("output tensors:\n");
@@ -103,7 +137,7 @@ rknn_fp::rknn_fp(const char *model_path, int cpuid, rknn_core_mask core_mask,
 	for (uint32_t i = 0; i < _n_output; ++i) {
 		// default output type is depend on model, this require float32 to compute top5
 		// allocate float32 output tensor
-		int output_size = _output_attrs[i].n_elems * sizeof(float);
+		int output_size = _output_attrs[i].n_elems * sizeof(float) * max_area_ratio;
 		_output_mems[i]  = rknn_create_mem(ctx, output_size);
 	}
 
@@ -128,6 +162,61 @@ rknn_fp::rknn_fp(const char *model_path, int cpuid, rknn_core_mask core_mask,
 	}
 }
 
+int rknn_fp::set_input_size(int h, int w)
+{
+	if (input_h() == h && input_w() == w)
+		return 0;
+	bool supported = false;
+	for (size_t i = 0; i < input_sizes.size(); i++)
+		supported = supported || (input_sizes[i].first == h && input_sizes[i].second == w);
+	if (!supported)
+		return -1;
+
+	rknn_tensor_attr attr = _input_attrs[0];
+	attr.dims[1] = h;
+	attr.dims[2] = w;
+	int ret = rknn_set_input_shapes(ctx, 1, &attr);
+	if (ret < 0) {
+		printf("rknn_set_input_shapes %dx%d fail! ret=%d\n", w, h, ret);
+		return -1;
+	}
+	// 新形状下的属性, 内存已按最大尺寸分配, 重新绑定即可
+	ret = rknn_query(ctx, RKNN_QUERY_CURRENT_INPUT_ATTR, &_input_attrs[0], sizeof(rknn_tensor_attr));
+	if (ret < 0) {
+		printf("rknn_query current input fail! ret=%d\n", ret);
+		return -1;
+	}
+	_input_attrs[0].type = RKNN_TENSOR_UINT8;
+	_input_attrs[0].fmt = RKNN_TENSOR_NHWC;
+	update_input_layout();
+	ret = rknn_set_io_mem(ctx, _input_mems[0], &_input_attrs[0]);
+	for (int i = 0; ret >= 0 && i < _n_output; ++i) {
+		ret = rknn_query(ctx, RKNN_QUERY_CURRENT_OUTPUT_ATTR, &_output_attrs[i], sizeof(rknn_tensor_attr));
+		if (ret < 0)
+			break;
+		_output_attrs[i].type = RKNN_TENSOR_INT8;
+		ret = rknn_set_io_mem(ctx, _output_mems[i], &_output_attrs[i]);
+	}
+	if (ret < 0) {
+		printf("rebind io mem for %dx%d fail! ret=%d\n", w, h, ret);
+		return -1;
+	}
+	return 0;
+}
+
+void rknn_fp::update_input_layout()
+{
+	const rknn_tensor_attr &attr = _input_attrs[0];
+	if (attr.w_stride == 0 || (int)attr.w_stride == attr.dims[2]) {
+		_input_packed.clear();
+		return;
+	}
+	if (_input_packed.empty())
+		printf("input %dx%d has w_stride %d, rows are copied into the input tensor\n", attr.dims[2], attr.dims[1],
+			   attr.w_stride);
+	_input_packed.resize((size_t)attr.dims[0] * attr.dims[1] * attr.dims[2] * attr.dims[3]);
+}
+
 rknn_fp::~rknn_fp(){
     rknn_destroy(ctx);
 }
@@ -150,7 +239,17 @@ int rknn_fp::inference(unsigned char *data){
     // inputs[0].buf = img.data;
 	int width  = _input_attrs[0].dims[2];
 	// std::cout << "checkpoint in rknn_fp: " << sizeof(data) << " " << width*_input_attrs[0].dims[1]*_input_attrs[0].dims[3] << "\n";
-	memcpy(_input_mems[0]->virt_addr, data, width*_input_attrs[0].dims[1]*_input_attrs[0].dims[3]);
+	int pitch  = width*_input_attrs[0].dims[3];
+	if (!_input_packed.empty()) {
+		// 输入 tensor 的行按 w_stride 对齐, 逐行拷
+		int stride = _input_attrs[0].w_stride*_input_attrs[0].dims[3];
+		unsigned char *dst = (unsigned char *)_input_mems[0]->virt_addr;
+		for (int r = 0; r < _input_attrs[0].dims[0]*_input_attrs[0].dims[1]; r++)
+			memcpy(dst + (size_t)r*stride, data + (size_t)r*pitch, pitch);
+	}
+	// 数据已直接写在输入tensor里时不用拷贝
+	else if (data != _input_mems[0]->virt_addr)
+		memcpy(_input_mems[0]->virt_addr, data, _input_attrs[0].dims[0]*_input_attrs[0].dims[1]*pitch);
 	// std::cout << "checkpoint in rknn_fp\n";
 	// if(img.data) free(img.data);
 	unsigned char * buff = (unsigned char *)_input_mems[0]->virt_addr;
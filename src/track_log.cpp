@@ -0,0 +1,209 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "mytime.h"
+#include "track_log.h"
+
+bool TrackLogWriter::open(const char *path)
+{
+    close();
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return false;
+    }
+    track_log_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACKLOG_MAGIC, sizeof(TRACKLOG_MAGIC));
+    header.version = TRACKLOG_VERSION;
+    header.record_bytes = sizeof(track_record);
+    header.index_interval = TRACKLOG_INDEX_INTERVAL;
+    header.created_ms = what_time_is_it_now();
+    offset = sizeof(header);
+    last_index = 0;
+    frames = records = 0;
+    pending.clear();
+    return fwrite(&header, sizeof(header), 1, fp) == 1;
+}
+
+bool TrackLogWriter::write(int64_t frame, double pts_ms, const track_record *recs, int count)
+{
+    if (fp == NULL)
+        return false;
+    track_frame_header fh = {TRACKLOG_FRAME_TAG, (uint32_t)count, frame, pts_ms};
+    if (fwrite(&fh, sizeof(fh), 1, fp) != 1 || (count > 0 && fwrite(recs, sizeof(track_record), count, fp) != (size_t)count))
+        return false;
+    track_index_entry e = {frame, pts_ms, offset};
+    pending.push_back(e);
+    offset += sizeof(fh) + (uint64_t)count * sizeof(track_record);
+    frames++;
+    records += count;
+    if (pending.size() >= TRACKLOG_INDEX_INTERVAL)
+        return flush_index();
+    return true;
+}
+
+// 写一个索引块并刷到文件, 其他进程这时就能读到这部分
+bool TrackLogWriter::flush_index()
+{
+    if (pending.empty())
+        return true;
+    track_index_header ih = {TRACKLOG_INDEX_TAG, (uint32_t)pending.size(), last_index};
+    if (fwrite(&ih, sizeof(ih), 1, fp) != 1 || fwrite(&pending[0], sizeof(track_index_entry), pending.size(), fp) != pending.size())
+        return false;
+    last_index = offset;
+    offset += sizeof(ih) + pending.size() * sizeof(track_index_entry);
+    pending.clear();
+    fflush(fp);
+    return true;
+}
+
+void TrackLogWriter::close()
+{
+    if (fp == NULL)
+        return;
+    flush_index();
+    track_log_trailer tr = {TRACKLOG_END_TAG, 0, last_index};
+    fwrite(&tr, sizeof(tr), 1, fp);
+    fclose(fp);
+    fp = NULL;
+}
+
+bool TrackLogReader::open(const char *path)
+{
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("open %s fail!\n", path);
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    map_len = st.st_size;
+    void *p = map_len >= sizeof(track_log_header) ? mmap(NULL, map_len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        printf("track log: mmap %s fail\n", path);
+        map_len = 0;
+        return false;
+    }
+    map = (const uint8_t *)p;
+    const track_log_header &h = header();
+    if (memcmp(h.magic, TRACKLOG_MAGIC, sizeof(TRACKLOG_MAGIC)) != 0 || h.record_bytes != sizeof(track_record)) {
+        printf("%s is not a track log (version %u)\n", path, h.version);
+        close();
+        return false;
+    }
+
+    const track_log_trailer *tr = NULL;
+    if (map_len >= sizeof(track_log_header) + sizeof(track_log_trailer))
+        tr = (const track_log_trailer *)(map + map_len - sizeof(track_log_trailer));
+    if (tr != NULL && tr->tag == TRACKLOG_END_TAG) {
+        end = map_len - sizeof(track_log_trailer);
+        recovered = !load_index(tr->last_index);
+    }
+    else {
+        recovered = true;
+    }
+    if (recovered)
+        scan_index();
+    rewind();
+    return true;
+}
+
+void TrackLogReader::close()
+{
+    if (map != NULL)
+        munmap((void *)map, map_len);
+    map = NULL;
+    map_len = 0;
+    end = pos = 0;
+    recovered = false;
+    index.clear();
+}
+
+// 沿 prev 从最后一个索引块往前走, 各块的条目按文件顺序拼起来
+bool TrackLogReader::load_index(uint64_t last_index)
+{
+    std::vector<uint64_t> blocks;
+    for (uint64_t off = last_index; off != 0;) {
+        if (off < sizeof(track_log_header) || off + sizeof(track_index_header) > end)
+            return false;
+        const track_index_header *ih = (const track_index_header *)(map + off);
+        if (ih->tag != TRACKLOG_INDEX_TAG || off + sizeof(*ih) + (uint64_t)ih->count * sizeof(track_index_entry) > end ||
+            ih->prev >= off)
+            return false;
+        blocks.push_back(off);
+        off = ih->prev;
+    }
+    index.clear();
+    for (size_t i = blocks.size(); i-- > 0;) {
+        const track_index_header *ih = (const track_index_header *)(map + blocks[i]);
+        const track_index_entry *e = (const track_index_entry *)(ih + 1);
+        index.insert(index.end(), e, e + ih->count);
+    }
+    return true;
+}
+
+// 写入中断的日志: 顺序跳过各块, 只看块头, 到第一个不完整的块为止
+void TrackLogReader::scan_index()
+{
+    index.clear();
+    uint64_t off = sizeof(track_log_header);
+    while (off + sizeof(uint32_t) * 2 <= map_len) {
+        uint32_t tag = *(const uint32_t *)(map + off);
+        uint32_t count = *(const uint32_t *)(map + off + sizeof(uint32_t));
+        uint64_t size;
+        if (tag == TRACKLOG_FRAME_TAG)
+            size = sizeof(track_frame_header) + (uint64_t)count * sizeof(track_record);
+        else if (tag == TRACKLOG_INDEX_TAG)
+            size = sizeof(track_index_header) + (uint64_t)count * sizeof(track_index_entry);
+        else
+            break;
+        if (off + size > map_len)
+            break;
+        if (tag == TRACKLOG_FRAME_TAG) {
+            const track_frame_header *fh = (const track_frame_header *)(map + off);
+            track_index_entry e = {fh->frame, fh->pts_ms, off};
+            index.push_back(e);
+        }
+        off += size;
+    }
+    end = off;
+}
+
+void TrackLogReader::seek(double t_ms)
+{
+    std::vector<track_index_entry>::const_iterator it = std::lower_bound(
+        index.begin(), index.end(), t_ms, [](const track_index_entry &e, double t) { return e.pts_ms < t; });
+    pos = it == index.end() ? end : it->offset;
+}
+
+bool TrackLogReader::next(frame_view &f)
+{
+    while (pos + sizeof(track_index_header) <= end) {
+        uint32_t tag = *(const uint32_t *)(map + pos);
+        if (tag == TRACKLOG_INDEX_TAG) {
+            const track_index_header *ih = (const track_index_header *)(map + pos);
+            pos += sizeof(*ih) + (uint64_t)ih->count * sizeof(track_index_entry);
+            continue;
+        }
+        if (tag != TRACKLOG_FRAME_TAG || pos + sizeof(track_frame_header) > end)
+            return false;
+        const track_frame_header *fh = (const track_frame_header *)(map + pos);
+        uint64_t size = sizeof(*fh) + (uint64_t)fh->count * sizeof(track_record);
+        if (pos + size > end)
+            return false;
+        f.frame = fh->frame;
+        f.pts_ms = fh->pts_ms;
+        f.count = fh->count;
+        f.records = (const track_record *)(fh + 1);
+        pos += size;
+        return true;
+    }
+    return false;
+}
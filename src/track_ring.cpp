@@ -0,0 +1,245 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "mytime.h"
+#include "track_ring.h"
+
+// 跨进程, 不能用 FUTEX_PRIVATE_FLAG
+static long futex_wait(std::atomic<uint32_t> *addr, uint32_t expected, const timespec *timeout)
+{
+    return syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t> *addr)
+{
+    syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static size_t slot_bytes(int max_records)
+{
+    return (sizeof(track_ring_slot) + (size_t)max_records * sizeof(track_record) + 63) & ~(size_t)63;
+}
+
+// 让映射着旧对象的读者知道要重新打开: 标记结束并改 generation, 叫醒等着的
+static void retire_ring(int fd, size_t len)
+{
+    if (len < sizeof(track_ring_header))
+        return;
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return;
+    track_ring_header *old = (track_ring_header *)p;
+    if (memcmp(old->magic, TRACKRING_MAGIC, sizeof(TRACKRING_MAGIC)) == 0) {
+        old->generation = what_time_is_it_now();
+        old->closed.store(1);
+        old->futex.fetch_add(1);
+        futex_wake(&old->futex);
+    }
+    munmap(p, len);
+}
+
+bool TrackRingWriter::open(const char *name, int slots, int max_records)
+{
+    close();
+    size_t sb = slot_bytes(max_records);
+    map_len = sizeof(track_ring_header) + sb * slots;
+    // 已有的对象大小不同时不能 ftruncate: 读者还映射着, 缩小后读者访问到末尾外会 SIGBUS
+    // 让旧对象失效并删掉名字, 另建一个; 读者重新打开时拿到新的, 旧的在最后一个读者 munmap 后释放
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size != map_len) {
+            printf("track ring: %s is %ld bytes, recreating with %lu\n", name, (long)st.st_size, (unsigned long)map_len);
+            retire_ring(fd, st.st_size);
+            ::close(fd);
+            shm_unlink(name);
+            fd = -1;
+        }
+    }
+    if (fd < 0)
+        fd = shm_open(name, O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        printf("shm_open %s fail!\n", name);
+        map_len = 0;
+        return false;
+    }
+    // umask 可能去掉了其他用户的写权限, 读者要改 waiters
+    fchmod(fd, 0666);
+    void *p = ftruncate(fd, map_len) == 0 ? mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        printf("track ring: mmap %s fail\n", name);
+        map_len = 0;
+        return false;
+    }
+    hdr = (track_ring_header *)p;
+
+    // 先废掉 magic, 重启时还连着的读者在初始化期间不会当成有效的环
+    memset(hdr->magic, 0, sizeof(hdr->magic));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    hdr->version = TRACKRING_VERSION;
+    hdr->record_bytes = sizeof(track_record);
+    hdr->slots = slots;
+    hdr->max_records = max_records;
+    hdr->slot_bytes = sb;
+    hdr->writer_pid = getpid();
+    hdr->generation = what_time_is_it_now();
+    hdr->head.store(0);
+    hdr->closed.store(0);
+    for (int i = 0; i < slots; i++) {
+        track_ring_slot *s = slot(i);
+        s->seq.store(0);
+        s->count = 0;
+        s->index = UINT64_MAX;
+    }
+    truncated = 0;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    memcpy(hdr->magic, TRACKRING_MAGIC, sizeof(TRACKRING_MAGIC));
+    // 叫醒重启前就在等的读者, 让它们发现 generation 变了
+    hdr->futex.fetch_add(1);
+    futex_wake(&hdr->futex);
+    printf("track ring: /dev/shm%s, %d slots x %d records\n", name, slots, max_records);
+    return true;
+}
+
+track_ring_slot *TrackRingWriter::slot(uint64_t index)
+{
+    return (track_ring_slot *)((uint8_t *)(hdr + 1) + (size_t)(index % hdr->slots) * hdr->slot_bytes);
+}
+
+void TrackRingWriter::write(int64_t frame, double pts_ms, const track_record *records, int count)
+{
+    if (hdr == NULL)
+        return;
+    uint64_t index = hdr->head.load(std::memory_order_relaxed);
+    track_ring_slot *s = slot(index);
+    uint32_t seq = s->seq.load(std::memory_order_relaxed);
+    s->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    int n = std::min(count, (int)hdr->max_records);
+    s->count = n;
+    s->index = index;
+    s->frame = frame;
+    s->pts_ms = pts_ms;
+    s->truncated = count - n;
+    if (n > 0)
+        memcpy((track_record *)(s + 1), records, n * sizeof(track_record));
+    truncated += count - n;
+
+    s->seq.store(seq + 2, std::memory_order_release);
+    hdr->head.store(index + 1, std::memory_order_release);
+    hdr->futex.fetch_add(1);
+    if (hdr->waiters.load() > 0)
+        futex_wake(&hdr->futex);
+}
+
+void TrackRingWriter::close()
+{
+    if (hdr == NULL)
+        return;
+    hdr->closed.store(1);
+    hdr->futex.fetch_add(1);
+    futex_wake(&hdr->futex);
+    if (truncated > 0)
+        printf("track ring: %lu records truncated (more than %u per frame)\n", (unsigned long)truncated,
+               hdr->max_records);
+    munmap(hdr, map_len);
+    hdr = NULL;
+    map_len = 0;
+}
+
+bool TrackRingReader::open(const char *name)
+{
+    close();
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    fstat(fd, &st);
+    map_len = st.st_size;
+    void *p = map_len >= sizeof(track_ring_header) ? mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                                   : MAP_FAILED;
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        map_len = 0;
+        return false;
+    }
+    hdr = (track_ring_header *)p;
+    if (memcmp(hdr->magic, TRACKRING_MAGIC, sizeof(TRACKRING_MAGIC)) != 0 || hdr->version != TRACKRING_VERSION ||
+        hdr->record_bytes != sizeof(track_record) ||
+        map_len < sizeof(track_ring_header) + (size_t)hdr->slots * hdr->slot_bytes) {
+        close();
+        return false;
+    }
+    // 布局按打开时的记下, 之后头被改写 (写者重启) 也不会按新的 slots 算到映射外面
+    generation = hdr->generation;
+    slots = hdr->slots;
+    slot_size = hdr->slot_bytes;
+    max_records = hdr->max_records;
+    return true;
+}
+
+bool TrackRingReader::writer_restarted() const
+{
+    return hdr->generation != generation || hdr->slots != slots || hdr->slot_bytes != slot_size
+        || hdr->max_records != max_records;
+}
+
+void TrackRingReader::close()
+{
+    if (hdr == NULL)
+        return;
+    munmap(hdr, map_len);
+    hdr = NULL;
+    map_len = 0;
+}
+
+const track_ring_slot *TrackRingReader::slot(uint64_t index) const
+{
+    return (const track_ring_slot *)((const uint8_t *)(hdr + 1) + (size_t)(index % slots) * slot_size);
+}
+
+bool TrackRingReader::read(uint64_t index, frame_data &f) const
+{
+    return visit(index, [&](const track_ring_slot &s, const track_record *records, int count) {
+        f.index = index;
+        f.frame = s.frame;
+        f.pts_ms = s.pts_ms;
+        f.truncated = s.truncated;
+        f.records.assign(records, records + count);
+    });
+}
+
+int TrackRingReader::wait(uint64_t index, int timeout_ms) const
+{
+    double deadline = what_time_is_it_now() + timeout_ms;
+    while (1) {
+        if (head() > index)
+            return 1;
+        if (writer_closed() || writer_restarted())
+            return -1;
+        double left = deadline - what_time_is_it_now();
+        if (left <= 0)
+            return 0;
+        // 先登记再看 head: 写者要么看到 waiters 而 FUTEX_WAKE, 要么它的新帧在这里已经可见 (futex 值也变了, WAIT 立即返回)
+        hdr->waiters.fetch_add(1);
+        uint32_t word = hdr->futex.load();
+        if (head() <= index && !writer_closed()) {
+            timespec ts;
+            ts.tv_sec = (time_t)(left / 1000);
+            ts.tv_nsec = (long)((left - ts.tv_sec * 1000.0) * 1e6);
+            futex_wait(&hdr->futex, word, &ts);
+        }
+        hdr->waiters.fetch_sub(1);
+    }
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(int n_threads, const std::vector<int> &cpus)
+    : task(NULL), next(0), total(0), pending(0), generation(0), stop(false)
+{
+    for (int i = 0; i < n_threads; i++)
+        threads.emplace_back(&WorkerPool::worker, this, cpus.empty() ? -1 : cpus[i % cpus.size()]);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    cv_task.notify_all();
+    for (std::thread &t : threads)
+        t.join();
+}
+
+void WorkerPool::parallel_for(int n, const std::function<void(int)> &fn)
+{
+    if (threads.empty() || n <= 1) {
+        for (int i = 0; i < n; i++) fn(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        task = &fn;
+        total = n;
+        next = 0;
+        pending = threads.size();
+        generation++;
+    }
+    cv_task.notify_all();
+
+    for (int i = next++; i < n; i = next++)
+        fn(i);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_done.wait(lock, [this] { return pending == 0; });
+    task = NULL;
+}
+
+void WorkerPool::worker(int cpuid)
+{
+    if (cpuid >= 0) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpuid, &mask);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) < 0)
+            std::cerr << "set thread affinity failed" << std::endl;
+    }
+    unsigned seen = 0;
+    while (1) {
+        const std::function<void(int)> *fn;
+        int n;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_task.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) break;
+            seen = generation;
+            fn = task;
+            n = total;
+        }
+        for (int i = next++; i < n; i = next++)
+            (*fn)(i);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending--;
+        }
+        cv_done.notify_one();
+    }
+}
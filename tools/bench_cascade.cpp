@@ -0,0 +1,169 @@
+/*---------------------------------------------------------
+    级联检测调度基准 (模拟后端, 不需要 NPU)
+    合成一段多目标运动的场景, 用两个模拟检测器代替 RKNN 模型:
+        完整模型: 耗时长, 找到所有目标
+        小模型:   耗时短, 漏掉小目标, 光照变差的片段置信度下降
+    分别按 "每帧完整模型" / "每帧小模型" / 级联 (CascadeScheduler) 调度,
+    统计每帧的模拟 NPU 耗时与召回率
+    用法:
+        bench_cascade [--frames N] [--objects K] [--full-ms T] [--lite-ms T] [--lag F]
+    lag: 检测结果晚几帧才回到调度器 (流水线里约为检测线程数)
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <deque>
+#include <vector>
+
+#include "mytime.h"
+#include "cascade.h"
+
+#define SCENE_W 1920
+#define SCENE_H 1080
+
+struct object_t {
+    float x, y, vx, vy, size;
+};
+
+struct mock_model {
+    const char *name;
+    float latency_ms;   // 一次推理的模拟耗时
+    float min_size;     // 小于该尺寸的目标找不到
+    float conf;         // 正常光照下的置信度
+    float dark_conf;    // 光照变差的片段里的置信度
+};
+
+// 确定性的伪随机, 各次运行结果相同
+static float hash01(unsigned a, unsigned b)
+{
+    unsigned h = a * 2654435761u ^ (b + 0x9e3779b9u) * 40503u;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+    return (h & 0xffff) / 65536.f;
+}
+
+static void step_scene(std::vector<object_t> &objs)
+{
+    for (object_t &o : objs) {
+        o.x += o.vx;
+        o.y += o.vy;
+        if (o.x < 0 || o.x + o.size > SCENE_W) o.vx = -o.vx;
+        if (o.y < 0 || o.y + o.size > SCENE_H) o.vy = -o.vy;
+    }
+}
+
+// 每 300 帧里有 40 帧光照变差
+static bool dark(int frame)
+{
+    return frame % 300 >= 200 && frame % 300 < 240;
+}
+
+static void mock_detect(const mock_model &m, const std::vector<object_t> &objs, int frame, detect_result_group_t &out)
+{
+    out.id = frame;
+    out.results.clear();
+    for (size_t i = 0; i < objs.size(); i++) {
+        const object_t &o = objs[i];
+        float jitter = 0.1f * (hash01(frame, i) - 0.5f);
+        float conf = (dark(frame) ? m.dark_conf : m.conf) + jitter;
+        if (o.size < m.min_size || conf < BOX_THRESH)
+            continue;
+        DetectBox b(o.x, o.y, o.x + o.size, o.y + o.size * 2, conf);
+        b.classID = i;  // 模拟里用类别号记目标编号, 统计召回
+        out.results.push_back(b);
+    }
+    out.count = out.results.size();
+}
+
+struct run_stats {
+    double npu_ms;
+    int found;
+    int total;
+    int full;
+    double sched_ns;
+};
+
+// mode: 0 每帧完整模型, 1 每帧小模型, 2 级联
+static run_stats run(int mode, int frames, int n_objects, const mock_model models[2], int lag)
+{
+    std::vector<object_t> objs;
+    for (int i = 0; i < n_objects; i++) {
+        object_t o;
+        o.size = 12 + 100 * hash01(i, 1);  // 约 1/4 是小目标
+        o.x = (SCENE_W - o.size) * hash01(i, 2);
+        o.y = (SCENE_H - 2 * o.size) * hash01(i, 3);
+        o.vx = 6 * (hash01(i, 4) - 0.5f);
+        o.vy = 4 * (hash01(i, 5) - 0.5f);
+        objs.push_back(o);
+    }
+    CascadeScheduler sched;
+    sched.set_lite_input(320, 320);
+    run_stats s = {0, 0, 0, 0, 0};
+    // 还没回到调度器的结果 (模拟多个检测线程并行)
+    struct pending_t { int frame; int model; detect_result_group_t dets; };
+    std::deque<pending_t> pending;
+    for (int f = 0; f < frames; f++) {
+        int model = mode == 0 ? CASCADE_FULL : CASCADE_LITE;
+        if (mode == 2) {
+            double t0 = what_time_is_it_now_ns();
+            model = sched.choose(f);
+            s.sched_ns += what_time_is_it_now_ns() - t0;
+        }
+        pending_t p;
+        p.frame = f;
+        p.model = model;
+        mock_detect(models[model], objs, f, p.dets);
+        s.npu_ms += models[model].latency_ms;
+        s.full += model == CASCADE_FULL;
+        s.found += p.dets.results.size();
+        s.total += objs.size();
+        pending.push_back(p);
+        while ((int)pending.size() > lag) {
+            if (mode == 2) {
+                double t0 = what_time_is_it_now_ns();
+                sched.report(pending.front().frame, pending.front().model, pending.front().dets);
+                s.sched_ns += what_time_is_it_now_ns() - t0;
+            }
+            pending.pop_front();
+        }
+        step_scene(objs);
+    }
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = 3000, n_objects = 12, lag = 2;
+    mock_model models[2] = {
+        {"full", 25.f, 0.f, 0.80f, 0.70f},
+        {"lite", 7.f, 40.f, 0.70f, 0.35f},
+    };
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--objects") && i + 1 < argc) n_objects = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--full-ms") && i + 1 < argc) models[CASCADE_FULL].latency_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lite-ms") && i + 1 < argc) models[CASCADE_LITE].latency_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--lag") && i + 1 < argc) lag = atoi(argv[++i]);
+        else {
+            printf("usage: %s [--frames N] [--objects K] [--full-ms T] [--lite-ms T] [--lag F]\n", argv[0]);
+            return -1;
+        }
+    }
+    printf("%d frames, %d objects, full %.1f ms, lite %.1f ms, result lag %d frames\n", frames, n_objects,
+           models[CASCADE_FULL].latency_ms, models[CASCADE_LITE].latency_ms, lag);
+
+    const char *names[3] = {"full only", "lite only", "cascade"};
+    run_stats base = run(0, frames, n_objects, models, lag);
+    for (int mode = 0; mode < 3; mode++) {
+        run_stats s = mode == 0 ? base : run(mode, frames, n_objects, models, lag);
+        printf("%-10s NPU %6.2f ms/frame (%5.1f%% of full)  recall %5.1f%%  full model on %5.1f%% of frames",
+               names[mode], s.npu_ms / frames, 100.0 * s.npu_ms / base.npu_ms, 100.0 * s.found / s.total,
+               100.0 * s.full / frames);
+        if (mode == 2)
+            printf("  scheduler %.0f ns/frame", s.sched_ns / frames);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,433 @@
+/*---------------------------------------------------------
+    后处理回放基准
+    回放 CORPUS_SAVEPATH 记录的检测头输出, 对比 golden 结果并统计各阶段耗时
+    用法:
+        bench_postprocess <corpus.bin> <golden.txt> [--write-golden] [--iters N] [--tol PX]
+        bench_postprocess synth:<kind> <golden.txt> [--frames N] ...
+    synth: 不用板子和模型, 按固定种子合成检测头输出 (见 synth_corpus), kind 为 yolov5-i8 / yolov5-fp / yolov8-i8 / yolov8-fp
+           tools/data/synth_<kind>.golden 为对应的 golden, ctest 用它检查 decoder 的改动
+    golden 为文本, 每帧:
+        frame <id> <count>
+        <x1> <y1> <x2> <y2> <conf> <class>
+    坐标为网络输入坐标 (不做 letterbox 还原)
+    int8 模型额外跑一遍定点路径 (post_process_fixed), 与浮点路径在 tol 内比对
+    在 A55 小核上对比: taskset -c 0 ./bench_postprocess ...
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "decode.h"
+#include "decoder.h"
+#include "tensor_corpus.h"
+
+struct corpus_frame {
+    int id;
+    std::vector<std::vector<int8_t> > outputs;
+    std::vector<void *> ptrs;
+};
+
+// 固定种子, 各平台结果一致
+struct synth_rng {
+    uint32_t x = 2463534242u;
+    uint32_t next()
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+    float uniform(float lo, float hi) { return lo + (hi - lo) * (next() >> 8) * (1.0f / (1 << 24)); }
+    int below(int n) { return next() % n; }
+};
+
+static void synth_attr(rknn_tensor_attr &attr, int index, int c, int h, int w, bool quant, int32_t zp, float scale)
+{
+    memset(&attr, 0, sizeof(attr));
+    attr.index = index;
+    attr.n_dims = 4;
+    attr.dims[0] = 1;
+    attr.dims[1] = c;
+    attr.dims[2] = h;
+    attr.dims[3] = w;
+    attr.n_elems = c * h * w;
+    attr.fmt = RKNN_TENSOR_NCHW;
+    attr.type = quant ? RKNN_TENSOR_INT8 : RKNN_TENSOR_FLOAT32;
+    attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    attr.zp = zp;
+    attr.scale = scale;
+    attr.size = attr.n_elems * (quant ? 1 : sizeof(float));
+}
+
+// 合成输出里的一个 tensor: 先按浮点填, 最后按 attr 量化或原样存
+struct synth_tensor {
+    const rknn_tensor_attr *attr;
+    std::vector<float> v;
+    float &at(int ch, int i, int j) { return v[((size_t)ch * attr->dims[2] + i) * attr->dims[3] + j]; }
+    void store(std::vector<int8_t> &out) const
+    {
+        if (attr->type == RKNN_TENSOR_FLOAT32) {
+            out.resize(v.size() * sizeof(float));
+            memcpy(out.data(), v.data(), out.size());
+            return;
+        }
+        out.resize(v.size());
+        for (size_t k = 0; k < v.size(); k++)
+            out[k] = qnt_f32_to_affine(v[k], attr->zp, attr->scale);
+    }
+};
+
+/*
+    合成 640x640 的 80 类 yolov5 (3 头 x 3 anchor) / yolov8 (3 头, reg_max 16, 带 score_sum) 输出
+    每帧 SYNTH_OBJECTS 个目标放在随机的头/格子上, 每个再在右边的格子放一个分数稍低、大体重合的框, 让 NMS 有活干
+    其余格子为阈值以下的背景
+    yolov5: int8 的 xywh 为 sigmoid 之后的值, float 为 sigmoid 之前 (与两条解码路径一致); 置信度/类别都是 logit
+    yolov8: 框为 DFL 的 bin logit, 类别为概率
+*/
+#define SYNTH_SIZE     640
+#define SYNTH_CLASSES  80
+#define SYNTH_OBJECTS  6
+#define SYNTH_REG      16
+
+static bool synth_corpus(const std::string &kind, int n_frames, rknn_tensor_attr &input_attr,
+                         std::vector<rknn_tensor_attr> &output_attrs, std::vector<corpus_frame> &frames)
+{
+    bool v8 = kind == "yolov8-i8" || kind == "yolov8-fp";
+    bool quant = kind == "yolov5-i8" || kind == "yolov8-i8";
+    if (!v8 && kind != "yolov5-fp" && !quant) {
+        printf("unknown synth kind %s\n", kind.c_str());
+        return false;
+    }
+    memset(&input_attr, 0, sizeof(input_attr));
+    input_attr.n_dims = 4;
+    input_attr.dims[0] = 1;
+    input_attr.dims[1] = SYNTH_SIZE;
+    input_attr.dims[2] = SYNTH_SIZE;
+    input_attr.dims[3] = 3;
+    input_attr.fmt = RKNN_TENSOR_NHWC;
+    input_attr.type = RKNN_TENSOR_UINT8;
+    input_attr.size = SYNTH_SIZE * SYNTH_SIZE * 3;
+
+    output_attrs.clear();
+    for (int h = 0; h < 3; h++) {
+        int g = SYNTH_SIZE / (8 << h);
+        rknn_tensor_attr attr;
+        if (v8) {
+            synth_attr(attr, output_attrs.size(), 4 * SYNTH_REG, g, g, quant, 0, 1.0f / 8);
+            output_attrs.push_back(attr);
+            synth_attr(attr, output_attrs.size(), SYNTH_CLASSES, g, g, quant, -128, 1.0f / 255);
+            output_attrs.push_back(attr);
+            synth_attr(attr, output_attrs.size(), 1, g, g, quant, -128, 1.0f / 32);
+            output_attrs.push_back(attr);
+        }
+        else {
+            synth_attr(attr, output_attrs.size(), 3 * (5 + SYNTH_CLASSES), g, g, quant, 0, 1.0f / 16);
+            output_attrs.push_back(attr);
+        }
+    }
+
+    synth_rng rng;
+    std::vector<synth_tensor> t(output_attrs.size());
+    frames.clear();
+    for (int f = 0; f < n_frames; f++) {
+        for (size_t o = 0; o < t.size(); o++) {
+            t[o].attr = &output_attrs[o];
+            t[o].v.assign(output_attrs[o].n_elems, 0);
+        }
+        if (v8) {
+            for (int h = 0; h < 3; h++) {
+                for (float &x : t[h * 3].v) x = rng.uniform(-2, 2);
+                for (float &x : t[h * 3 + 1].v) x = rng.uniform(0, 0.05f);
+            }
+            for (int k = 0; k < SYNTH_OBJECTS; k++) {
+                int h = rng.below(3), g = SYNTH_SIZE / (8 << h);
+                int i = rng.below(g), j = rng.below(g - 1), c = rng.below(SYNTH_CLASSES);
+                float prob = rng.uniform(0.5f, 0.95f);
+                int dist[4];
+                for (int b = 0; b < 4; b++)
+                    dist[b] = 1 + rng.below(6);
+                for (int dup = 0; dup < 2; dup++) {
+                    // 右边一格的重复框: 左边远一格, 右边近一格, 与原框基本重合
+                    int d[4] = {dist[0] + dup, dist[1], std::max(dist[2] - dup, 0), dist[3]};
+                    for (int b = 0; b < 4; b++)
+                        for (int r = 0; r < SYNTH_REG; r++)
+                            t[h * 3].at(b * SYNTH_REG + r, i, j + dup) = r == d[b] ? 4.f : (abs(r - d[b]) == 1 ? 2.f : -2.f);
+                    t[h * 3 + 1].at(c, i, j + dup) = prob - 0.1f * dup;
+                }
+            }
+            // score_sum 为所有类别分数之和
+            for (int h = 0; h < 3; h++) {
+                synth_tensor &cls = t[h * 3 + 1], &sum = t[h * 3 + 2];
+                int len = sum.v.size();
+                for (int p = 0; p < len; p++) {
+                    float acc = 0;
+                    for (int c = 0; c < SYNTH_CLASSES; c++)
+                        acc += cls.v[(size_t)c * len + p];
+                    sum.v[p] = acc;
+                }
+            }
+        }
+        else {
+            const int box = 5 + SYNTH_CLASSES;
+            for (int h = 0; h < 3; h++) {
+                int len = t[h].v.size() / (3 * box);
+                for (int a = 0; a < 3; a++)
+                    for (int ch = 0; ch < box; ch++)
+                        for (int p = 0; p < len; p++)
+                            t[h].v[((size_t)a * box + ch) * len + p] = ch < 4 ? rng.uniform(0, 1) : rng.uniform(-6, -1);
+            }
+            for (int k = 0; k < SYNTH_OBJECTS; k++) {
+                int h = rng.below(3), g = SYNTH_SIZE / (8 << h);
+                int a = rng.below(3), i = rng.below(g), j = rng.below(g - 1), c = rng.below(SYNTH_CLASSES);
+                float xywh[4] = {rng.uniform(0.5f, 0.7f), rng.uniform(0.3f, 0.7f), rng.uniform(0.4f, 0.8f),
+                                 rng.uniform(0.4f, 0.8f)};
+                float conf = rng.uniform(1.5f, 4), cls = rng.uniform(2, 4);
+                for (int dup = 0; dup < 2; dup++) {
+                    // 右边一格的重复框: x 往回移, 与原框基本重合
+                    t[h].at(a * box + 0, i, j + dup) = xywh[0] - 0.45f * dup;
+                    for (int b = 1; b < 4; b++)
+                        t[h].at(a * box + b, i, j + dup) = xywh[b];
+                    t[h].at(a * box + 4, i, j + dup) = conf - 0.5f * dup;
+                    t[h].at(a * box + 5 + c, i, j + dup) = cls;
+                }
+            }
+            // float 路径的 xywh 在解码时过 sigmoid
+            if (!quant)
+                for (int h = 0; h < 3; h++) {
+                    int len = t[h].v.size() / (3 * box);
+                    for (int a = 0; a < 3; a++)
+                        for (int ch = 0; ch < 4; ch++)
+                            for (int p = 0; p < len; p++) {
+                                float &x = t[h].v[((size_t)a * box + ch) * len + p];
+                                x = unsigmoid(std::min(std::max(x, 0.001f), 0.999f));
+                            }
+                }
+        }
+        corpus_frame frame;
+        frame.id = f;
+        frame.outputs.resize(t.size());
+        for (size_t o = 0; o < t.size(); o++)
+            t[o].store(frame.outputs[o]);
+        frames.push_back(frame);
+    }
+    printf("synthesized %d %s frames\n", n_frames, kind.c_str());
+    return true;
+}
+
+static int write_golden(const char *path, std::vector<corpus_frame> &frames, std::vector<detect_result_group_t> &results)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return -1;
+    }
+    for (size_t f = 0; f < frames.size(); f++) {
+        fprintf(fp, "frame %d %d\n", frames[f].id, (int)results[f].results.size());
+        for (DetectBox &b : results[f].results)
+            fprintf(fp, "%.1f %.1f %.1f %.1f %.6f %d\n", b.x1, b.y1, b.x2, b.y2, b.confidence, (int)b.classID);
+    }
+    fclose(fp);
+    printf("golden written to %s (%d frames)\n", path, (int)frames.size());
+    return 0;
+}
+
+static int read_golden(const char *path, std::vector<detect_result_group_t> &golden)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return -1;
+    }
+    int id, count;
+    while (fscanf(fp, " frame %d %d", &id, &count) == 2) {
+        detect_result_group_t group;
+        group.id = id;
+        group.count = count;
+        for (int i = 0; i < count; i++) {
+            DetectBox b;
+            int cls;
+            if (fscanf(fp, "%f %f %f %f %f %d", &b.x1, &b.y1, &b.x2, &b.y2, &b.confidence, &cls) != 6) {
+                fclose(fp);
+                return -1;
+            }
+            b.classID = cls;
+            group.results.push_back(b);
+        }
+        golden.push_back(group);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static bool same_box(const DetectBox &a, const DetectBox &b, float tol)
+{
+    return fabs(a.x1 - b.x1) <= tol && fabs(a.y1 - b.y1) <= tol && fabs(a.x2 - b.x2) <= tol && fabs(a.y2 - b.y2) <= tol
+        && fabs(a.confidence - b.confidence) <= 1e-3 && (int)a.classID == (int)b.classID;
+}
+
+// 不要求顺序一致 (分数几乎相等的框在定点/浮点下排序可能互换)
+static bool same_set(const std::vector<DetectBox> &a, const std::vector<DetectBox> &b, float tol)
+{
+    if (a.size() != b.size()) return false;
+    std::vector<bool> used(b.size(), false);
+    for (size_t i = 0; i < a.size(); i++) {
+        size_t j = 0;
+        while (j < b.size() && (used[j] || !same_box(a[i], b[j], tol))) j++;
+        if (j == b.size()) return false;
+        used[j] = true;
+    }
+    return true;
+}
+
+// 返回不一致的帧数
+static int compare_golden(std::vector<detect_result_group_t> &results, std::vector<detect_result_group_t> &golden, float tol,
+                          bool ordered = true)
+{
+    int mismatch = 0;
+    if (results.size() != golden.size()) {
+        printf("frame number mismatch: %d vs golden %d\n", (int)results.size(), (int)golden.size());
+        return abs((int)results.size() - (int)golden.size());
+    }
+    for (size_t f = 0; f < results.size(); f++) {
+        std::vector<DetectBox> &a = results[f].results;
+        std::vector<DetectBox> &b = golden[f].results;
+        bool same = a.size() == b.size();
+        if (!ordered)
+            same = same_set(a, b, tol);
+        for (size_t i = 0; ordered && same && i < a.size(); i++)
+            same = same_box(a[i], b[i], tol);
+        if (!same) {
+            if (mismatch < 10)
+                printf("  frame %d: %d boxes, golden %d\n", golden[f].id, (int)a.size(), (int)b.size());
+            mismatch++;
+        }
+    }
+    return mismatch;
+}
+
+static void run_decoder(Decoder *decoder, std::vector<corpus_frame> &frames, std::vector<int32_t> &zps,
+                        std::vector<float> &scales, bool is_quant, bool fixed, int iters,
+                        std::vector<detect_result_group_t> &results)
+{
+    post_process_timing timing;
+    memset(&timing, 0, sizeof(timing));
+    results.assign(frames.size(), detect_result_group_t());
+    for (int it = 0; it < iters; it++) {
+        for (size_t f = 0; f < frames.size(); f++) {
+            if (fixed)
+                post_process_fixed(decoder, (int8_t **)frames[f].ptrs.data(), 0, 0, 1.0, BOX_THRESH, NMS_THRESH,
+                                   zps, scales, &results[f], &timing);
+            else
+                post_process(decoder, frames[f].ptrs.data(), is_quant, 0, 0, 1.0, BOX_THRESH, NMS_THRESH,
+                             zps, scales, &results[f], &timing);
+            results[f].id = frames[f].id;
+        }
+    }
+    double n = (double)iters * frames.size();
+    double total = timing.scan_ns + timing.decode_ns + timing.sort_ns + timing.nms_ns;
+    printf("%-20s %-5s ns/frame: scan %10.0f  decode %8.0f  sort %8.0f  nms %8.0f  total %10.0f  (%.1f candidates/frame)\n",
+           decoder->name(), fixed ? "fixed" : "float", timing.scan_ns / n, timing.decode_ns / n, timing.sort_ns / n, timing.nms_ns / n,
+           total / n, timing.candidates / n);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("usage: %s <corpus.bin | synth:<kind>> <golden.txt> [--write-golden] [--iters N] [--tol PX] [--frames N]\n",
+               argv[0]);
+        return -1;
+    }
+    const char *corpus_path = argv[1];
+    const char *golden_path = argv[2];
+    bool update_golden = false;
+    int iters = 20;
+    int synth_frames = 8;
+    float tol = 1.0;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "--write-golden")) update_golden = true;
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc) iters = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tol") && i + 1 < argc) tol = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) synth_frames = atoi(argv[++i]);
+    }
+
+    std::vector<corpus_frame> frames;
+    rknn_tensor_attr input_attr;
+    std::vector<rknn_tensor_attr> output_attrs;
+    if (!strncmp(corpus_path, "synth:", 6)) {
+        if (!synth_corpus(corpus_path + 6, synth_frames, input_attr, output_attrs, frames))
+            return -1;
+    }
+    else {
+        CorpusReader reader;
+        if (reader.open(corpus_path) < 0)
+            return -1;
+        corpus_frame frame;
+        while (reader.read(frame.id, frame.outputs) == 1) {
+            frames.push_back(frame);
+        }
+        input_attr = reader.input_attr;
+        output_attrs = reader.output_attrs;
+    }
+    for (corpus_frame &f : frames) {
+        for (auto &out : f.outputs)
+            f.ptrs.push_back(out.data());
+    }
+    printf("loaded %d frames, %d outputs\n", (int)frames.size(), (int)output_attrs.size());
+    if (frames.empty())
+        return -1;
+
+    model_meta meta;
+    if (parse_model_meta(&input_attr, output_attrs.data(), output_attrs.size(), meta) < 0)
+        return -1;
+    std::vector<int32_t> zps;
+    std::vector<float> scales;
+    for (rknn_tensor_attr &attr : output_attrs) {
+        zps.push_back(attr.zp);
+        scales.push_back(attr.scale);
+    }
+    bool is_quant = output_attrs[0].type != RKNN_TENSOR_FLOAT32;
+
+    Decoder *decoders[2] = {select_decoder(meta), select_generic_decoder(meta)};
+    std::vector<detect_result_group_t> results[2];
+    for (int d = 0; d < 2; d++) {
+        if (decoders[d] == NULL) return -1;
+        run_decoder(decoders[d], frames, zps, scales, is_quant, false, iters, results[d]);
+    }
+
+    int ret = 0;
+    if (compare_golden(results[1], results[0], 0) != 0) {
+        printf("FAIL: specialized and generic decoders disagree\n");
+        ret = -1;
+    }
+    if (is_quant) {
+        std::vector<detect_result_group_t> results_fixed;
+        run_decoder(decoders[0], frames, zps, scales, is_quant, true, iters, results_fixed);
+        int mismatch = compare_golden(results_fixed, results[0], tol, false);
+        printf("%s: fixed-point path, %d/%d frames differ from float (tol %.1f px)\n", mismatch ? "FAIL" : "PASS",
+               mismatch, (int)frames.size(), tol);
+        if (mismatch) ret = -1;
+    }
+    if (update_golden) {
+        write_golden(golden_path, frames, results[0]);
+    }
+    else {
+        std::vector<detect_result_group_t> golden;
+        if (read_golden(golden_path, golden) < 0) {
+            printf("FAIL: cannot read golden %s\n", golden_path);
+            return -1;
+        }
+        int mismatch = compare_golden(results[0], golden, tol);
+        printf("%s: %d/%d frames differ from golden (tol %.1f px)\n", mismatch ? "FAIL" : "PASS",
+               mismatch, (int)golden.size(), tol);
+        if (mismatch) ret = -1;
+    }
+
+    delete decoders[0];
+    delete decoders[1];
+    return ret;
+}
@@ -0,0 +1,175 @@
+/*---------------------------------------------------------
+    预处理基准
+    合成 NV12 帧, 分别用各后端跑 letterbox / Re-ID 裁剪 / RGB 缩放,
+    统计耗时并与 OpenCV (cvtColor + resize) 参考结果比对
+    用法:
+        bench_preprocess [--backend cpu|rga|auto] [--size WxH] [--iters N] [--tol V]
+    不在板子上时只有 cpu 后端 (rga/auto 会退回 cpu)
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+#include "mytime.h"
+#include "image_processor.h"
+#include "buffer_pool.h"
+
+// 平滑渐变 + 少量纹理, 避免纯色掩盖插值误差
+static cv::Mat synth_nv12(int w, int h)
+{
+    cv::Mat bgr(h, w, CV_8UC3);
+    for (int y = 0; y < h; y++) {
+        uint8_t *p = bgr.ptr<uint8_t>(y);
+        for (int x = 0; x < w; x++) {
+            p[3 * x + 0] = (uint8_t)(x * 255 / w);
+            p[3 * x + 1] = (uint8_t)(y * 255 / h);
+            p[3 * x + 2] = (uint8_t)(128 + 100 * sin(x * 0.05) * cos(y * 0.03));
+        }
+    }
+    // OpenCV 只有 BGR -> I420, 手动交织成 NV12
+    cv::Mat i420;
+    cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+    cv::Mat nv12(h * 3 / 2, w, CV_8UC1);
+    memcpy(nv12.data, i420.data, (size_t)w * h);
+    const uint8_t *u = i420.data + w * h;
+    const uint8_t *v = u + (w / 2) * (h / 2);
+    uint8_t *uv = nv12.data + w * h;
+    for (int i = 0; i < (w / 2) * (h / 2); i++) {
+        uv[2 * i] = u[i];
+        uv[2 * i + 1] = v[i];
+    }
+    return nv12;
+}
+
+static void compare(const char *what, const cv::Mat &out, const cv::Mat &ref, float tol, int &failed)
+{
+    int max_diff = 0;
+    double sum = 0;
+    for (int y = 0; y < out.rows; y++) {
+        const uint8_t *a = out.ptr<uint8_t>(y);
+        const uint8_t *b = ref.ptr<uint8_t>(y);
+        for (int x = 0; x < out.cols * 3; x++) {
+            int d = abs((int)a[x] - (int)b[x]);
+            sum += d;
+            if (d > max_diff)
+                max_diff = d;
+        }
+    }
+    double mean_diff = sum / ((double)out.rows * out.cols * 3);
+    bool ok = mean_diff <= tol;
+    printf("  %-10s vs OpenCV: mean diff %.2f  max diff %d  %s\n", what, mean_diff, max_diff, ok ? "ok" : "FAIL");
+    if (!ok)
+        failed++;
+}
+
+int main(int argc, char **argv)
+{
+    const char *backend = "cpu";
+    int src_w = 1920, src_h = 1080;
+    int iters = 100;
+    float tol = 3.0f;  // 平均误差, 定点权重 + 色度插值方式不同
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--backend") && i + 1 < argc) backend = argv[++i];
+        else if (!strcmp(argv[i], "--size") && i + 1 < argc) sscanf(argv[++i], "%dx%d", &src_w, &src_h);
+        else if (!strcmp(argv[i], "--iters") && i + 1 < argc) iters = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--tol") && i + 1 < argc) tol = atof(argv[++i]);
+        else {
+            printf("usage: %s [--backend cpu|rga|auto] [--size WxH] [--iters N] [--tol V]\n", argv[0]);
+            return -1;
+        }
+    }
+    src_w &= ~1;
+    src_h &= ~1;
+
+    ImageProcessor *pre = create_image_processor(backend);
+    printf("backend %s, source %dx%d NV12, %d iters\n", pre->name(), src_w, src_h, iters);
+
+    cv::Mat nv12 = synth_nv12(src_w, src_h);
+    image_view src = {nv12.data, nv12.data + (size_t)src_w * src_h, src_w, src_h, src_w, IMAGE_NV12};
+    cv::Mat rgb_full;
+    cv::cvtColor(nv12, rgb_full, cv::COLOR_YUV2RGB_NV12);
+    int failed = 0;
+
+    // 1. 检测器输入: 等比 letterbox 到 640x640, 输出缓冲来自池
+    {
+        const int net = 640;
+        letterbox_t lb;
+        letterbox_init(lb, src_w, src_h, net, net, true);
+        BufferPool pool(net * net * 3, [&lb](uint8_t *p) {
+            fill_letterbox_pad(make_image_view(p, lb.dst_w, lb.dst_h, IMAGE_RGB888), lb);
+        });
+        pooled_buffer last;
+        double t0 = what_time_is_it_now_ns();
+        for (int i = 0; i < iters; i++) {
+            pooled_buffer buf = pool.acquire();
+            pre->letterbox(src, make_image_view(buf.get(), net, net, IMAGE_RGB888), lb);
+            last = buf;
+        }
+        double t1 = what_time_is_it_now_ns();
+        printf("letterbox %dx%d -> %dx%d: %8.3f ms/frame, pool allocated %d buffers\n",
+               src_w, src_h, net, net, (t1 - t0) / iters / 1e6, (int)pool.allocated());
+
+        cv::Mat out(net, net, CV_8UC3, last.get());
+        cv::Mat ref(net, net, CV_8UC3, cv::Scalar(LETTERBOX_PAD_VALUE, LETTERBOX_PAD_VALUE, LETTERBOX_PAD_VALUE));
+        cv::Mat content = ref(cv::Rect(lb.pad_left, lb.pad_top, lb.resize_w, lb.resize_h));
+        cv::resize(rgb_full, content, content.size(), 0, 0, cv::INTER_LINEAR);
+        compare("letterbox", out, ref, tol, failed);
+    }
+
+    // 2. Re-ID: 多个目标框裁剪缩放到 64x128 BGR
+    {
+        const int cw = 64, ch = 128, n = 16;
+        std::vector<image_rect> rects;
+        for (int i = 0; i < n; i++) {
+            image_rect r;
+            r.width = 40 + (i * 37) % 200;
+            r.height = r.width * 2;
+            r.x = (i * 113) % (src_w - r.width);
+            r.y = (i * 71) % (src_h - r.height);
+            rects.push_back(r);
+        }
+        std::vector<uint8_t> crops((size_t)n * cw * ch * 3);
+        double t0 = what_time_is_it_now_ns();
+        for (int i = 0; i < iters; i++)
+            for (int k = 0; k < n; k++)
+                pre->crop(src, rects[k], make_image_view(&crops[(size_t)k * cw * ch * 3], cw, ch, IMAGE_BGR888));
+        double t1 = what_time_is_it_now_ns();
+        printf("crop %d boxes -> %dx%d BGR:      %8.3f ms/frame\n", n, cw, ch, (t1 - t0) / iters / 1e6);
+
+        cv::Mat bgr_full;
+        cv::cvtColor(nv12, bgr_full, cv::COLOR_YUV2BGR_NV12);
+        cv::Mat out(ch * n, cw, CV_8UC3, &crops[0]), ref(ch * n, cw, CV_8UC3);
+        for (int k = 0; k < n; k++) {
+            // 与实现一致: NV12 裁剪起点向下取偶数, 宽高随之加长
+            const image_rect &c = rects[k];
+            cv::Rect r(c.x & ~1, c.y & ~1, c.width + (c.x & 1), c.height + (c.y & 1));
+            cv::Mat dst = ref(cv::Rect(0, k * ch, cw, ch));
+            cv::resize(bgr_full(r), dst, dst.size(), 0, 0, cv::INTER_LINEAR);
+        }
+        compare("crop", out, ref, tol, failed);
+    }
+
+    // 3. 打包格式之间: RGB 缩放
+    {
+        const int dw = src_w / 3, dh = src_h / 3;
+        cv::Mat out(dh, dw, CV_8UC3);
+        image_view rgb_src = {rgb_full.data, NULL, src_w, src_h, (int)rgb_full.step, IMAGE_RGB888};
+        double t0 = what_time_is_it_now_ns();
+        for (int i = 0; i < iters; i++)
+            pre->resize(rgb_src, make_image_view(out.data, dw, dh, IMAGE_RGB888));
+        double t1 = what_time_is_it_now_ns();
+        printf("resize RGB %dx%d -> %dx%d:  %8.3f ms/frame\n", src_w, src_h, dw, dh, (t1 - t0) / iters / 1e6);
+
+        cv::Mat ref;
+        cv::resize(rgb_full, ref, cv::Size(dw, dh), 0, 0, cv::INTER_LINEAR);
+        compare("resize", out, ref, tol, failed);
+    }
+
+    delete pre;
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,84 @@
+/*---------------------------------------------------------
+    原始帧录制
+    从任意帧来源 (见 frame_source.h) 读帧, 按 raw_frames.h 的格式写成定长 NV12 帧文件,
+    之后用 raw:<文件>?rate=max 或 rate=<fps> 回放, 基准测试不再含解码开销且每次相同
+    用法:
+        record_raw <source-uri> <out.raw> [--frames N] [--fps F]
+    录完会映射回放一遍, 报告帧数与读取速度
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "mytime.h"
+#include "frame_source.h"
+#include "raw_frames.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("usage: %s <source-uri> <out.raw> [--frames N] [--fps F]\n", argv[0]);
+        return -1;
+    }
+    const char *uri = argv[1], *out = argv[2];
+    long max_frames = -1;
+    int fps = 0;
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) max_frames = atol(argv[++i]);
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc) fps = atoi(argv[++i]);
+        else {
+            printf("unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    FrameSource *src = open_frame_source(uri);
+    if (src == NULL)
+        return -1;
+    nv12_frame frame;
+    if (!src->read(frame)) {
+        printf("no frame from %s\n", uri);
+        delete src;
+        return -1;
+    }
+    RawFrameWriter writer;
+    if (!writer.open(out, frame.width, frame.height, fps > 0 ? fps : (src->fps > 0 ? src->fps : 25))) {
+        delete src;
+        return -1;
+    }
+    double t0 = what_time_is_it_now_ns();
+    do {
+        if (!writer.write(frame)) {
+            printf("write frame %lu fail (size changed to %dx%d?)\n", (unsigned long)writer.frames(), frame.width,
+                   frame.height);
+            break;
+        }
+        if (writer.frames() % 100 == 0)
+            printf("recorded %lu frames\n", (unsigned long)writer.frames());
+    } while ((max_frames < 0 || (long)writer.frames() < max_frames) && src->read(frame));
+    double t1 = what_time_is_it_now_ns();
+    unsigned long recorded = writer.frames();
+    writer.close();
+    delete src;
+    printf("recorded %lu frames %dx%d to %s in %.2f s\n", recorded, frame.width, frame.height, out, (t1 - t0) / 1e9);
+
+    // 映射回放: 帧直接引用文件, 只摸一下每帧的首尾, 量的是来源本身的开销
+    FrameSource *replay = open_frame_source(std::string("raw:") + out + "?rate=max");
+    if (replay == NULL)
+        return -1;
+    unsigned long n = 0, sum = 0;
+    t0 = what_time_is_it_now_ns();
+    while (replay->read(frame)) {
+        sum += frame.y()[0] + frame.uv()[(size_t)frame.stride() * (frame.height / 2) - 1];
+        n++;
+    }
+    t1 = what_time_is_it_now_ns();
+    delete replay;
+    printf("replay: %lu frames, %.1f us/frame (checksum %lu)\n", n, (t1 - t0) / 1e3 / (n > 0 ? n : 1), sum);
+    if (n != recorded) {
+        printf("FAIL: replayed %lu of %lu frames\n", n, recorded);
+        return -1;
+    }
+    return 0;
+}
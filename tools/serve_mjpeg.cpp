@@ -0,0 +1,79 @@
+/*---------------------------------------------------------
+    MJPEG 预览服务单独运行 (不跑检测), 检查网页预览/客户端跳帧用
+    从任意帧来源 (见 frame_source.h) 读帧, 按 --fps 上限编码一次发给所有客户端
+    用法:
+        serve_mjpeg <source-uri> [--port P] [--fps F] [--width W] [--bind ADDR]
+    然后:
+        curl -s http://127.0.0.1:8080/snapshot -o a.jpg
+        curl -sN http://127.0.0.1:8080/stream --max-time 5 -o s.mjpeg
+        curl -sN --limit-rate 50k http://127.0.0.1:8080/stream --max-time 5 -o slow.mjpeg   (慢客户端跳帧)
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mytime.h"
+#include "frame_source.h"
+#include "image_processor.h"
+#include "mjpeg_server.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: %s <source-uri> [--port P] [--fps F] [--width W] [--bind ADDR]\n", argv[0]);
+        return -1;
+    }
+    int port = 8080, fps = 15, max_width = 960;
+    const char *bind_addr = "127.0.0.1";
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc) fps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--width") && i + 1 < argc) max_width = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bind") && i + 1 < argc) bind_addr = argv[++i];
+        else {
+            printf("unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    FrameSource *src = open_frame_source(argv[1]);
+    if (src == NULL)
+        return -1;
+    MjpegServer server;
+    if (!server.start(bind_addr, port))
+        return -1;
+    ImageProcessor *pre = create_image_processor("cpu");
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 75};
+    cv::Mat canvas;
+    nv12_frame frame;
+    long frames = 0, encoded = 0;
+    double next = 0, enc_ms = 0;
+    while (src->read(frame)) {
+        frames++;
+        double now = what_time_is_it_now();
+        if (now < next || !server.has_clients())
+            continue;
+        next = now + 1000.0 / fps;
+        float scale = max_width > 0 && frame.width > max_width ? (float)max_width / frame.width : 1.f;
+        int w = (int)(frame.width * scale) & ~1, h = (int)(frame.height * scale) & ~1;
+        if (canvas.cols != w || canvas.rows != h)
+            canvas.create(h, w, CV_8UC3);
+        image_rect src_rect = {0, 0, frame.width, frame.height};
+        image_rect dst_rect = {0, 0, w, h};
+        pre->process(frame.view(), src_rect, make_image_view(canvas.data, w, h, IMAGE_BGR888), dst_rect);
+        std::shared_ptr<std::vector<uint8_t> > jpeg = std::make_shared<std::vector<uint8_t> >();
+        cv::imencode(".jpg", canvas, *jpeg, params);
+        server.publish(jpeg);
+        encoded++;
+        enc_ms += what_time_is_it_now() - now;
+    }
+    // 来源读完后留一会儿, 让客户端取到最后一帧
+    sleep(1);
+    server.stop();
+    printf("%ld frames read, %ld encoded (%.1f ms each), %ld sent, %ld skipped for slow clients\n", frames, encoded,
+           encoded > 0 ? enc_ms / encoded : 0.0, (long)server.frames_sent, (long)server.frames_skipped);
+    delete pre;
+    delete src;
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*---------------------------------------------------------
+    追踪结果日志查看/导出 (日志由 OUTPUT_SINKS 的 tracks 输出端写, 格式见 track_log.h)
+    用法:
+        track_log <file.tracks> [info|csv|tracks] [--from MS] [--to MS] [--track ID]
+    info:   帧数/记录数/时间范围/索引块 (默认)
+    csv:    逐条导出 frame,pts_ms,track,class,conf,x1,y1,x2,y2
+    tracks: 每条轨迹的出现时间/帧数/平均框
+    --from/--to 为媒体时间 (ms), 通过索引直接定位, 不从头扫
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#include "mytime.h"
+#include "track_log.h"
+
+struct track_summary {
+    double first_ms, last_ms;
+    long frames;
+    int class_id;
+    double w, h;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: %s <file.tracks> [info|csv|tracks] [--from MS] [--to MS] [--track ID]\n", argv[0]);
+        return -1;
+    }
+    const char *path = argv[1];
+    const char *mode = "info";
+    double from = -1e300, to = 1e300;
+    long only_track = -1;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--from") && i + 1 < argc) from = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--to") && i + 1 < argc) to = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--track") && i + 1 < argc) only_track = atol(argv[++i]);
+        else if (argv[i][0] != '-') mode = argv[i];
+        else {
+            printf("unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    double t0 = what_time_is_it_now_ns();
+    TrackLogReader log;
+    if (!log.open(path))
+        return -1;
+    double t1 = what_time_is_it_now_ns();
+    log.seek(from);
+    double t2 = what_time_is_it_now_ns();
+
+    if (!strcmp(mode, "info")) {
+        printf("%s: %lu frames, %.3f - %.3f s, %.1f KB%s\n", path, (unsigned long)log.frame_count(),
+               log.first_ms() / 1000, log.last_ms() / 1000, log.file_bytes() / 1024.0,
+               log.was_recovered() ? " (no trailer, index rebuilt by scanning)" : "");
+        printf("open + index %.1f us, seek %.1f us\n", (t1 - t0) / 1e3, (t2 - t1) / 1e3);
+    }
+    else if (!strcmp(mode, "csv")) {
+        printf("frame,pts_ms,track,class,conf,x1,y1,x2,y2\n");
+    }
+    else if (strcmp(mode, "tracks") != 0) {
+        printf("unknown mode %s (info / csv / tracks)\n", mode);
+        return -1;
+    }
+
+    std::map<int, track_summary> tracks;
+    TrackLogReader::frame_view f;
+    long frames = 0, records = 0;
+    while (log.next(f) && f.pts_ms <= to) {
+        frames++;
+        for (int i = 0; i < f.count; i++) {
+            const track_record &r = f.records[i];
+            if (only_track >= 0 && r.track_id != only_track)
+                continue;
+            records++;
+            if (!strcmp(mode, "csv")) {
+                printf("%ld,%.3f,%d,%d,%.3f,%.1f,%.1f,%.1f,%.1f\n", (long)f.frame, f.pts_ms, r.track_id, r.class_id,
+                       r.confidence / 65535.0, r.x1, r.y1, r.x2, r.y2);
+            }
+            else if (!strcmp(mode, "tracks")) {
+                std::map<int, track_summary>::iterator it = tracks.find(r.track_id);
+                if (it == tracks.end()) {
+                    track_summary s = {f.pts_ms, f.pts_ms, 0, r.class_id, 0, 0};
+                    it = tracks.insert(std::make_pair(r.track_id, s)).first;
+                }
+                it->second.last_ms = f.pts_ms;
+                it->second.frames++;
+                it->second.w += r.x2 - r.x1;
+                it->second.h += r.y2 - r.y1;
+            }
+        }
+    }
+    double t3 = what_time_is_it_now_ns();
+
+    if (!strcmp(mode, "tracks")) {
+        printf("track  class  first(s)  last(s)  frames  mean w x h\n");
+        for (std::map<int, track_summary>::iterator it = tracks.begin(); it != tracks.end(); ++it) {
+            const track_summary &s = it->second;
+            printf("%5d  %5d  %8.3f  %7.3f  %6ld  %.0f x %.0f\n", it->first, s.class_id, s.first_ms / 1000,
+                   s.last_ms / 1000, s.frames, s.w / s.frames, s.h / s.frames);
+        }
+    }
+    if (strcmp(mode, "csv") != 0)
+        printf("read %ld frames, %ld records in range in %.2f ms\n", frames, records, (t3 - t2) / 1e6);
+    return 0;
+}
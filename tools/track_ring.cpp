@@ -0,0 +1,139 @@
+/*---------------------------------------------------------
+    共享内存追踪结果环的读写工具 (环由 OUTPUT_SINKS 的 shm 输出端写, 格式见 track_ring.h)
+    用法:
+        track_ring read [--name N] [--poll MS] [--quiet]
+        track_ring replay <file.tracks> [--name N] [--fps F]
+    read:   作为读者接上环, 逐帧打印 (帧号/时间/轨迹数), 结束时打印延迟和被覆盖的帧数
+            默认在 futex 上等新帧; --poll MS 改为每 MS 毫秒看一次 head
+    replay: 把追踪日志按 --fps (默认 30) 写进环, 不跑检测也能测读者
+----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mytime.h"
+#include "track_log.h"
+#include "track_ring.h"
+
+static int replay(const char *path, const char *name, int fps)
+{
+    TrackLogReader log;
+    if (!log.open(path))
+        return -1;
+    TrackRingWriter ring;
+    if (!ring.open(name))
+        return -1;
+    TrackLogReader::frame_view f;
+    double next = what_time_is_it_now();
+    while (log.next(f)) {
+        double now = what_time_is_it_now();
+        if (now < next)
+            usleep((useconds_t)((next - now) * 1000));
+        next += 1000.0 / fps;
+        ring.write(f.frame, f.pts_ms, f.records, f.count);
+    }
+    printf("replayed %lu frames\n", (unsigned long)ring.frame_count());
+    ring.close();
+    return 0;
+}
+
+static int read_ring(const char *name, int poll_ms, bool quiet)
+{
+    TrackRingReader ring;
+    while (!ring.open(name)) {
+        printf("waiting for %s ...\n", name);
+        sleep(1);
+    }
+    // 上一次运行留下的环, 等写者重新打开
+    while (ring.writer_closed()) {
+        usleep(200 * 1000);
+        if (ring.writer_restarted() && !ring.open(name))
+            sleep(1);
+    }
+    printf("attached to %s: writer pid %u, %u slots x %u records\n", name, ring.header().writer_pid,
+           ring.header().slots, ring.header().max_records);
+    TrackRingReader::frame_data f;
+    uint64_t next = ring.head();
+    long frames = 0, missed = 0, torn = 0;
+    double lag_sum = 0;
+    while (1) {
+        if (ring.writer_restarted()) {
+            // 写者重启, 环从 0 重新计
+            printf("writer restarted\n");
+            if (!ring.open(name))
+                break;
+            next = 0;
+        }
+        if (poll_ms > 0) {
+            if (ring.head() <= next) {
+                if (ring.writer_closed())
+                    break;
+                usleep(poll_ms * 1000);
+                continue;
+            }
+        }
+        else {
+            int r = ring.wait(next, 1000);
+            if (r < 0 && ring.writer_restarted())
+                continue;
+            if (r < 0)
+                break;
+            if (r == 0)
+                continue;
+        }
+        uint64_t head = ring.head();
+        // 落后超过环的长度, 中间的帧已被覆盖, 跳到还在环里的最老一帧
+        if (head - next > ring.slot_count()) {
+            missed += head - ring.slot_count() - next;
+            next = head - ring.slot_count();
+        }
+        for (; next < head; next++) {
+            if (!ring.read(next, f)) {
+                torn++;
+                continue;
+            }
+            frames++;
+            lag_sum += head - 1 - next;
+            if (!quiet)
+                printf("frame %lld  %.1f ms  %d tracks%s\n", (long long)f.frame, f.pts_ms, (int)f.records.size(),
+                       f.truncated > 0 ? " (truncated)" : "");
+        }
+    }
+    printf("writer closed: %ld frames read, %ld overwritten before read (%ld while reading), mean %.2f frames behind\n",
+           frames, missed + torn, torn,
+           frames > 0 ? lag_sum / frames : 0.0);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("usage: %s read [--name N] [--poll MS] [--quiet]\n"
+               "       %s replay <file.tracks> [--name N] [--fps F]\n",
+               argv[0], argv[0]);
+        return -1;
+    }
+    const char *mode = argv[1];
+    const char *name = TRACKRING_NAME;
+    const char *path = NULL;
+    int poll_ms = 0, fps = 30;
+    bool quiet = false;
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "--name") && i + 1 < argc) name = argv[++i];
+        else if (!strcmp(argv[i], "--poll") && i + 1 < argc) poll_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--fps") && i + 1 < argc) fps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--quiet")) quiet = true;
+        else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+        else {
+            printf("unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (!strcmp(mode, "read"))
+        return read_ring(name, poll_ms, quiet);
+    if (!strcmp(mode, "replay") && path != NULL)
+        return replay(path, name, fps > 0 ? fps : 30);
+    printf("unknown mode %s\n", mode);
+    return -1;
+}
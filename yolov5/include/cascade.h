@@ -0,0 +1,44 @@
+#ifndef CASCADE_H
+#define CASCADE_H
+
+#include <mutex>
+
+#include "common.h"
+
+#define CASCADE_FULL  0   // 完整模型 (YOLO_MODEL_PATH)
+#define CASCADE_LITE  1   // 小模型 (YOLO_LITE_MODEL_PATH)
+
+#define CASCADE_KEYFRAME     10    // 每隔这么多帧至少跑一次完整模型, 找回小模型漏掉的小目标
+#define CASCADE_CONF_THRESH  0.45  // 小模型框的平均置信度低于该值时, 下一帧升级到完整模型
+#define CASCADE_LOST_RATIO   0.7   // 小模型的框数少于其近期平均的该比例 (目标丢了) 时也升级
+
+/*
+    级联检测的逐帧调度
+    videoResize 每个要检测的帧调用 choose 决定用哪个模型, 检测线程出结果后 report
+    结果比调度晚一两帧 (多个检测线程并行), 升级最多滞后这么多帧
+    小模型的输入尺寸由检测线程加载小模型后从其输入属性得到 (set_lite_input), 之前 choose 只给完整模型
+*/
+class CascadeScheduler {
+public:
+    CascadeScheduler();
+    void set_lite_input(int w, int h);
+    // 小模型还没加载时返回 false
+    bool lite_input(int &w, int &h);
+    int choose(int frame);
+    void report(int frame, int model, const detect_result_group_t &dets);
+    void print_stats();
+
+private:
+    std::mutex mtx;
+    int last_full;         // 上次安排完整模型的帧
+    int last_full_report;  // 上次完整模型出结果的帧, 更早的小模型结果不再参考
+    float lite_count;      // 小模型框数的滑动平均, 小于 0 为还没有
+    bool escalate;         // 小模型置信度下降, 下一帧用完整模型
+    int full_frames;
+    int lite_frames;
+    int escalations;
+    int lite_w;
+    int lite_h;
+};
+
+#endif // CASCADE_H
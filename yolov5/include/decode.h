@@ -1,5 +1,30 @@
+#pragma once
 #include "common.h"
 
+class Decoder;
+
+// 后处理各阶段耗时 (ns), 由 post_process 累加
+struct post_process_timing {
+    double scan_ns;
+    double decode_ns;
+    double sort_ns;
+    double nms_ns;
+    int candidates;
+};
+
+// 通用后处理: decoder 解码候选框, 再排序/NMS/还原坐标
+// outputs: 模型输出指针, 个数与顺序由 decoder->meta 决定
+// timing:  非空时累加各阶段耗时
+int post_process(Decoder *decoder, void **outputs, bool is_quant, int h_offset, int w_offset, float resize_scale,
+                 float conf_threshold, float nms_threshold, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                 detect_result_group_t *group, post_process_timing *timing = NULL);
+
+// int8 定点后处理: 框和分数以整数完成解码/排序/NMS, 只有保留的框转成浮点
+// decoder 不支持时等同于 post_process(..., is_quant=true, ...)
+int post_process_fixed(Decoder *decoder, int8_t **outputs, int h_offset, int w_offset, float resize_scale,
+                       float conf_threshold, float nms_threshold, std::vector<int32_t> &qnt_zps,
+                       std::vector<float> &qnt_scales, detect_result_group_t *group, post_process_timing *timing = NULL);
+
 // output type: uint8
 int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
                  int h_offset, int w_offset, float resize_scale, float conf_threshold, float nms_threshold, 
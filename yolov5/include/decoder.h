@@ -0,0 +1,170 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+#include "common.h"
+#include "rknn_api.h"
+
+#define DECODER_MAX_HEAD   4   // 最多的检测头数
+#define DECODER_MAX_OUTPUT 12  // 最多的输出tensor数 (yolov8: 每个头 box/cls/sum 三个)
+#define DFL_MAX_REG        32  // DFL 每条边最多的bin数
+#define DECODE_FIX_BITS    8   // 定点解码: 框坐标小数位数 (Q8 网络像素)
+#define DECODE_SCORE_BITS  30  // 定点解码: 分数小数位数 (sigmoid Q15 * Q15)
+
+// 检测头的种类
+enum decoder_family {
+    DECODER_YOLOV5 = 0,  // anchor-based, 每个头一个 [1, na*(5+nc), h, w] 输出
+    DECODER_YOLOV8,      // anchor-free + DFL, 每个头 box[1, 4*reg, h, w] + cls[1, nc, h, w] (+ score_sum[1, 1, h, w])
+};
+
+/*
+    模型元信息 由 rknn_query 得到的输入/输出属性整理而来
+    用于挑选 Decoder 以及提供网格尺寸
+*/
+struct model_meta {
+    decoder_family family;
+    int model_in_h;
+    int model_in_w;
+    int n_output;
+    int n_head;
+    int class_num;
+    int anchor_num;                       // yolov5: 每层anchor数  yolov8: 0
+    int reg_max;                          // yolov8: DFL bin数     yolov5: 0
+    int out_per_head;                     // yolov8: 2 或 3       yolov5: 1
+    int strides[DECODER_MAX_HEAD];
+    int grid_h[DECODER_MAX_HEAD];
+    int grid_w[DECODER_MAX_HEAD];
+};
+
+/*
+    扫描阶段得到的候选格子
+    offset:     该格子(及anchor)在输出tensor中的起始偏移
+    box_conf:   原始的目标置信度 (int8 时为量化值)
+    class_prob: 原始的最大类别分数 (int8 时为量化值)
+*/
+struct grid_candidate {
+    int head;
+    int anchor;
+    int row;
+    int col;
+    int offset;
+    int class_id;
+    float box_conf;
+    float class_prob;
+};
+
+/*
+    Decoder 接口
+    scan：   遍历所有格子, 找出超过阈值的候选
+    decode： 只对候选格子解码出框 (网络输入坐标下的 x, y, w, h) 和分数
+    排序/NMS/坐标还原由 post_process 统一完成
+*/
+class Decoder {
+public:
+    Decoder(const model_meta &meta) : meta(meta)
+    {
+        for (int h = 0; h < DECODER_MAX_HEAD; h++) cell_mask[h] = NULL;
+    }
+    virtual ~Decoder() {}
+    // 每个检测头的格子掩码 (grid_h * grid_w, 0 表示跳过), NULL 表示全部扫描
+    void set_cell_mask(int head, const uint8_t *mask) { cell_mask[head] = mask; }
+    virtual const char *name() const = 0;
+    virtual int scan_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                        float threshold, std::vector<grid_candidate> &cands) = 0;
+    virtual void decode_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                           const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                           std::vector<float> &boxScores, std::vector<int> &classId) = 0;
+    virtual int scan_fp(float **outputs, float threshold, std::vector<grid_candidate> &cands) = 0;
+    virtual void decode_fp(float **outputs, const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                           std::vector<float> &boxScores, std::vector<int> &classId) = 0;
+    /*
+        int8 定点解码: 框为 Q(DECODE_FIX_BITS) 的 x, y, w, h, 分数为 Q(DECODE_SCORE_BITS)
+        不支持的实现返回 false, 调用方回退到 decode_i8
+    */
+    virtual bool decode_i8_fixed(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                                 const std::vector<grid_candidate> &cands, std::vector<int32_t> &boxes,
+                                 std::vector<int32_t> &boxScores, std::vector<int> &classId)
+    {
+        return false;
+    }
+
+    // scan + decode
+    int process_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                   float threshold, std::vector<float> &boxes, std::vector<float> &boxScores, std::vector<int> &classId)
+    {
+        std::vector<grid_candidate> cands;
+        scan_i8(outputs, qnt_zps, qnt_scales, threshold, cands);
+        decode_i8(outputs, qnt_zps, qnt_scales, cands, boxes, boxScores, classId);
+        return cands.size();
+    }
+    int process_fp(float **outputs, float threshold, std::vector<float> &boxes,
+                   std::vector<float> &boxScores, std::vector<int> &classId)
+    {
+        std::vector<grid_candidate> cands;
+        scan_fp(outputs, threshold, cands);
+        decode_fp(outputs, cands, boxes, boxScores, classId);
+        return cands.size();
+    }
+public:
+    model_meta meta;
+protected:
+    const uint8_t *cell_mask[DECODER_MAX_HEAD];
+};
+
+/*
+    注册表
+    match： 判断该实现是否能处理给定模型
+    create：创建实例
+    select_decoder 按注册顺序返回第一个匹配的特化实现, 都不匹配时返回运行时形状的通用实现
+*/
+typedef bool (*decoder_match_fn)(const model_meta &);
+typedef Decoder *(*decoder_create_fn)(const model_meta &);
+struct decoder_entry {
+    const char *name;
+    decoder_match_fn match;
+    decoder_create_fn create;
+};
+
+void register_decoder(const decoder_entry &entry);
+Decoder *select_decoder(const model_meta &meta);
+// 运行期形状的通用实现, 用于对比/回退
+Decoder *select_generic_decoder(const model_meta &meta);
+int parse_model_meta(rknn_tensor_attr *input_attr, rknn_tensor_attr *output_attrs, int n_output, model_meta &meta);
+// 不经过 rknn_query 的默认 yolov5 (OBJ_CLASS_NUM 类, 3 个头) 描述
+void default_model_meta(int model_in_h, int model_in_w, model_meta &meta);
+
+/*
+    量化工具函数
+*/
+static inline float sigmoid(float x)
+{
+    return 1.0 / (1.0 + expf(-x));
+}
+
+static inline float unsigmoid(float y)
+{
+    return -1.0 * logf((1.0 / y) - 1.0);
+}
+
+inline static int32_t __clip(float val, float min, float max)
+{
+    float f = val <= min ? min : (val >= max ? max : val);
+    return f;
+}
+
+static inline int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
+{
+    float dst_val = (f32 / scale) + zp;
+    int8_t res = (int8_t)__clip(dst_val, -128, 127);
+    return res;
+}
+
+static inline float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale)
+{
+    return ((float)qnt - (float)zp) * scale;
+}
+
+#endif // DECODER_H
@@ -1,11 +1,47 @@
+#include "common.h"
 #include "rknn_fp.h"
+#include "decoder.h"
+#include "roi_mask.h"
 
 
 class Yolo :public rknn_fp{
 public:
     using rknn_fp::rknn_fp;  //声明使用基类的构造函数
+    ~Yolo() { for (auto &d : decoders) delete d.second; delete lite; delete pre; }
     int detect_process();
+    /*
+        第一次 detect 前调用; single_stream 为 false (多路) 时不用感兴趣区域与原始输出记录
+        返回 -1 为模型没有对应的后处理
+    */
+    int prepare(bool single_stream);
+    /*
+        检测一帧 (或一块), 结果为原图 (分块时为块内) 坐标
+        返回 NPU 推理耗时 (us), 跳过检测时为 0, 出错为 -1
+    */
+    int detect(input_image &input, detect_result_group_t &out);
+    /*
+        batch > 1 的模型: 把几路的整帧 (n_tiles 为 1 的块) 写进同一个输入 tensor 的各个位置, 只推理一次
+        inputs 最多 batch() 张, 不满时空位照算但不解码; outs[i] 对应 inputs[i], 为原图坐标
+        返回 NPU 推理耗时 (us), 出错为 -1
+    */
+    int detect_batch(std::vector<input_image> &inputs, std::vector<detect_result_group_t> &outs);
 private:
+    // 解码一张输入的输出 (outputs 为各输出头), 坐标按 geom 还原并裁到原图 (块) 内
+    void decode(rknn_fp *net, void **outputs, const letterbox_t &geom, detect_result_group_t &out);
+    // net 当前输入尺寸对应的 Decoder (动态形状模型每种尺寸一个, 网格大小不同)
+    Decoder *current_decoder(rknn_fp *net);
     const int det_interval = 1;
+    Decoder *decoder = NULL;  // 模型默认输入尺寸的 Decoder, 由模型输出属性选择
+    std::vector<std::pair<rknn_fp *, Decoder *> > decoders;
+    rknn_fp *lite = NULL;     // 级联模式的小模型, 在检测线程里加载, 与本模型共用 NPU 核
+    RoiMask roi;              // 感兴趣区域, 区域外的格子不扫描
+    bool use_roi = false;
+    letterbox_t roi_lb;       // 栅格化时的整帧 letterbox
+    letterbox_t input_lb[2];  // 两个模型的输入 tensor 当前边框对应的 letterbox (分块), 不变时不重填
+    ImageProcessor *pre = NULL;  // 分块模式下自己做预处理
+    std::vector<float> out_scales;
+    std::vector<int32_t> out_zps;
+    bool warned_fixed_shape = false;
+    std::vector<letterbox_t> batch_lb;  // batch 各位置当前边框对应的 letterbox, 不变时不重填
 };
 
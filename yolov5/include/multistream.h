@@ -0,0 +1,72 @@
+#ifndef MULTISTREAM_H
+#define MULTISTREAM_H
+
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+class DeepSort;
+
+#define STREAM_DETECTORS      2     // 各路共用的检测上下文数, 轮流放在 NPU 核 0/1
+#define STREAM_REID_CONTEXTS  2     // 各路共用的 Re-ID 上下文数, 在 NPU 核 2
+#define STREAM_QUEUE_DEPTH    4     // 每路待检测的帧数上限; 实时源满了丢最旧的, 文件等待
+#define STREAM_REPORT_MS      5000  // 每隔这么久打印一次各路帧率
+// 跨路批处理 (检测模型 batch > 1 时)
+#define STREAM_BATCH_MAX_WAIT_MS  20.0   // 凑批时最老一帧最多多等这么久
+#define STREAM_BATCH_ACTIVE_MS    1000.0 // 这么久内来过帧的路算活跃, 目标张数不超过活跃路数
+#define STREAM_BATCH_EMA          0.1    // 到达间隔 / 推理耗时的平滑系数
+
+/*
+    跨路批处理的凑批策略, 调用方加锁
+    目标张数: 活跃路数与模型 batch 取小, 负载高时队列里已有这么多帧, 直接凑满不用等
+    等待窗口: 按合计的帧到达间隔估计凑满还要多久, 不超过一次批推理的耗时 (再等不如先跑) 和 STREAM_BATCH_MAX_WAIT_MS,
+    负载低时窗口收缩, 多出的延迟有上限; 不满的批空位照算, 只是浪费, 不影响结果
+*/
+class BatchWindow {
+public:
+    BatchWindow(int max_batch, int n_streams);
+    // stream 有一帧进入待检测队列
+    void arrived(int stream, double now_ms);
+    // 这一批想凑的张数
+    int target(double now_ms) const;
+    // 已有 have 张时, 最老一帧还可以等多久 (ms), 0 为马上推理
+    double window_ms(int target, int have) const;
+    // 推理完一批: n 张, 最老一帧等了 waited_ms, 推理耗时 run_ms
+    void ran(int n, double waited_ms, double run_ms);
+    void print_stats() const;
+    double mean_fill() const { return batches > 0 ? (double)frames / batches : 0; }
+
+private:
+    int max_batch;
+    double interval_ema;              // 所有路合计的帧到达间隔, <0 为还没有
+    double run_ema;                   // 一次批推理的耗时, <0 为还没有
+    double last_arrival;
+    std::vector<double> stream_last;  // 各路最近一帧的到达时间
+    long batches;
+    long frames;
+    double waited_sum;
+    std::vector<long> fill;           // fill[n]: n 张的批数
+};
+
+/*
+    每路追踪完一帧后的回调 (离线分段处理用), 在该路自己的追踪线程里调用, 不同路可能同时调用
+    frame.dets.results 已带轨迹号; tracker 为该路的追踪器, 可以取轨迹特征
+*/
+class StreamObserver {
+public:
+    virtual ~StreamObserver() {}
+    virtual void on_frame(int stream, const imageout_idx &frame, DeepSort *tracker) = 0;
+};
+
+/*
+    多路: 每路一个读帧线程和一个追踪线程 (各自的 DeepSort / tracker), 检测和 Re-ID 上下文各路共用
+    检测线程从各路的队列轮转取帧, 一路积压不会饿死其他路; 结果按路重排后交给该路的追踪线程
+    检测模型 batch > 1 时, 检测线程按 BatchWindow 凑几路的帧一起推理, 结果再按路拆开
+    分块/跟随/级联/运动门控/感兴趣区域是单路功能, 多路时关闭; DETECT_INTERVAL 和光流按路照常生效
+    uris: 每路的帧来源 (见 frame_source.h), 全部读完并追踪完后返回
+    observer: 不为空时每路每帧追踪完调用一次
+*/
+int run_multistream(const std::vector<std::string> &uris, StreamObserver *observer = NULL);
+
+#endif // MULTISTREAM_H
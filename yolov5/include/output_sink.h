@@ -0,0 +1,196 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "track_log.h"
+#include "track_ring.h"
+#include "overlay.h"
+#include "image_processor.h"
+#include "mjpeg_server.h"
+
+#define OUTPUT_ENCODE_DEPTH   8           // 编码队列上限, 满了丢新来的帧, 已排队的部分保持连续
+#define PREVIEW_WINDOW        "DeepSORT"
+#define PREVIEW_FPS           30          // 预览按显示刷新率画, 中间来的帧只留最新的
+#define PREVIEW_MAX_WIDTH     960         // 预览宽度上限, 更宽的帧缩小后再画; 0 为不缩小
+#define MJPEG_FPS             15          // 网页预览的编码帧率上限, 每帧只编码一次, 所有客户端共用
+#define MJPEG_QUALITY         75
+#define MJPEG_PORT            8080
+#define MJPEG_BIND            "0.0.0.0"   // 局域网可看; "127.0.0.1" 只限本机
+
+/*
+    输出端: videoWrite 把每帧 (原图 + 追踪结果) 交给各输出端, push 从不阻塞, 跟不上时丢帧并计数,
+    慢的显示/编码不会反压到检测和追踪
+    规格 (OUTPUT_SINKS, 逗号分隔, 可以同时开几个):
+        null            不输出, 无界面运行
+        preview         窗口预览, 显示跟不上时只显示最新一帧
+        file[:<path>]   编码写视频文件, 省略路径时用 VIDEO_SAVEPATH
+        tracks[:<path>] 追踪结果写二进制日志 (见 track_log.h), 省略路径时为 VIDEO_SAVEPATH + ".tracks"
+        mjpeg[:<port>]  HTTP MJPEG 预览 (见 mjpeg_server.h), 不用接显示器, 默认端口 MJPEG_PORT
+        shm[:<name>]    追踪结果放进共享内存环 (见 track_ring.h), 本机其他进程读取, 默认名字 TRACKRING_NAME
+*/
+class OutputSink {
+public:
+    OutputSink() : accepted(0), dropped(0), rendered(0) {}
+    virtual ~OutputSink() {}
+    // 交一帧, 不阻塞; 被丢掉时返回 false
+    virtual bool push(const imageout_idx &frame) = 0;
+    // 输入结束: 处理完已收下的帧后返回
+    virtual void close() {}
+    virtual const char *name() const = 0;
+
+    long accepted;  // 收下的帧数
+    long dropped;   // 丢掉的帧数 (含收下后被更新的帧替换的)
+    long rendered;  // 实际处理 (显示/编码/写入) 的帧数
+};
+
+class NullSink : public OutputSink {
+public:
+    bool push(const imageout_idx &) override
+    {
+        accepted++;
+        return true;
+    }
+    const char *name() const override { return "null"; }
+};
+
+/*
+    有界队列 + 自己的线程, 转 BGR / 画框 / 显示或编码都在这个线程里
+    drop_oldest: 满了丢最旧的 (预览只要最新); 否则丢新来的
+    派生类构造完调用 start(), 析构时调用 close()
+*/
+class AsyncSink : public OutputSink {
+public:
+    AsyncSink(size_t depth, bool drop_oldest)
+        : interval_ms(0), depth(depth), drop_oldest(drop_oldest), closing(false) {}
+    bool push(const imageout_idx &frame) override;
+    void close() override;
+
+protected:
+    void start();
+    // 返回该帧是否真的处理了 (计入 rendered)
+    virtual bool consume(imageout_idx &frame) = 0;
+    // 线程退出前, 在该线程里调用 (释放编码器/窗口)
+    virtual void finish() {}
+    double interval_ms;  // 大于 0 时两次 consume 至少间隔这么久, 期间来的帧按 drop_oldest 处理
+
+private:
+    void run();
+    size_t depth;
+    bool drop_oldest;
+    bool closing;
+    std::deque<imageout_idx> queue;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread worker;
+};
+
+// 编码写文件, 分辨率取第一帧, 第一帧到达时才打开
+class EncoderSink : public AsyncSink {
+public:
+    EncoderSink(const std::string &path, int fps, double fourcc);
+    ~EncoderSink() { close(); }
+    const char *name() const override { return "file"; }
+
+protected:
+    bool consume(imageout_idx &frame) override;
+    void finish() override;
+
+private:
+    std::string path;
+    int fps;
+    double fourcc;
+    bool failed;      // 打开编码器失败, 不再重试
+    long unwritten;   // 收下了但没写进文件的帧 (编码器打不开), 结束时计入 dropped
+    cv::VideoWriter writer;
+    OverlayRenderer overlay;
+};
+
+/*
+    窗口预览: 每 1/PREVIEW_FPS 秒取最新一帧画一次, 没显示的帧不转色也不画框
+    NV12 一步转成缩小的 BGR (PREVIEW_MAX_WIDTH), 框和标签画在小图上
+*/
+class PreviewSink : public AsyncSink {
+public:
+    PreviewSink();
+    ~PreviewSink();
+    const char *name() const override { return "preview"; }
+
+protected:
+    bool consume(imageout_idx &frame) override;
+    void finish() override;
+
+private:
+    ImageProcessor *pre;
+    cv::Mat canvas;
+    OverlayRenderer overlay;
+};
+
+/*
+    网页预览: 与窗口预览一样按 MJPEG_FPS 取最新一帧画在小图上, 编码一次后交给 MjpegServer 发给所有客户端
+    没有人在看 (/stream 或等着 /snapshot) 时不画也不编码
+*/
+class MjpegSink : public AsyncSink {
+public:
+    MjpegSink(int port);
+    ~MjpegSink();
+    // 服务没起来时直接丢掉
+    bool push(const imageout_idx &frame) override;
+    const char *name() const override { return "mjpeg"; }
+
+protected:
+    bool consume(imageout_idx &frame) override;
+
+private:
+    bool enabled;
+    MjpegServer server;
+    ImageProcessor *pre;
+    cv::Mat canvas;
+    OverlayRenderer overlay;
+    std::vector<int> params;
+};
+
+// 追踪结果日志, 每帧只有几十字节, 直接在 push 里追加到文件缓冲, 不转图
+class TrackLogSink : public OutputSink {
+public:
+    TrackLogSink(const std::string &path);
+    ~TrackLogSink() { close(); }
+    bool push(const imageout_idx &frame) override;
+    void close() override;
+    const char *name() const override { return "tracks"; }
+
+private:
+    TrackLogWriter writer;
+    bool ok;
+    std::vector<track_record> records;
+};
+
+// 追踪结果写进共享内存环, 同 TrackLogSink 在 push 里直接写, 写者从不等读者
+class TrackRingSink : public OutputSink {
+public:
+    TrackRingSink(const std::string &name);
+    ~TrackRingSink() { close(); }
+    bool push(const imageout_idx &frame) override;
+    void close() override;
+    const char *name() const override { return "shm"; }
+
+private:
+    TrackRingWriter writer;
+    bool ok;
+    std::vector<track_record> records;
+};
+
+/*
+    按规格创建输出端, 规格有误时打印并跳过该项
+    default_path: file 不带路径时的输出文件; fps/fourcc: 编码参数 (输入视频的属性)
+*/
+std::vector<OutputSink *> open_output_sinks(const std::string &spec, const std::string &default_path, int fps,
+                                            double fourcc);
+
+#endif // OUTPUT_SINK_H
@@ -0,0 +1,36 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <string>
+
+#include "common.h"
+
+#define OVERLAY_FONT       1     // cv::FONT_HERSHEY_PLAIN
+#define OVERLAY_FONT_SIZE  2.0   // 原图上的字号, 缩小的图按比例缩小 (不小于 1)
+#define OVERLAY_LINE       3     // 原图上的框线宽
+
+/*
+    在 BGR 图上画追踪框和 "ID:n" 标签, 预览/编码输出端各用一个 (不跨线程共用)
+    标签不逐帧 sprintf/putText: 每个字符按当前字号渲染一次缓存起来, 之后逐字拷贝拼出标签
+    缩放比例 (字号) 变了才重建缓存
+*/
+class OverlayRenderer {
+public:
+    OverlayRenderer() : font_size(0), glyph_h(0), baseline(0) {}
+    // dets 为原图坐标; img 为原图按 scale 缩放后的图 (scale 为 1 时就是原图)
+    void draw(cv::Mat &img, const detect_result_group_t &dets, float scale);
+
+private:
+    void build_glyphs(double size);
+    // 左下角在 (x, y) 处画 "ID:<id>", 超出图像的部分裁掉
+    void draw_label(cv::Mat &img, int x, int y, int id);
+    void blit(cv::Mat &img, const cv::Mat &glyph, int x, int y);
+
+    double font_size;
+    int glyph_h;
+    int baseline;
+    cv::Mat prefix;      // "ID:"
+    cv::Mat digits[11];  // 0-9 和 '-'
+};
+
+#endif // OVERLAY_H
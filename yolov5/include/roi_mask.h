@@ -0,0 +1,48 @@
+#ifndef ROI_MASK_H
+#define ROI_MASK_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "decoder.h"
+
+#define ROI_MASK_STEP 4  // 网络坐标下判断检测框用的位图精度 (像素)
+
+/*
+    感兴趣区域掩码
+    多边形在原图坐标下定义, 加载时一次性栅格化为:
+        每个检测头的格子位图 (交给 Decoder 在 scan 阶段跳过)
+        网络输入坐标下的粗位图 (过滤检测框, 在 Re-ID 之前丢弃区域外的目标)
+    文件格式: 每行一个多边形 "x,y x,y x,y ...", # 开头为注释
+*/
+class RoiMask {
+public:
+    RoiMask() : enabled(false), grid_w(0), grid_h(0), n_head(0) {}
+    int load(const char *path);
+    /*
+        栅格化, 原图到网络输入的映射为 net = frame * scale + pad
+        scale_x/scale_y: 两个方向的缩放
+        pad_x/pad_y:     letterbox 填充
+    */
+    void rasterize(const model_meta &meta, float scale_x, float scale_y, float pad_x, float pad_y);
+    void apply(Decoder *decoder);
+    // 网络输入坐标下的点是否在区域内
+    bool contains_net(float x, float y) const;
+    /*
+        丢弃中心不在区域内的检测框, 返回丢弃个数
+        检测框为 post_process 还原后的坐标: net = det * resize_scale + offset
+    */
+    int filter(detect_result_group_t *group, float resize_scale, int h_offset, int w_offset) const;
+    bool is_enabled() const { return enabled; }
+
+private:
+    bool enabled;
+    std::vector<std::vector<float> > polygons;   // x0, y0, x1, y1, ...
+    std::vector<uint8_t> head_masks[DECODER_MAX_HEAD];
+    std::vector<uint8_t> net_mask;
+    int grid_w;
+    int grid_h;
+    int n_head;
+};
+
+#endif // ROI_MASK_H
@@ -0,0 +1,23 @@
+#ifndef SEGMENTED_H
+#define SEGMENTED_H
+
+#include <string>
+
+#define SEGMENT_OVERLAP_S   2.0   // 相邻段重叠的秒数: 后一段在重叠里热身 (轨迹确认), 也用这段拼接
+#define STITCH_MIN_FRAMES   3     // 两条轨迹在重叠里同时出现至少这么多帧才比较
+#define STITCH_IOU_MIN      0.3   // 重叠帧上的平均 IoU 下限
+#define STITCH_COS_MIN      0.5   // 外观特征余弦相似度下限 (两边都有特征时)
+#define STITCH_IOU_WEIGHT   0.5   // 综合分 = w * IoU + (1 - w) * 余弦相似度
+
+/*
+    离线视频分段并行处理
+    把 uri 切成 segments 段, 每段向前多读 SEGMENT_OVERLAP_S 秒, 作为多路 (multistream.h) 同时跑:
+    各段有自己的读帧和追踪线程, 检测与 Re-ID 上下文共用, 吞吐随段数增加直到 NPU/CPU 跑满
+    段 k 的结果只取 [k*L, (k+1)*L) 的帧, 前面的重叠只用来热身;
+    重叠帧上按 平均 IoU + 外观相似度 贪心配对前后段的轨迹, 配上的沿用前一段的全局编号
+    结果写到 VIDEO_SAVEPATH.tracks (格式见 track_log.h), 帧号为原视频的帧号
+    uri 须为能知道总帧数的非实时来源 (文件 / 图片目录 / 原始帧)
+*/
+int run_segmented(const std::string &uri, int segments);
+
+#endif // SEGMENTED_H
@@ -0,0 +1,65 @@
+#ifndef TENSOR_CORPUS_H
+#define TENSOR_CORPUS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+#include "rknn_api.h"
+
+/*
+    检测头原始输出记录 (golden corpus)
+    文件格式 (小端):
+        header:  char magic[4] = "YTC1"
+                 int32 n_output
+                 corpus_tensor_desc input
+                 corpus_tensor_desc outputs[n_output]
+        frame:   int32 frame_id
+                 outputs[0..n_output) 的原始数据, 每个 desc.size 字节
+    每帧长度固定, 可直接按帧号 seek
+*/
+#define CORPUS_MAGIC "YTC1"
+
+struct corpus_tensor_desc {
+    int32_t n_dims;
+    int32_t dims[4];
+    int32_t fmt;
+    int32_t type;
+    int32_t zp;
+    float scale;
+    uint32_t size;  // 每帧数据字节数
+};
+
+class CorpusWriter {
+public:
+    CorpusWriter(const char *path, rknn_tensor_attr *input_attr, rknn_tensor_attr *output_attrs, int n_output);
+    ~CorpusWriter();
+    bool is_open() const { return fp != NULL; }
+    // 线程安全, 多个检测线程可共用一个 writer
+    int write(int frame_id, void **outputs);
+
+private:
+    FILE *fp;
+    std::mutex mtx;
+    std::vector<uint32_t> sizes;
+};
+
+class CorpusReader {
+public:
+    CorpusReader() : n_output(0), fp(NULL) {}
+    ~CorpusReader();
+    int open(const char *path);
+    // 读下一帧, 返回 1 成功, 0 结束, -1 出错
+    int read(int &frame_id, std::vector<std::vector<int8_t> > &outputs);
+
+    // 还原出的 rknn 属性, 可直接传给 parse_model_meta
+    int n_output;
+    rknn_tensor_attr input_attr;
+    std::vector<rknn_tensor_attr> output_attrs;
+
+private:
+    FILE *fp;
+};
+
+#endif // TENSOR_CORPUS_H
@@ -0,0 +1,66 @@
+#ifndef TILER_H
+#define TILER_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "common.h"
+
+#define TILE_OVERLAP      64    // 相邻块最少重叠的原图像素, 应不小于要找的最小目标
+#define TILE_FULL_FRAME   1     // 多于一块时再跑一次整帧缩放, 找回被切开的大目标
+#define TILE_EDGE_MARGIN  2     // 框边离块内侧边界小于该值视为被截断 (原图像素)
+#define TILE_IOS_THRESH   0.6   // 被截断的框与别的块的框 交集/较小面积 超过该值则合并
+
+#define FOLLOW_ROI_SIZE       320  // 跟随模式: 目标附近裁剪区域的网络输入边长 (动态形状模型)
+#define FOLLOW_ROI_MARGIN     2.5  // 裁剪区域边长 = 目标框长边 * 该值
+#define FOLLOW_FULL_INTERVAL  10   // 跟随模式: 每隔这么多帧整帧检测一次, 发现新目标
+
+/*
+    按帧尺寸生成分块, 块大小为网络输入 (原图不缩放)
+    某个方向不超过网络输入时该方向只有一块; 整帧都放得下时只有一块 (整帧 letterbox)
+    块的起点均匀分布, 首尾贴边, 相邻块重叠不少于 overlap
+*/
+void tile_layout(int frame_w, int frame_h, int net_w, int net_h, int overlap, bool full_frame,
+                 std::vector<tile_t> &tiles);
+
+/*
+    跟随模式: 以预测的目标框 (cx, cy, w, h) 为中心的正方形裁剪区域
+    边长为长边 * FOLLOW_ROI_MARGIN, 不小于 min_side, 不超出原图, 起点取偶数
+*/
+image_rect follow_region(int frame_w, int frame_h, float cx, float cy, float w, float h, int min_side);
+
+/*
+    分块检测结果合并
+    各检测线程提交某一块的结果 (块内坐标, 即 post_process 按 tile.lb 还原后的坐标),
+    一帧的块到齐后在原图坐标下做跨块 NMS, 再按帧序号依次交给 emit (在锁内调用, 保证顺序)
+*/
+class TileMerger {
+public:
+    typedef std::function<void(imageout_idx &)> emit_fn;
+
+    explicit TileMerger(float nms_threshold) : nms_threshold(nms_threshold), next_frame(0) {}
+    void add(int frame, const nv12_frame &img, const tile_t &tile, const detect_result_group_t &dets,
+             const emit_fn &emit);
+
+private:
+    struct pending_frame {
+        pending_frame() : received(0), skipped(false) {}
+        int received;
+        bool skipped;
+        nv12_frame img;
+        std::vector<DetectBox> boxes;   // 原图坐标
+        std::vector<int> tile_of;
+        std::vector<uint8_t> truncated;
+    };
+    void merge(pending_frame &p, std::vector<DetectBox> &out);
+
+    float nms_threshold;
+    std::mutex mtx;
+    std::map<int, pending_frame> pending;
+    std::map<int, imageout_idx> done;
+    int next_frame;
+};
+
+#endif // TILER_H
@@ -1,4 +1,15 @@
+#ifndef VIDEOIO_H
+#define VIDEOIO_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 #include "opencv2/videoio/videoio_c.h"
+#include "frame.h"
+
+#define FRAME_QUEUE_DEPTH  4   // 读帧与预处理之间最多缓存的帧数
+#define INPUT_QUEUE_DEPTH  8   // 待检测的任务 (queueInput) 到这么多时预处理先不取帧
 
 struct _detect_result_group_t;  // 前置声明
 
@@ -11,9 +22,34 @@ struct video_property{
     double Video_fourcc;
 };
 
+/*
+    读帧线程 -> 预处理线程的有界帧队列
+    帧引用来源缓冲池的内存, 预处理和后面的队列用完即归还, 不在这里长期持有
+*/
+class FrameQueue {
+public:
+    FrameQueue(size_t depth) : depth(depth), closed(false), dropped(0) {}
+    // 满时 drop_oldest 丢掉最旧的一帧 (实时源), 否则等到有空位 (文件)
+    void push(const nv12_frame &frame, bool drop_oldest);
+    // 没有帧时等待; 读帧结束且取完后返回 false
+    bool pop(nv12_frame &frame);
+    // 读帧结束
+    void close();
+    long dropped_frames() const { return dropped; }
+
+private:
+    size_t depth;
+    bool closed;
+    long dropped;
+    std::deque<nv12_frame> frames;
+    std::mutex mtx;
+    std::condition_variable cv_frame;
+    std::condition_variable cv_space;
+};
 
 void videoRead(const char* video_name, int cpuid);
 void videoResize(int cpuid);
 void get_max_scale(int , int , int , int , double &, double &);
 void videoWrite(const char* save_path,int cpuid) ;
-int draw_image(cv::Mat& , struct _detect_result_group_t);
+
+#endif // VIDEOIO_H
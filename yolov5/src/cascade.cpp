@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include "cascade.h"
+
+CascadeScheduler::CascadeScheduler()
+    : last_full(-CASCADE_KEYFRAME), last_full_report(-1), lite_count(-1), escalate(false), full_frames(0),
+      lite_frames(0), escalations(0), lite_w(0), lite_h(0)
+{
+}
+
+void CascadeScheduler::set_lite_input(int w, int h)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    lite_w = w;
+    lite_h = h;
+}
+
+bool CascadeScheduler::lite_input(int &w, int &h)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    w = lite_w;
+    h = lite_h;
+    return lite_w > 0 && lite_h > 0;
+}
+
+int CascadeScheduler::choose(int frame)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (escalate || frame - last_full >= CASCADE_KEYFRAME || lite_w <= 0) {
+        escalate = false;
+        last_full = frame;
+        full_frames++;
+        return CASCADE_FULL;
+    }
+    lite_frames++;
+    return CASCADE_LITE;
+}
+
+void CascadeScheduler::report(int frame, int model, const detect_result_group_t &dets)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (model == CASCADE_FULL) {
+        last_full_report = std::max(last_full_report, frame);
+        return;
+    }
+    if (frame < last_full_report || escalate)
+        return;
+    float sum = 0;
+    for (const DetectBox &b : dets.results)
+        sum += b.confidence;
+    int n = dets.results.size();
+    bool low_conf = n > 0 && sum / n < CASCADE_CONF_THRESH;
+    bool lost = lite_count > 0 && n < lite_count * CASCADE_LOST_RATIO;
+    // 小模型找不到的小目标由关键帧的完整模型负责, 这里只和小模型自己的近期框数比
+    lite_count = lite_count < 0 ? n : lite_count + (n - lite_count) * 0.2f;
+    if (low_conf || lost) {
+        escalate = true;
+        escalations++;
+    }
+}
+
+void CascadeScheduler::print_stats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    int total = full_frames + lite_frames;
+    if (total == 0)
+        return;
+    printf("Cascade: full model on %d/%d frames (%.1f%%), %d escalations from low confidence\n", full_frames, total,
+           100.0 * full_frames / total, escalations);
+}
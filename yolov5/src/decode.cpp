@@ -18,18 +18,19 @@
 #include <string.h>
 #include <sys/time.h>
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <stdint.h>
 
 #include "decode.h"
+#include "decoder.h"
+#include "mytime.h"
 
 #define LABEL_NALE_TXT_PATH "../model/coco_80_labels_list.txt"
 
 static char *labels[OBJ_CLASS_NUM];
 
-const int anchor0[6] = {10, 13, 16, 30, 33, 23};
-const int anchor1[6] = {30, 61, 62, 45, 59, 119};
-const int anchor2[6] = {116, 90, 156, 198, 373, 326};
-
 inline static int clamp(float val, int min, int max)
 {
     return val > min ? (val < max ? val : max) : min;
@@ -75,7 +76,9 @@ char *readLine(FILE *fp, char *buffer, int *len)
 int readLines(const char *fileName, char *lines[], int max_line)
 {
     FILE *file = fopen(fileName, "r");
-    std::cout << "Does the file exists? " << (file == NULL) << "\n";
+    std::cout << "Does the file exists? " << (file != NULL) << "\n";
+    if (file == NULL)
+        return 0;
     char *s;
     int i = 0;
     int n = 0;
@@ -85,6 +88,7 @@ int readLines(const char *fileName, char *lines[], int max_line)
         if (i >= max_line)
             break;
     }
+    fclose(file);
     return i;
 }
 
@@ -142,13 +146,63 @@ static int nms(int validCount, std::vector<float> &outputLocations, std::vector<
     return 0;
 }
 
+/*
+    定点 NMS: 框为 Q(DECODE_FIX_BITS) 的 x, y, w, h
+    iou > threshold  <=>  inter * 2^16 > threshold_q16 * union, 面积用 int64, 不做除法
+*/
+static int nms_fixed(int validCount, std::vector<int32_t> &outputLocations, std::vector<int> &order, float threshold)
+{
+    const int64_t one = 1 << DECODE_FIX_BITS;
+    const int64_t thr_q16 = (int64_t)(threshold * 65536.0f + 0.5f);
+    for (int i = 0; i < validCount; ++i)
+    {
+        if (order[i] == -1)
+        {
+            continue;
+        }
+        int n = order[i];
+        int64_t xmin0 = outputLocations[n * 4 + 0];
+        int64_t ymin0 = outputLocations[n * 4 + 1];
+        int64_t xmax0 = xmin0 + outputLocations[n * 4 + 2];
+        int64_t ymax0 = ymin0 + outputLocations[n * 4 + 3];
+        int64_t area0 = (xmax0 - xmin0 + one) * (ymax0 - ymin0 + one);
+        for (int j = i + 1; j < validCount; ++j)
+        {
+            int m = order[j];
+            if (m == -1)
+            {
+                continue;
+            }
+            int64_t xmin1 = outputLocations[m * 4 + 0];
+            int64_t ymin1 = outputLocations[m * 4 + 1];
+            int64_t xmax1 = xmin1 + outputLocations[m * 4 + 2];
+            int64_t ymax1 = ymin1 + outputLocations[m * 4 + 3];
+
+            int64_t w = std::min(xmax0, xmax1) - std::max(xmin0, xmin1) + one;
+            int64_t h = std::min(ymax0, ymax1) - std::max(ymin0, ymin1) + one;
+            if (w <= 0 || h <= 0)
+            {
+                continue;
+            }
+            int64_t inter = w * h;
+            int64_t uni = area0 + (xmax1 - xmin1 + one) * (ymax1 - ymin1 + one) - inter;
+            if (uni > 0 && (inter << 16) > thr_q16 * uni)
+            {
+                order[j] = -1;
+            }
+        }
+    }
+    return 0;
+}
+
+template<typename T>
 static int quick_sort_indice_inverse(
-    std::vector<float> &input,
+    std::vector<T> &input,
     int left,
     int right,
     std::vector<int> &indices)
 {
-    float key;
+    T key;
     int key_index;
     int low = left;
     int high = right;
@@ -184,155 +238,7 @@ static int quick_sort_indice_inverse(
     return low;
 }
 
-static float sigmoid(float x)
-{
-    return 1.0 / (1.0 + expf(-x));
-}
-
-static float unsigmoid(float y)
-{
-    return -1.0 * logf((1.0 / y) - 1.0);
-}
-
-inline static int32_t __clip(float val, float min, float max)
-{
-    float f = val <= min ? min : (val >= max ? max : val);
-    return f;
-}
-
-static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
-{
-    float dst_val = (f32 / scale) + zp;
-    int8_t res = (int8_t)__clip(dst_val, -128, 127);
-    return res;
-}
-
-static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale)
-{
-    return ((float)qnt - (float)zp) * scale;
-}
-
-static int process_i8(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                   std::vector<float> &boxes, std::vector<float> &boxScores, std::vector<int> &classId,
-                   float threshold, int32_t zp, float scale)
-{
-
-    int validCount = 0;
-    int grid_len = grid_h * grid_w;
-    int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
-    for (int a = 0; a < 3; a++)
-    {
-        for (int i = 0; i < grid_h; i++)
-        {
-            for (int j = 0; j < grid_w; j++)
-            {
-                int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= thres_i8)
-                {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    int8_t *in_ptr = input + offset;
-                    float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-                    float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-                    float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-                    float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-                    box_x = (box_x + j) * (float)stride;
-                    box_y = (box_y + i) * (float)stride;
-                    box_w = box_w * box_w * (float)anchor[a * 2];
-                    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
-
-                    uint8_t maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-                    {
-                        uint8_t prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs)
-                        {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-                    if (maxClassProbs >= thres_i8) {
-                        float box_conf_f32 = sigmoid(deqnt_affine_to_f32(box_confidence, zp, scale));
-                        float class_prob_f32 = sigmoid(deqnt_affine_to_f32(maxClassProbs, zp, scale));
-                        boxScores.push_back(box_conf_f32* class_prob_f32);
-                        classId.push_back(maxClassId);
-                        validCount++;
-                        boxes.push_back(box_x);
-                        boxes.push_back(box_y);
-                        boxes.push_back(box_w);
-                        boxes.push_back(box_h);
-                    }
-                }
-            }
-        }
-    }
-    return validCount;
-}
-
-static int process_fp(float *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                   std::vector<float> &boxes, std::vector<float> &boxScores, std::vector<int> &classId,
-                   float threshold)
-{
-
-    int validCount = 0;
-    int grid_len = grid_h * grid_w;
-    float thres_sigmoid = unsigmoid(threshold);
-    
-    for (int a = 0; a < 3; a++)
-    {
-        for (int i = 0; i < grid_h; i++)
-        {
-            for (int j = 0; j < grid_w; j++)
-            {
-                float box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-                if (box_confidence >= threshold)
-                {
-                    int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-                    float *in_ptr = input + offset;
-                    float box_x = sigmoid(*in_ptr) * 2.0 - 0.5;
-                    float box_y = sigmoid(in_ptr[grid_len]) * 2.0 - 0.5;
-                    float box_w = sigmoid(in_ptr[2 * grid_len]) * 2.0;
-                    float box_h = sigmoid(in_ptr[3 * grid_len]) * 2.0;
-                    box_x = (box_x + j) * (float)stride;
-                    box_y = (box_y + i) * (float)stride;
-                    box_w = box_w * box_w * (float)anchor[a * 2];
-                    box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-                    box_x -= (box_w / 2.0);
-                    box_y -= (box_h / 2.0);
-                    boxes.push_back(box_x);
-                    boxes.push_back(box_y);
-                    boxes.push_back(box_w);
-                    boxes.push_back(box_h);
-
-                    float maxClassProbs = in_ptr[5 * grid_len];
-                    int maxClassId = 0;
-                    for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-                    {
-                        float prob = in_ptr[(5 + k) * grid_len];
-                        if (prob > maxClassProbs)
-                        {
-                            maxClassId = k;
-                            maxClassProbs = prob;
-                        }
-                    }
-                    float box_conf_f32 = sigmoid(box_confidence);
-                    float class_prob_f32 = sigmoid(maxClassProbs);
-                    boxScores.push_back(box_conf_f32* class_prob_f32);
-                    classId.push_back(maxClassId);
-                    validCount++;
-                }
-            }
-        }
-    }
-    return validCount;
-}
-
-int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
-                 int h_offset, int w_offset, float resize_scale, float conf_threshold, float nms_threshold,
-                 std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
-                 detect_result_group_t *group)
+static int load_labels_once()
 {
     static int init = -1;
     if (init == -1)
@@ -346,33 +252,31 @@ int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in
 
         init = 0;
     }
-    memset(group, 0, sizeof(detect_result_group_t));
+    return 0;
+}
 
-    std::vector<float> filterBoxes;
-    std::vector<float> boxesScore;
-    std::vector<int> classId;
-    int stride0 = 8;
-    int grid_h0 = model_in_h / stride0;
-    int grid_w0 = model_in_w / stride0;
-    int validCount0 = 0;
-    validCount0 = process_i8(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w,
-                          stride0, filterBoxes, boxesScore, classId, conf_threshold, qnt_zps[0], qnt_scales[0]);
-
-    int stride1 = 16;
-    int grid_h1 = model_in_h / stride1;
-    int grid_w1 = model_in_w / stride1;
-    int validCount1 = 0;
-    validCount1 = process_i8(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w,
-                          stride1, filterBoxes, boxesScore, classId, conf_threshold, qnt_zps[1], qnt_scales[1]);
-
-    int stride2 = 32;
-    int grid_h2 = model_in_h / stride2;
-    int grid_w2 = model_in_w / stride2;
-    int validCount2 = 0;
-    validCount2 = process_i8(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w,
-                          stride2, filterBoxes, boxesScore, classId, conf_threshold, qnt_zps[2], qnt_scales[2]);
-
-    int validCount = validCount0 + validCount1 + validCount2;
+// 网络输入坐标 -> 原图坐标, 加入结果
+static void push_detect_box(float x1, float y1, float x2, float y2, float conf, int id, int model_in_h, int model_in_w,
+                            int h_offset, int w_offset, float resize_scale, detect_result_group_t *group)
+{
+    DetectBox detbox;
+    detbox.x1 = (int)((clamp(x1, 0, model_in_w) - w_offset) / resize_scale);
+    detbox.y1 = (int)((clamp(y1, 0, model_in_h) - h_offset) / resize_scale);
+    detbox.x2 = (int)((clamp(x2, 0, model_in_w) - w_offset) / resize_scale);
+    detbox.y2 = (int)((clamp(y2, 0, model_in_h)  - h_offset) / resize_scale);
+    detbox.confidence = conf;
+    detbox.classID = id;
+    const char *label = (id < OBJ_CLASS_NUM && labels[id] != NULL) ? labels[id] : "unknown";
+    strncpy(detbox.name, label, OBJ_NAME_MAX_SIZE);
+    group->results.push_back(detbox);
+}
+
+// 候选框排序 + NMS + 还原到原图坐标
+static int filter_candidates(int validCount, std::vector<float> &filterBoxes, std::vector<float> &boxesScore,
+                             std::vector<int> &classId, int model_in_h, int model_in_w, int h_offset, int w_offset,
+                             float resize_scale, float conf_threshold, float nms_threshold, detect_result_group_t *group,
+                             post_process_timing *timing)
+{
     // no object detect
     if (validCount <= 0)
     {
@@ -385,7 +289,9 @@ int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in
         indexArray.push_back(i);
     }
 
+    double t0 = timing ? what_time_is_it_now_ns() : 0;
     quick_sort_indice_inverse(boxesScore, 0, validCount - 1, indexArray);
+    double t1 = timing ? what_time_is_it_now_ns() : 0;
 
     nms(validCount, filterBoxes, indexArray, nms_threshold);
 
@@ -405,75 +311,85 @@ int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in
         float y1 = filterBoxes[n * 4 + 1];
         float x2 = x1 + filterBoxes[n * 4 + 2];
         float y2 = y1 + filterBoxes[n * 4 + 3];
-        int id = classId[n];
-
-        DetectBox detbox;
-        detbox.x1 = (int)((clamp(x1, 0, model_in_w) - w_offset) / resize_scale);
-        detbox.y1 = (int)((clamp(y1, 0, model_in_h) - h_offset) / resize_scale);
-        detbox.x2 = (int)((clamp(x2, 0, model_in_w) - w_offset) / resize_scale);
-        detbox.y2 = (int)((clamp(y2, 0, model_in_h)  - h_offset) / resize_scale);
-        detbox.confidence = boxesScore[i];
-        detbox.classID = id;
-        char *label = labels[id];
-        strncpy(detbox.name, label, OBJ_NAME_MAX_SIZE);
-        group->results.push_back(detbox);
-
-        // printf("result %2d: (%4d, %4d, %4d, %4d), %s\n", i, detbox.box.left, detbox.box.top,
-        //        detbox.box.right, detbox.box.bottom, label);
+        push_detect_box(x1, y1, x2, y2, boxesScore[i], classId[n], model_in_h, model_in_w, h_offset, w_offset,
+                        resize_scale, group);
         last_count++;
     }
     group->count = last_count;
+    if (timing) {
+        double t2 = what_time_is_it_now_ns();
+        timing->sort_ns += t1 - t0;
+        timing->nms_ns += t2 - t1;
+    }
 
     return 0;
 }
 
-
-int post_process_fp(float *input0, float *input1, float *input2, int model_in_h, int model_in_w,
-                 int h_offset, int w_offset, float resize_scale, float conf_threshold, float nms_threshold,
-                 detect_result_group_t *group)
+int post_process(Decoder *decoder, void **outputs, bool is_quant, int h_offset, int w_offset, float resize_scale,
+                 float conf_threshold, float nms_threshold, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                 detect_result_group_t *group, post_process_timing *timing)
 {
-    static int init = -1;
-    if (init == -1)
-    {
-        int ret = 0;
-        ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
-        if (ret < 0)
-        {
-            return -1;
-        }
-
-        init = 0;
-    }
-    // printf("1______________________________________\n");
-    memset(group, 0, sizeof(detect_result_group_t));
+    if (load_labels_once() < 0)
+        return -1;
+    group->count = 0;
+    group->results.clear();
 
+    std::vector<grid_candidate> cands;
     std::vector<float> filterBoxes;
     std::vector<float> boxesScore;
     std::vector<int> classId;
-    int stride0 = 8;
-    int grid_h0 = model_in_h / stride0;
-    int grid_w0 = model_in_w / stride0;
-    int validCount0 = 0;
-    validCount0 = process_fp(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w,
-                          stride0, filterBoxes, boxesScore, classId, conf_threshold);
-
-    // printf("2______________________________________\n");
-    int stride1 = 16;
-    int grid_h1 = model_in_h / stride1;
-    int grid_w1 = model_in_w / stride1;
-    int validCount1 = 0;
-    validCount1 = process_fp(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w,
-                          stride1, filterBoxes, boxesScore, classId, conf_threshold);
-
-    int stride2 = 32;
-    int grid_h2 = model_in_h / stride2;
-    int grid_w2 = model_in_w / stride2;
-    int validCount2 = 0;
-    validCount2 = process_fp(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w,
-                          stride2, filterBoxes, boxesScore, classId, conf_threshold);
-
-    int validCount = validCount0 + validCount1 + validCount2;
-    // no object detect
+    double t0 = timing ? what_time_is_it_now_ns() : 0;
+    if (is_quant)
+        decoder->scan_i8((int8_t **)outputs, qnt_zps, qnt_scales, conf_threshold, cands);
+    else
+        decoder->scan_fp((float **)outputs, conf_threshold, cands);
+    double t1 = timing ? what_time_is_it_now_ns() : 0;
+    if (is_quant)
+        decoder->decode_i8((int8_t **)outputs, qnt_zps, qnt_scales, cands, filterBoxes, boxesScore, classId);
+    else
+        decoder->decode_fp((float **)outputs, cands, filterBoxes, boxesScore, classId);
+    if (timing) {
+        timing->scan_ns += t1 - t0;
+        timing->decode_ns += what_time_is_it_now_ns() - t1;
+        timing->candidates += cands.size();
+    }
+
+    return filter_candidates(cands.size(), filterBoxes, boxesScore, classId, decoder->meta.model_in_h,
+                             decoder->meta.model_in_w, h_offset, w_offset, resize_scale, conf_threshold,
+                             nms_threshold, group, timing);
+}
+
+/*
+    int8 定点后处理
+    框坐标和分数保持整数直到 NMS 结束, 只有保留下来的框才转成浮点并还原到原图坐标
+    decoder 不支持定点解码时回退到 post_process
+*/
+int post_process_fixed(Decoder *decoder, int8_t **outputs, int h_offset, int w_offset, float resize_scale,
+                       float conf_threshold, float nms_threshold, std::vector<int32_t> &qnt_zps,
+                       std::vector<float> &qnt_scales, detect_result_group_t *group, post_process_timing *timing)
+{
+    if (load_labels_once() < 0)
+        return -1;
+    group->count = 0;
+    group->results.clear();
+
+    std::vector<grid_candidate> cands;
+    std::vector<int32_t> filterBoxes;
+    std::vector<int32_t> boxesScore;
+    std::vector<int> classId;
+    double t0 = timing ? what_time_is_it_now_ns() : 0;
+    decoder->scan_i8(outputs, qnt_zps, qnt_scales, conf_threshold, cands);
+    double t1 = timing ? what_time_is_it_now_ns() : 0;
+    if (!decoder->decode_i8_fixed(outputs, qnt_zps, qnt_scales, cands, filterBoxes, boxesScore, classId))
+        return post_process(decoder, (void **)outputs, true, h_offset, w_offset, resize_scale, conf_threshold,
+                            nms_threshold, qnt_zps, qnt_scales, group, timing);
+    double t2 = timing ? what_time_is_it_now_ns() : 0;
+    int validCount = cands.size();
+    if (timing) {
+        timing->scan_ns += t1 - t0;
+        timing->decode_ns += t2 - t1;
+        timing->candidates += validCount;
+    }
     if (validCount <= 0)
     {
         return 0;
@@ -484,53 +400,76 @@ int post_process_fp(float *input0, float *input1, float *input2, int model_in_h,
     {
         indexArray.push_back(i);
     }
-    // printf("3______________________________________\n");
-    // filterBoxes.resize(300); classId.resize(300); boxesScore.resize(300); indexArray.resize(300); validCount = 300;
-    // for (int idx = 0; idx < 10; ++idx) std::cout << boxesScore[idx];
     quick_sort_indice_inverse(boxesScore, 0, validCount - 1, indexArray);
-    // printf("4______________________________________\n");
+    double t3 = timing ? what_time_is_it_now_ns() : 0;
 
-    nms(validCount, filterBoxes, indexArray, nms_threshold);
-    // printf("5_____________________________________\n");
-    
+    nms_fixed(validCount, filterBoxes, indexArray, nms_threshold);
+
+    const float to_float = 1.0f / (1 << DECODE_FIX_BITS);
+    const int32_t conf_q = (int32_t)(conf_threshold * (1 << DECODE_SCORE_BITS));
+    int model_in_h = decoder->meta.model_in_h;
+    int model_in_w = decoder->meta.model_in_w;
     int last_count = 0;
-    group->count = 0;
-    /* box valid detect target */
     for (int i = 0; i < validCount; ++i)
     {
-        // std::cout << "it's " << i << "\n";
-        // std::cout << boxesScore.size() << " " << indexArray.size() << "\n";
-
-        if (indexArray[i] == -1 || boxesScore[i] < conf_threshold || last_count >= OBJ_NUMB_MAX_SIZE)
+        if (indexArray[i] == -1 || boxesScore[i] < conf_q || last_count >= OBJ_NUMB_MAX_SIZE)
         {
             continue;
         }
         int n = indexArray[i];
-
-        float x1 = filterBoxes[n * 4 + 0];
-        float y1 = filterBoxes[n * 4 + 1];
-        float x2 = x1 + filterBoxes[n * 4 + 2];
-        float y2 = y1 + filterBoxes[n * 4 + 3];
-        int id = classId[n];
-        
-        DetectBox detbox;
-        detbox.x1 = (int)((clamp(x1, 0, model_in_w) - w_offset) / resize_scale);
-        detbox.y1 = (int)((clamp(y1, 0, model_in_h) - h_offset) / resize_scale);
-        detbox.x2 = (int)((clamp(x2, 0, model_in_w) - w_offset) / resize_scale);
-        detbox.y2 = (int)((clamp(y2, 0, model_in_h)  - h_offset) / resize_scale);
-        
-        detbox.confidence = boxesScore[i];
-        
-        detbox.classID = id;
-        char *label = labels[id];
-        strncpy(detbox.name, label, OBJ_NAME_MAX_SIZE);
-        group->results.push_back(detbox);
-        // printf("result %2d: (%4d, %4d, %4d, %4d), %s\n", i, detbox.box.left, detbox.box.top,
-        //        detbox.box.right, detbox.box.bottom, label);
-        
+        int32_t x = filterBoxes[n * 4 + 0];
+        int32_t y = filterBoxes[n * 4 + 1];
+        push_detect_box(x * to_float, y * to_float, (x + filterBoxes[n * 4 + 2]) * to_float,
+                        (y + filterBoxes[n * 4 + 3]) * to_float, (float)boxesScore[i] / (1 << DECODE_SCORE_BITS),
+                        classId[n], model_in_h, model_in_w, h_offset, w_offset, resize_scale, group);
         last_count++;
     }
     group->count = last_count;
-
+    if (timing) {
+        double t4 = what_time_is_it_now_ns();
+        timing->sort_ns += t3 - t2;
+        timing->nms_ns += t4 - t3;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+/*
+    默认的 yolov5 decoder (OBJ_CLASS_NUM 类, stride 8/16/32)
+    多个检测线程会同时调用, 输入尺寸也可能不同: 每个尺寸建一个, 一直留着 (尺寸只有几种), 别的线程可能还在用
+*/
+static Decoder *default_decoder(int model_in_h, int model_in_w)
+{
+    static std::mutex mtx;
+    static std::map<std::pair<int, int>, Decoder *> decoders;
+    std::lock_guard<std::mutex> lock(mtx);
+    Decoder *&decoder = decoders[std::make_pair(model_in_h, model_in_w)];
+    if (decoder == NULL)
+    {
+        model_meta meta;
+        default_model_meta(model_in_h, model_in_w, meta);
+        decoder = select_decoder(meta);
+    }
+    return decoder;
+}
+
+int post_process_i8(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
+                 int h_offset, int w_offset, float resize_scale, float conf_threshold, float nms_threshold,
+                 std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                 detect_result_group_t *group)
+{
+    void *outputs[3] = {input0, input1, input2};
+    return post_process(default_decoder(model_in_h, model_in_w), outputs, true, h_offset, w_offset, resize_scale,
+                        conf_threshold, nms_threshold, qnt_zps, qnt_scales, group);
+}
+
+
+int post_process_fp(float *input0, float *input1, float *input2, int model_in_h, int model_in_w,
+                 int h_offset, int w_offset, float resize_scale, float conf_threshold, float nms_threshold,
+                 detect_result_group_t *group)
+{
+    void *outputs[3] = {input0, input1, input2};
+    std::vector<int32_t> qnt_zps;
+    std::vector<float> qnt_scales;
+    return post_process(default_decoder(model_in_h, model_in_w), outputs, false, h_offset, w_offset, resize_scale,
+                        conf_threshold, nms_threshold, qnt_zps, qnt_scales, group);
+}
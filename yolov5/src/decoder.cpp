@@ -0,0 +1,694 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "decoder.h"
+
+/*
+    yolov5 anchors
+    P5: stride 8/16/32   P6: stride 8/16/32/64
+*/
+static const int anchors_p5[3][6] = {
+    {10, 13, 16, 30, 33, 23},
+    {30, 61, 62, 45, 59, 119},
+    {116, 90, 156, 198, 373, 326},
+};
+static const int anchors_p6[4][6] = {
+    {19, 27, 44, 40, 38, 94},
+    {96, 68, 86, 152, 180, 137},
+    {140, 301, 303, 264, 238, 542},
+    {436, 615, 739, 380, 925, 792},
+};
+
+static const int *yolov5_anchor(int n_head, int head)
+{
+    return n_head == 4 ? anchors_p6[head] : anchors_p5[head];
+}
+
+/*
+    维度描述
+    static_dim:  编译期常量, 循环次数和下标步长都是常量, 内层循环可完全展开
+    dynamic_dim: 运行期形状, 用于通用实现
+    同一份 kernel 用两种维度实例化, 保证特化版与通用版结果一致
+    特化版的网格尺寸 = 输入尺寸 / stride, 都在模板参数里, 类别数/anchor 数/网格的行列都是常量
+*/
+template<int N>
+struct static_dim {
+    static_dim(int = N) {}
+    inline int get() const { return N; }
+};
+
+struct dynamic_dim {
+    dynamic_dim(int n) : n(n) {}
+    inline int get() const { return n; }
+    int n;
+};
+
+/*---------------------------------------------------------
+    yolov5 kernels
+    scan 只做阈值判断和类别 argmax, decode 只处理候选
+----------------------------------------------------------*/
+template<class T, class GridH, class GridW, class ClassDim, class AnchorDim>
+static int yolov5_scan(T *input, const uint8_t *mask, int head, GridH grid_h, GridW grid_w, ClassDim class_num,
+                       AnchorDim anchor_num, T thres, std::vector<grid_candidate> &cands)
+{
+    const int prop_box_size = 5 + class_num.get();
+    int validCount = 0;
+    const int grid_len = grid_h.get() * grid_w.get();
+    for (int a = 0; a < anchor_num.get(); a++)
+    {
+        T *conf_ptr = input + (prop_box_size * a + 4) * grid_len;
+        for (int i = 0; i < grid_h.get(); i++)
+        {
+            for (int j = 0; j < grid_w.get(); j++)
+            {
+                if (mask != NULL && !mask[i * grid_w.get() + j])
+                    continue;
+                T box_confidence = conf_ptr[i * grid_w.get() + j];
+                if (box_confidence < thres)
+                    continue;
+                int offset = (prop_box_size * a) * grid_len + i * grid_w.get() + j;
+                T *in_ptr = input + offset;
+
+                T maxClassProbs = in_ptr[5 * grid_len];
+                int maxClassId = 0;
+                for (int k = 1; k < class_num.get(); ++k)
+                {
+                    T prob = in_ptr[(5 + k) * grid_len];
+                    if (prob > maxClassProbs)
+                    {
+                        maxClassId = k;
+                        maxClassProbs = prob;
+                    }
+                }
+                if (maxClassProbs < thres)
+                    continue;
+
+                grid_candidate c;
+                c.head = head;
+                c.anchor = a;
+                c.row = i;
+                c.col = j;
+                c.offset = offset;
+                c.class_id = maxClassId;
+                c.box_conf = box_confidence;
+                c.class_prob = maxClassProbs;
+                cands.push_back(c);
+                validCount++;
+            }
+        }
+    }
+    return validCount;
+}
+
+static void yolov5_decode_i8(int8_t *input, const int *anchor, int grid_len, int stride, const grid_candidate &c,
+                             int32_t zp, float scale, std::vector<float> &boxes, std::vector<float> &boxScores,
+                             std::vector<int> &classId)
+{
+    int8_t *in_ptr = input + c.offset;
+    float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
+    float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
+    float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
+    float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
+    box_x = (box_x + c.col) * (float)stride;
+    box_y = (box_y + c.row) * (float)stride;
+    box_w = box_w * box_w * (float)anchor[c.anchor * 2];
+    box_h = box_h * box_h * (float)anchor[c.anchor * 2 + 1];
+    box_x -= (box_w / 2.0);
+    box_y -= (box_h / 2.0);
+    boxes.push_back(box_x);
+    boxes.push_back(box_y);
+    boxes.push_back(box_w);
+    boxes.push_back(box_h);
+
+    float box_conf_f32 = sigmoid(deqnt_affine_to_f32((int8_t)c.box_conf, zp, scale));
+    float class_prob_f32 = sigmoid(deqnt_affine_to_f32((int8_t)c.class_prob, zp, scale));
+    boxScores.push_back(box_conf_f32 * class_prob_f32);
+    classId.push_back(c.class_id);
+}
+
+/*
+    int8 定点解码查表
+    每个量化值 q 对应的 xy 偏移 / wh / sigmoid 只有 256 种, 按 (zp, scale) 预先算好
+    xy: ((q * 2 - 0.5) * stride)            Q(DECODE_FIX_BITS)
+    wh: ((q * 2)^2 * anchor)                Q(DECODE_FIX_BITS), 每个 anchor 的 w, h 各一张表
+    sig: sigmoid(q)                         Q15
+*/
+struct yolov5_fixed_lut {
+    bool valid;
+    int32_t zp;
+    float scale;
+    int32_t xy[256];
+    int32_t wh[6][256];          // anchor 表每层 3 个 anchor
+    int32_t sig[256];
+};
+
+static void yolov5_build_lut(yolov5_fixed_lut &lut, const int *anchor, int anchor_num, int stride, int32_t zp, float scale)
+{
+    const float one = (float)(1 << DECODE_FIX_BITS);
+    for (int q = -128; q < 128; q++) {
+        float v = deqnt_affine_to_f32(q, zp, scale);
+        lut.xy[q + 128] = (int32_t)lroundf((v * 2.0f - 0.5f) * stride * one);
+        for (int k = 0; k < anchor_num * 2; k++)
+            lut.wh[k][q + 128] = (int32_t)lroundf((v * 2.0f) * (v * 2.0f) * anchor[k] * one);
+        lut.sig[q + 128] = (int32_t)lroundf(sigmoid(v) * (1 << 15));
+    }
+    lut.zp = zp;
+    lut.scale = scale;
+    lut.valid = true;
+}
+
+static inline void yolov5_decode_i8_fixed(int8_t *input, const yolov5_fixed_lut &lut, int grid_len, int stride,
+                                          const grid_candidate &c, std::vector<int32_t> &boxes,
+                                          std::vector<int32_t> &boxScores, std::vector<int> &classId)
+{
+    int8_t *in_ptr = input + c.offset;
+    int32_t box_w = lut.wh[c.anchor * 2][in_ptr[2 * grid_len] + 128];
+    int32_t box_h = lut.wh[c.anchor * 2 + 1][in_ptr[3 * grid_len] + 128];
+    int32_t box_x = lut.xy[in_ptr[0] + 128] + ((c.col * stride) << DECODE_FIX_BITS) - (box_w >> 1);
+    int32_t box_y = lut.xy[in_ptr[grid_len] + 128] + ((c.row * stride) << DECODE_FIX_BITS) - (box_h >> 1);
+    boxes.push_back(box_x);
+    boxes.push_back(box_y);
+    boxes.push_back(box_w);
+    boxes.push_back(box_h);
+    // Q15 * Q15 = Q30
+    boxScores.push_back(lut.sig[(int8_t)c.box_conf + 128] * lut.sig[(int8_t)c.class_prob + 128]);
+    classId.push_back(c.class_id);
+}
+
+static void yolov5_decode_fp(float *input, const int *anchor, int grid_len, int stride, const grid_candidate &c,
+                             std::vector<float> &boxes, std::vector<float> &boxScores, std::vector<int> &classId)
+{
+    float *in_ptr = input + c.offset;
+    float box_x = sigmoid(*in_ptr) * 2.0 - 0.5;
+    float box_y = sigmoid(in_ptr[grid_len]) * 2.0 - 0.5;
+    float box_w = sigmoid(in_ptr[2 * grid_len]) * 2.0;
+    float box_h = sigmoid(in_ptr[3 * grid_len]) * 2.0;
+    box_x = (box_x + c.col) * (float)stride;
+    box_y = (box_y + c.row) * (float)stride;
+    box_w = box_w * box_w * (float)anchor[c.anchor * 2];
+    box_h = box_h * box_h * (float)anchor[c.anchor * 2 + 1];
+    box_x -= (box_w / 2.0);
+    box_y -= (box_h / 2.0);
+    boxes.push_back(box_x);
+    boxes.push_back(box_y);
+    boxes.push_back(box_w);
+    boxes.push_back(box_h);
+
+    boxScores.push_back(sigmoid(c.box_conf) * sigmoid(c.class_prob));
+    classId.push_back(c.class_id);
+}
+
+/*---------------------------------------------------------
+    yolov8 kernels (anchor-free, DFL)
+    每条边的距离 = softmax(bins) 的期望
+----------------------------------------------------------*/
+template<class T, class GridH, class GridW, class ClassDim>
+static int yolov8_scan(T *score_tensor, T *sum_tensor, const uint8_t *mask, int head, GridH grid_h, GridW grid_w,
+                       ClassDim class_num, T score_thres, T sum_thres, std::vector<grid_candidate> &cands)
+{
+    int validCount = 0;
+    const int grid_len = grid_h.get() * grid_w.get();
+    for (int i = 0; i < grid_h.get(); i++)
+    {
+        for (int j = 0; j < grid_w.get(); j++)
+        {
+            int offset = i * grid_w.get() + j;
+            if (mask != NULL && !mask[offset])
+                continue;
+            // score_sum 为所有类别分数之和, 低于阈值的格子直接跳过
+            if (sum_tensor != nullptr && sum_tensor[offset] < sum_thres)
+                continue;
+
+            T maxClassProbs = score_tensor[offset];
+            int maxClassId = 0;
+            for (int k = 1; k < class_num.get(); k++)
+            {
+                T prob = score_tensor[k * grid_len + offset];
+                if (prob > maxClassProbs)
+                {
+                    maxClassId = k;
+                    maxClassProbs = prob;
+                }
+            }
+            if (maxClassProbs < score_thres)
+                continue;
+
+            grid_candidate c;
+            c.head = head;
+            c.anchor = 0;
+            c.row = i;
+            c.col = j;
+            c.offset = offset;
+            c.class_id = maxClassId;
+            c.box_conf = 1;
+            c.class_prob = maxClassProbs;
+            cands.push_back(c);
+            validCount++;
+        }
+    }
+    return validCount;
+}
+
+template<class RegDim>
+static inline float dfl_expect(const float *bins, RegDim reg_max)
+{
+    float max_val = bins[0];
+    for (int k = 1; k < reg_max.get(); k++)
+        max_val = bins[k] > max_val ? bins[k] : max_val;
+    float sum = 0, acc = 0;
+    for (int k = 0; k < reg_max.get(); k++) {
+        float e = expf(bins[k] - max_val);
+        sum += e;
+        acc += e * k;
+    }
+    return acc / sum;
+}
+
+template<class T, class RegDim>
+static void yolov8_decode(T *box_tensor, int grid_len, int stride, RegDim reg_max, const grid_candidate &c,
+                          int32_t zp, float scale, std::vector<float> &boxes)
+{
+    float bins[DFL_MAX_REG];
+    float dist[4];
+    for (int b = 0; b < 4; b++) {
+        for (int k = 0; k < reg_max.get(); k++) {
+            T v = box_tensor[(b * reg_max.get() + k) * grid_len + c.offset];
+            bins[k] = scale == 0 ? (float)v : deqnt_affine_to_f32(v, zp, scale);
+        }
+        dist[b] = dfl_expect(bins, reg_max);
+    }
+    float x1 = (c.col + 0.5f - dist[0]) * stride;
+    float y1 = (c.row + 0.5f - dist[1]) * stride;
+    float x2 = (c.col + 0.5f + dist[2]) * stride;
+    float y2 = (c.row + 0.5f + dist[3]) * stride;
+    boxes.push_back(x1);
+    boxes.push_back(y1);
+    boxes.push_back(x2 - x1);
+    boxes.push_back(y2 - y1);
+}
+
+/*---------------------------------------------------------
+    yolov5 decoders
+    特化版与通用版只在 scan 上不同
+----------------------------------------------------------*/
+class Yolov5DecoderBase : public Decoder {
+public:
+    using Decoder::Decoder;
+
+    void decode_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                   const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                   std::vector<float> &boxScores, std::vector<int> &classId) override
+    {
+        for (const grid_candidate &c : cands)
+            yolov5_decode_i8(outputs[c.head], yolov5_anchor(meta.n_head, c.head), meta.grid_h[c.head] * meta.grid_w[c.head],
+                             meta.strides[c.head], c, qnt_zps[c.head], qnt_scales[c.head], boxes, boxScores, classId);
+    }
+
+    bool decode_i8_fixed(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                         const std::vector<grid_candidate> &cands, std::vector<int32_t> &boxes,
+                         std::vector<int32_t> &boxScores, std::vector<int> &classId) override
+    {
+        if (meta.anchor_num > 3)
+            return false;
+        // 量化参数变化时才重建查表
+        for (int h = 0; h < meta.n_head; h++) {
+            if (!luts[h].valid || luts[h].zp != qnt_zps[h] || luts[h].scale != qnt_scales[h])
+                yolov5_build_lut(luts[h], yolov5_anchor(meta.n_head, h), meta.anchor_num, meta.strides[h],
+                                 qnt_zps[h], qnt_scales[h]);
+        }
+        for (const grid_candidate &c : cands)
+            yolov5_decode_i8_fixed(outputs[c.head], luts[c.head], meta.grid_h[c.head] * meta.grid_w[c.head],
+                                   meta.strides[c.head], c, boxes, boxScores, classId);
+        return true;
+    }
+
+    void decode_fp(float **outputs, const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                   std::vector<float> &boxScores, std::vector<int> &classId) override
+    {
+        for (const grid_candidate &c : cands)
+            yolov5_decode_fp(outputs[c.head], yolov5_anchor(meta.n_head, c.head), meta.grid_h[c.head] * meta.grid_w[c.head],
+                             meta.strides[c.head], c, boxes, boxScores, classId);
+    }
+
+private:
+    yolov5_fixed_lut luts[DECODER_MAX_HEAD] = {};
+};
+
+// 模型输入 IN_H x IN_W 与各头的 stride 都固定, 每个头的网格尺寸在编译期展开
+template<int CLASS_NUM, int ANCHOR_NUM, int IN_H, int IN_W, int... STRIDES>
+class Yolov5Decoder : public Yolov5DecoderBase {
+public:
+    using Yolov5DecoderBase::Yolov5DecoderBase;
+    const char *name() const override { return "yolov5-specialized"; }
+
+    static bool match(const model_meta &m)
+    {
+        static const int strides[] = {STRIDES...};
+        if (m.family != DECODER_YOLOV5 || m.class_num != CLASS_NUM || m.anchor_num != ANCHOR_NUM
+            || m.model_in_h != IN_H || m.model_in_w != IN_W || m.n_head != (int)sizeof...(STRIDES))
+            return false;
+        for (int h = 0; h < m.n_head; h++)
+            if (m.strides[h] != strides[h] || m.grid_h[h] != IN_H / strides[h] || m.grid_w[h] != IN_W / strides[h])
+                return false;
+        return true;
+    }
+
+    int scan_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                float threshold, std::vector<grid_candidate> &cands) override
+    {
+        return scan_heads<0, STRIDES...>(outputs, qnt_zps, qnt_scales, threshold, cands);
+    }
+
+    int scan_fp(float **outputs, float threshold, std::vector<grid_candidate> &cands) override
+    {
+        return scan_heads<0, STRIDES...>(outputs, threshold, cands);
+    }
+
+private:
+    template<int H>
+    int scan_heads(int8_t **, std::vector<int32_t> &, std::vector<float> &, float, std::vector<grid_candidate> &)
+    {
+        return 0;
+    }
+    template<int H, int S, int... REST>
+    int scan_heads(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                   float threshold, std::vector<grid_candidate> &cands)
+    {
+        return yolov5_scan(outputs[H], cell_mask[H], H, static_dim<IN_H / S>(), static_dim<IN_W / S>(),
+                           static_dim<CLASS_NUM>(), static_dim<ANCHOR_NUM>(),
+                           qnt_f32_to_affine(threshold, qnt_zps[H], qnt_scales[H]), cands)
+             + scan_heads<H + 1, REST...>(outputs, qnt_zps, qnt_scales, threshold, cands);
+    }
+    template<int H>
+    int scan_heads(float **, float, std::vector<grid_candidate> &)
+    {
+        return 0;
+    }
+    template<int H, int S, int... REST>
+    int scan_heads(float **outputs, float threshold, std::vector<grid_candidate> &cands)
+    {
+        return yolov5_scan(outputs[H], cell_mask[H], H, static_dim<IN_H / S>(), static_dim<IN_W / S>(),
+                           static_dim<CLASS_NUM>(), static_dim<ANCHOR_NUM>(), threshold, cands)
+             + scan_heads<H + 1, REST...>(outputs, threshold, cands);
+    }
+};
+
+class Yolov5GenericDecoder : public Yolov5DecoderBase {
+public:
+    using Yolov5DecoderBase::Yolov5DecoderBase;
+    const char *name() const override { return "yolov5-generic"; }
+
+    int scan_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                float threshold, std::vector<grid_candidate> &cands) override
+    {
+        int validCount = 0;
+        for (int h = 0; h < meta.n_head; h++)
+            validCount += yolov5_scan(outputs[h], cell_mask[h], h, dynamic_dim(meta.grid_h[h]), dynamic_dim(meta.grid_w[h]),
+                                      dynamic_dim(meta.class_num), dynamic_dim(meta.anchor_num),
+                                      qnt_f32_to_affine(threshold, qnt_zps[h], qnt_scales[h]), cands);
+        return validCount;
+    }
+
+    int scan_fp(float **outputs, float threshold, std::vector<grid_candidate> &cands) override
+    {
+        int validCount = 0;
+        for (int h = 0; h < meta.n_head; h++)
+            validCount += yolov5_scan(outputs[h], cell_mask[h], h, dynamic_dim(meta.grid_h[h]), dynamic_dim(meta.grid_w[h]),
+                                      dynamic_dim(meta.class_num), dynamic_dim(meta.anchor_num), threshold, cands);
+        return validCount;
+    }
+};
+
+/*---------------------------------------------------------
+    yolov8 decoders
+    输出顺序: head0 box, head0 cls, [head0 sum], head1 box, ...
+----------------------------------------------------------*/
+template<class ClassDim, class RegDim>
+class Yolov8DecoderImpl : public Decoder {
+public:
+    Yolov8DecoderImpl(const model_meta &meta) : Decoder(meta), class_num(meta.class_num), reg_max(meta.reg_max) {}
+
+    int scan_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                float threshold, std::vector<grid_candidate> &cands) override
+    {
+        int validCount = 0;
+        for (int h = 0; h < meta.n_head; h++)
+            validCount += scan_head(outputs, qnt_zps, qnt_scales, threshold, h, dynamic_dim(meta.grid_h[h]),
+                                    dynamic_dim(meta.grid_w[h]), cands);
+        return validCount;
+    }
+
+    void decode_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                   const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                   std::vector<float> &boxScores, std::vector<int> &classId) override
+    {
+        for (const grid_candidate &c : cands) {
+            int base = c.head * meta.out_per_head;
+            yolov8_decode(outputs[base], meta.grid_h[c.head] * meta.grid_w[c.head], meta.strides[c.head], reg_max, c,
+                          qnt_zps[base], qnt_scales[base], boxes);
+            boxScores.push_back(deqnt_affine_to_f32((int8_t)c.class_prob, qnt_zps[base + 1], qnt_scales[base + 1]));
+            classId.push_back(c.class_id);
+        }
+    }
+
+    int scan_fp(float **outputs, float threshold, std::vector<grid_candidate> &cands) override
+    {
+        int validCount = 0;
+        for (int h = 0; h < meta.n_head; h++)
+            validCount += scan_head(outputs, threshold, h, dynamic_dim(meta.grid_h[h]), dynamic_dim(meta.grid_w[h]), cands);
+        return validCount;
+    }
+
+    void decode_fp(float **outputs, const std::vector<grid_candidate> &cands, std::vector<float> &boxes,
+                   std::vector<float> &boxScores, std::vector<int> &classId) override
+    {
+        for (const grid_candidate &c : cands) {
+            int base = c.head * meta.out_per_head;
+            yolov8_decode(outputs[base], meta.grid_h[c.head] * meta.grid_w[c.head], meta.strides[c.head], reg_max, c,
+                          0, 0.f, boxes);
+            boxScores.push_back(c.class_prob);
+            classId.push_back(c.class_id);
+        }
+    }
+
+protected:
+    // 一个头的 scan, 网格尺寸由调用方给 (通用版运行期, 特化版编译期)
+    template<class GridH, class GridW>
+    int scan_head(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales, float threshold,
+                  int h, GridH grid_h, GridW grid_w, std::vector<grid_candidate> &cands)
+    {
+        int base = h * meta.out_per_head;
+        int sum_idx = meta.out_per_head == 3 ? base + 2 : base + 1;
+        return yolov8_scan(outputs[base + 1], meta.out_per_head == 3 ? outputs[base + 2] : (int8_t *)nullptr,
+                           this->cell_mask[h], h, grid_h, grid_w, class_num,
+                           qnt_f32_to_affine(threshold, qnt_zps[base + 1], qnt_scales[base + 1]),
+                           qnt_f32_to_affine(threshold, qnt_zps[sum_idx], qnt_scales[sum_idx]), cands);
+    }
+    template<class GridH, class GridW>
+    int scan_head(float **outputs, float threshold, int h, GridH grid_h, GridW grid_w, std::vector<grid_candidate> &cands)
+    {
+        int base = h * meta.out_per_head;
+        return yolov8_scan(outputs[base + 1], meta.out_per_head == 3 ? outputs[base + 2] : (float *)nullptr,
+                           this->cell_mask[h], h, grid_h, grid_w, class_num, threshold, threshold, cands);
+    }
+
+    ClassDim class_num;
+    RegDim reg_max;
+};
+
+template<int CLASS_NUM, int REG_MAX, int IN_H, int IN_W, int... STRIDES>
+class Yolov8Decoder : public Yolov8DecoderImpl<static_dim<CLASS_NUM>, static_dim<REG_MAX> > {
+    typedef Yolov8DecoderImpl<static_dim<CLASS_NUM>, static_dim<REG_MAX> > Impl;
+public:
+    using Impl::Impl;
+    const char *name() const override { return "yolov8-specialized"; }
+
+    static bool match(const model_meta &m)
+    {
+        static const int strides[] = {STRIDES...};
+        if (m.family != DECODER_YOLOV8 || m.class_num != CLASS_NUM || m.reg_max != REG_MAX
+            || m.model_in_h != IN_H || m.model_in_w != IN_W || m.n_head != (int)sizeof...(STRIDES))
+            return false;
+        for (int h = 0; h < m.n_head; h++)
+            if (m.strides[h] != strides[h] || m.grid_h[h] != IN_H / strides[h] || m.grid_w[h] != IN_W / strides[h])
+                return false;
+        return true;
+    }
+
+    int scan_i8(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                float threshold, std::vector<grid_candidate> &cands) override
+    {
+        return scan_heads<0, STRIDES...>(outputs, qnt_zps, qnt_scales, threshold, cands);
+    }
+
+    int scan_fp(float **outputs, float threshold, std::vector<grid_candidate> &cands) override
+    {
+        return scan_heads<0, STRIDES...>(outputs, threshold, cands);
+    }
+
+private:
+    template<int H>
+    int scan_heads(int8_t **, std::vector<int32_t> &, std::vector<float> &, float, std::vector<grid_candidate> &)
+    {
+        return 0;
+    }
+    template<int H, int S, int... REST>
+    int scan_heads(int8_t **outputs, std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                   float threshold, std::vector<grid_candidate> &cands)
+    {
+        return this->scan_head(outputs, qnt_zps, qnt_scales, threshold, H, static_dim<IN_H / S>(),
+                               static_dim<IN_W / S>(), cands)
+             + scan_heads<H + 1, REST...>(outputs, qnt_zps, qnt_scales, threshold, cands);
+    }
+    template<int H>
+    int scan_heads(float **, float, std::vector<grid_candidate> &)
+    {
+        return 0;
+    }
+    template<int H, int S, int... REST>
+    int scan_heads(float **outputs, float threshold, std::vector<grid_candidate> &cands)
+    {
+        return this->scan_head(outputs, threshold, H, static_dim<IN_H / S>(), static_dim<IN_W / S>(), cands)
+             + scan_heads<H + 1, REST...>(outputs, threshold, cands);
+    }
+};
+
+class Yolov8GenericDecoder : public Yolov8DecoderImpl<dynamic_dim, dynamic_dim> {
+public:
+    using Yolov8DecoderImpl<dynamic_dim, dynamic_dim>::Yolov8DecoderImpl;
+    const char *name() const override { return "yolov8-generic"; }
+};
+
+/*---------------------------------------------------------
+    注册表
+----------------------------------------------------------*/
+template<class T>
+static Decoder *create_decoder(const model_meta &meta)
+{
+    return new T(meta);
+}
+
+#define DECODER_ENTRY(name, ...) \
+    decoder_entry{name, &__VA_ARGS__::match, &create_decoder<__VA_ARGS__>}
+
+static std::vector<decoder_entry> &decoder_registry()
+{
+    // 内置的特化实现, 新模型在这里或通过 register_decoder 添加
+    static std::vector<decoder_entry> registry = {
+        // 按 (类别, 输入尺寸, stride) 特化; 其他输入尺寸 (跟随模式的小输入等) 用通用实现
+        DECODER_ENTRY("yolov5-coco80-p5-640", Yolov5Decoder<80, 3, 640, 640, 8, 16, 32>),
+        DECODER_ENTRY("yolov5-coco80-p5-320", Yolov5Decoder<80, 3, 320, 320, 8, 16, 32>),
+        DECODER_ENTRY("yolov5-2cls-p5-640", Yolov5Decoder<2, 3, 640, 640, 8, 16, 32>),
+        DECODER_ENTRY("yolov5-coco80-p6-1280", Yolov5Decoder<80, 3, 1280, 1280, 8, 16, 32, 64>),
+        DECODER_ENTRY("yolov8-coco80-640", Yolov8Decoder<80, 16, 640, 640, 8, 16, 32>),
+        DECODER_ENTRY("yolov8-coco80-320", Yolov8Decoder<80, 16, 320, 320, 8, 16, 32>),
+        DECODER_ENTRY("yolov8-2cls-640", Yolov8Decoder<2, 16, 640, 640, 8, 16, 32>),
+    };
+    return registry;
+}
+
+void register_decoder(const decoder_entry &entry)
+{
+    decoder_registry().push_back(entry);
+}
+
+Decoder *select_decoder(const model_meta &meta)
+{
+    for (const decoder_entry &entry : decoder_registry()) {
+        if (entry.match(meta)) {
+            printf("select decoder: %s\n", entry.name);
+            return entry.create(meta);
+        }
+    }
+    return select_generic_decoder(meta);
+}
+
+Decoder *select_generic_decoder(const model_meta &meta)
+{
+    if (meta.family == DECODER_YOLOV5) {
+        if (meta.anchor_num != 3 || meta.n_head < 3) {
+            printf("select decoder: no anchors for %d heads x %d anchors\n", meta.n_head, meta.anchor_num);
+            return NULL;
+        }
+        printf("select decoder: yolov5-generic (%d classes)\n", meta.class_num);
+        return new Yolov5GenericDecoder(meta);
+    }
+    printf("select decoder: yolov8-generic (%d classes, reg_max %d)\n", meta.class_num, meta.reg_max);
+    return new Yolov8GenericDecoder(meta);
+}
+
+/*---------------------------------------------------------
+    由模型输出属性推断检测头结构
+    只支持 NCHW 输出: dims = [1, C, H, W]
+----------------------------------------------------------*/
+int parse_model_meta(rknn_tensor_attr *input_attr, rknn_tensor_attr *output_attrs, int n_output, model_meta &meta)
+{
+    memset(&meta, 0, sizeof(meta));
+    // 输入为 NHWC
+    meta.model_in_h = input_attr->dims[1];
+    meta.model_in_w = input_attr->dims[2];
+    meta.n_output = n_output;
+
+    for (int i = 0; i < n_output; i++) {
+        if (output_attrs[i].fmt != RKNN_TENSOR_NCHW || output_attrs[i].n_dims != 4) {
+            printf("parse_model_meta: output %d is not a NCHW tensor\n", i);
+            return -1;
+        }
+    }
+
+    if (n_output >= 3 && n_output <= DECODER_MAX_HEAD) {
+        int channel = output_attrs[0].dims[1];
+        meta.family = DECODER_YOLOV5;
+        meta.n_head = n_output;
+        meta.anchor_num = nanchor;
+        meta.class_num = channel / meta.anchor_num - 5;
+        meta.out_per_head = 1;
+    }
+    else if (n_output == 6 || n_output == 9 || n_output == 8 || n_output == 12) {
+        // yolov8: 每个头 2 个 (box, cls) 或 3 个 (box, cls, sum) 输出
+        meta.family = DECODER_YOLOV8;
+        meta.out_per_head = (output_attrs[2].dims[1] == 1) ? 3 : 2;
+        meta.n_head = n_output / meta.out_per_head;
+        meta.reg_max = output_attrs[0].dims[1] / 4;
+        meta.class_num = output_attrs[1].dims[1];
+        if (meta.reg_max > DFL_MAX_REG || meta.n_head > DECODER_MAX_HEAD) {
+            printf("parse_model_meta: unsupported yolov8 head (reg_max %d)\n", meta.reg_max);
+            return -1;
+        }
+    }
+    else {
+        printf("parse_model_meta: unsupported output number %d\n", n_output);
+        return -1;
+    }
+
+    for (int h = 0; h < meta.n_head; h++) {
+        rknn_tensor_attr &attr = output_attrs[h * meta.out_per_head];
+        meta.grid_h[h] = attr.dims[2];
+        meta.grid_w[h] = attr.dims[3];
+        meta.strides[h] = meta.model_in_h / meta.grid_h[h];
+    }
+    if (meta.family == DECODER_YOLOV5 && meta.class_num <= 0) {
+        printf("parse_model_meta: bad yolov5 output channel %d\n", output_attrs[0].dims[1]);
+        return -1;
+    }
+    return 0;
+}
+
+void default_model_meta(int model_in_h, int model_in_w, model_meta &meta)
+{
+    memset(&meta, 0, sizeof(meta));
+    meta.family = DECODER_YOLOV5;
+    meta.model_in_h = model_in_h;
+    meta.model_in_w = model_in_w;
+    meta.n_output = nyolo;
+    meta.n_head = nyolo;
+    meta.class_num = OBJ_CLASS_NUM;
+    meta.anchor_num = nanchor;
+    meta.out_per_head = 1;
+    for (int h = 0; h < nyolo; h++) {
+        meta.strides[h] = 8 << h;
+        meta.grid_h[h] = model_in_h / meta.strides[h];
+        meta.grid_w[h] = model_in_w / meta.strides[h];
+    }
+}
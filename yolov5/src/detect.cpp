@@ -1,10 +1,15 @@
 #include <unistd.h>
+#include <string.h>
+#include <algorithm>
 
 #include "common.h"
 #include "mytime.h"
 #include "decode.h"
 #include "detect.h"
 #include "videoio.h"
+#include "tensor_corpus.h"
+#include "tiler.h"
+#include "cascade.h"
 
 using namespace std;
 
@@ -19,6 +24,211 @@ extern mutex mtxQueueInput;
 extern queue<input_image> queueInput;  // input queue
 extern mutex mtxQueueDetOut;
 extern queue<imageout_idx> queueDetOut;// Det output queue
+extern string CORPUS_SAVEPATH;         // 非空时记录检测头原始输出
+extern string ROI_PATH;                // 非空时只检测区域内的目标
+extern string IMAGE_BACKEND;
+extern bool TILED_INFERENCE;
+extern bool FOLLOW_ROI;
+extern bool DETECT_CASCADE;
+extern bool POST_PROCESS_FIXED;
+extern string YOLO_LITE_MODEL_PATH;
+extern CascadeScheduler cascadeScheduler;
+
+static CorpusWriter *corpus = NULL;    // 多个检测线程共用
+static mutex mtxCorpus;
+static TileMerger tile_merger(NMS_THRESH);  // 分块模式下多个检测线程共用
+
+Decoder *Yolo::current_decoder(rknn_fp *net){
+	for (auto &d : decoders) {
+		if (d.first == net && d.second->meta.model_in_h == net->input_h() && d.second->meta.model_in_w == net->input_w())
+			return d.second;
+	}
+	// 动态形状模型切到新尺寸或级联的小模型: 按其输出属性 (网格大小) 再选一个
+	model_meta meta;
+	if (parse_model_meta(&net->_input_attrs[0], net->_output_attrs, net->_n_output, meta) < 0)
+		default_model_meta(net->input_h(), net->input_w(), meta);
+	Decoder *d = select_decoder(meta);
+	if (d != NULL) {
+		printf("decoder for %dx%d input: %s\n", net->input_w(), net->input_h(), d->name());
+		decoders.push_back(std::make_pair(net, d));
+	}
+	return d;
+}
+
+// 第一次检测前: 按模型输出属性选择后处理, 加载级联小模型/感兴趣区域/原始输出记录
+int Yolo::prepare(bool single_stream){
+	if (decoder != NULL)
+		return 0;
+	model_meta meta;
+	if (parse_model_meta(&_input_attrs[0], _output_attrs, _n_output, meta) < 0)
+		default_model_meta(NET_INPUTHEIGHT, NET_INPUTWIDTH, meta);
+	decoder = select_decoder(meta);
+	if (decoder == NULL) {
+		printf("No decoder for this model\n");
+		return -1;
+	}
+	decoders.push_back(std::make_pair((rknn_fp *)this, decoder));
+	if (DETECT_CASCADE && lite == NULL) {
+		lite = new rknn_fp(YOLO_LITE_MODEL_PATH.c_str(), _cpu_id, _core_mask, 1, 3);
+		// videoResize 按小模型自己的输入尺寸 letterbox
+		cascadeScheduler.set_lite_input(lite->input_w(), lite->input_h());
+	}
+	// 区域在拿到第一帧的 letterbox 后栅格化; 区域按某一路相机画, 多路时不用
+	use_roi = single_stream && !ROI_PATH.empty() && roi.load(ROI_PATH.c_str()) == 0;
+	memset(&roi_lb, 0, sizeof(roi_lb));
+	memset(input_lb, 0, sizeof(input_lb));
+	if (single_stream && !CORPUS_SAVEPATH.empty()) {
+		mtxCorpus.lock();
+		if (corpus == NULL)
+			corpus = new CorpusWriter(CORPUS_SAVEPATH.c_str(), &_input_attrs[0], _output_attrs, _n_output);
+		mtxCorpus.unlock();
+	}
+	return 0;
+}
+
+int Yolo::detect(input_image &input, detect_result_group_t &detect_result_group){
+	int cost_time = 0;
+	const letterbox_t &lb = input.lb;
+	if (use_roi && (roi_lb.src_w != lb.src_w || roi_lb.src_h != lb.src_h)) {
+		roi.rasterize(decoder->meta, lb.scale_x, lb.scale_y, lb.pad_left, lb.pad_top);
+		// 格子掩码按整帧映射栅格化, 分块/跟随/级联时各块映射不同, 只在合并后过滤
+		if (!TILED_INFERENCE && !FOLLOW_ROI && !DETECT_CASCADE)
+			roi.apply(decoder);
+		roi_lb = lb;
+	}
+
+	bool tiled = input.tile.n_tiles > 0;
+	// detection interval to speed up
+	bool do_detect = input.index < this->det_interval || !(input.index % this->det_interval);
+	// 运动门控: 静止画面不跑 NPU, 交给追踪预测
+	detect_result_group.id = input.index;
+	detect_result_group.skipped = do_detect && !input.motion;
+	if (do_detect && input.motion) {
+		double timeBeforeDetection = what_time_is_it_now();
+		// 级联模式由 videoResize 逐帧选模型, 两个模型的输入都由本线程从原图写入
+		bool use_lite = input.model == CASCADE_LITE && lite != NULL;
+		rknn_fp *net = use_lite ? lite : this;
+		// 还原到原图 (分块时到块内) 坐标, letterbox 等比缩放, 两个方向比例相同
+		letterbox_t geom = tiled ? input.tile.lb : lb;
+		// 块 (如跟随模式的小输入) 与当前输入尺寸不同时切换; 模型不支持时按当前尺寸重新 letterbox
+		if (geom.dst_w != net->input_w() || geom.dst_h != net->input_h()) {
+			if (net->set_input_size(geom.dst_h, geom.dst_w) < 0) {
+				if (!tiled) {
+					printf("input %dx%d does not match model input\n", geom.dst_w, geom.dst_h);
+					return -1;
+				}
+				if (!warned_fixed_shape) {
+					printf("model has no %dx%d input shape, tile uses %dx%d\n", geom.dst_w, geom.dst_h,
+						   net->input_w(), net->input_h());
+					warned_fixed_shape = true;
+				}
+				letterbox_init(geom, geom.src_w, geom.src_h, net->input_w(), net->input_h(), true);
+			}
+		}
+		unsigned char *input_data = input.img_pad.data;
+		if (tiled) {
+			// 块直接写进输入 tensor, 几何不变时边框还在, 只写内容区域
+			if (pre == NULL)
+				pre = create_image_processor(IMAGE_BACKEND.c_str());
+			input_data = net->input_buffer();
+			image_view dst = make_image_view(input_data, geom.dst_w, geom.dst_h, IMAGE_RGB888);
+			image_rect content = {geom.pad_left, geom.pad_top, geom.resize_w, geom.resize_h};
+			if (memcmp(&input_lb[use_lite], &geom, sizeof(letterbox_t)) != 0) {
+				fill_letterbox_pad(dst, geom);
+				input_lb[use_lite] = geom;
+			}
+			pre->process(input.img_src.view(), input.tile.region, dst, content);
+		}
+		else {
+			// 整帧从 img_pad 拷进输入 tensor, 边框也一起覆盖
+			memset(&input_lb[0], 0, sizeof(letterbox_t));
+		}
+		cost_time = net->inference(input_data);
+		if(cost_time == -1)
+			printf("NPU inference Error");
+		else if (corpus != NULL && net == this)
+			corpus->write(input.index, _output_buff);
+		decode(net, net->_output_buff, geom, detect_result_group);
+		// 区域外的目标不进入追踪, 省去 Re-ID
+		if (!tiled)
+			roi.filter(&detect_result_group, lb.scale_x, lb.pad_top, lb.pad_left);
+		if (DETECT_CASCADE)
+			cascadeScheduler.report(input.index, input.model, detect_result_group);
+
+		double timeAfterDetection = what_time_is_it_now();
+
+		cout << "--------Time cost in Detection: " << timeAfterDetection - timeBeforeDetection << "\n";
+		
+	}
+	return cost_time;
+}
+
+void Yolo::decode(rknn_fp *net, void **outputs, const letterbox_t &geom, detect_result_group_t &detect_result_group){
+	Decoder *dec = current_decoder(net);
+	out_scales.clear();
+	out_zps.clear();
+	for (int i = 0; i < net->_n_output; ++i) {
+		out_scales.push_back(net->_output_attrs[i].scale);
+		out_zps.push_back(net->_output_attrs[i].zp);
+	}
+
+	// post_process_fp((float *)_output_buff[0], (float *)_output_buff[1], (float *)_output_buff[2],
+				// NET_INPUTHEIGHT, NET_INPUTWIDTH, 0, 0, resize_scale, BOX_THRESH, NMS_THRESH, &detect_result_group);
+
+	if (POST_PROCESS_FIXED)
+		post_process_fixed(dec, (int8_t **)outputs, geom.pad_top, geom.pad_left, geom.scale_x,
+						   BOX_THRESH, NMS_THRESH, out_zps, out_scales, &detect_result_group);
+	else
+		post_process(dec, outputs, true, geom.pad_top, geom.pad_left, geom.scale_x,
+					 BOX_THRESH, NMS_THRESH, out_zps, out_scales, &detect_result_group);
+	// 伸进边框的部分裁掉
+	for (DetectBox &b : detect_result_group.results) {
+		b.x1 = std::min(std::max(b.x1, 0.f), (float)geom.src_w);
+		b.y1 = std::min(std::max(b.y1, 0.f), (float)geom.src_h);
+		b.x2 = std::min(std::max(b.x2, 0.f), (float)geom.src_w);
+		b.y2 = std::min(std::max(b.y2, 0.f), (float)geom.src_h);
+	}
+}
+
+int Yolo::detect_batch(vector<input_image> &inputs, vector<detect_result_group_t> &outs){
+	int n = std::min((int)inputs.size(), batch());
+	if (pre == NULL)
+		pre = create_image_processor(IMAGE_BACKEND.c_str());
+	batch_lb.resize(batch());
+	outs.assign(inputs.size(), detect_result_group_t());
+	// 各路分辨率可以不同, 每个位置按自己的 letterbox 写, 几何不变时边框还在, 只写内容区域
+	for (int b = 0; b < n; b++) {
+		const input_image &in = inputs[b];
+		const letterbox_t &geom = in.tile.lb;
+		if (geom.dst_w != input_w() || geom.dst_h != input_h()) {
+			printf("input %dx%d does not match model input\n", geom.dst_w, geom.dst_h);
+			return -1;
+		}
+		image_view dst = make_image_view(input_buffer(b), geom.dst_w, geom.dst_h, IMAGE_RGB888);
+		image_rect content = {geom.pad_left, geom.pad_top, geom.resize_w, geom.resize_h};
+		if (memcmp(&batch_lb[b], &geom, sizeof(letterbox_t)) != 0) {
+			fill_letterbox_pad(dst, geom);
+			batch_lb[b] = geom;
+		}
+		pre->process(in.img_src.view(), in.tile.region, dst, content);
+	}
+	memset(&input_lb[0], 0, sizeof(letterbox_t));  // 单张 detect 的边框缓存已被覆盖
+
+	int cost_time = inference(input_buffer());
+	if (cost_time == -1) {
+		printf("NPU inference Error");
+		return -1;
+	}
+	void *outputs[RKNN_MAX_OUTPUT];
+	for (int b = 0; b < n; b++) {
+		for (int i = 0; i < _n_output; i++)
+			outputs[i] = output_buffer(i, b);
+		outs[b].id = inputs[b].index;
+		outs[b].skipped = false;
+		decode(this, outputs, inputs[b].tile.lb, outs[b]);
+	}
+	return cost_time;
+}
 
 int Yolo::detect_process(){
 	
@@ -27,29 +237,9 @@ int Yolo::detect_process(){
 	int cost_time = 0; // rknn接口查询返回
 	float npu_performance = 0.0;
 
-	// Letter box resize
-	float img_wh_ratio = (float)IMG_WIDTH / (float)IMG_HEIGHT;
-	float input_wh_ratio = (float)NET_INPUTWIDTH / (float)NET_INPUTHEIGHT;
-	float resize_scale=0;
-	int resize_width;
-	int resize_height;
-	int h_pad;
-	int w_pad;
-	if (img_wh_ratio >= input_wh_ratio){
-		//pad height dim
-		resize_scale = (float)NET_INPUTWIDTH / (float)IMG_WIDTH;
-		resize_width = NET_INPUTWIDTH;
-		resize_height = (int)((float)IMG_HEIGHT * resize_scale);
-		w_pad = 0;
-		h_pad = (NET_INPUTHEIGHT - resize_height) / 2;
-	}
-	else{
-		//pad width dim
-		resize_scale = (float)NET_INPUTHEIGHT / (float)IMG_HEIGHT;
-		resize_width = (int)((float)IMG_WIDTH * resize_scale);
-		resize_height = NET_INPUTHEIGHT;
-		w_pad = (NET_INPUTWIDTH - resize_width) / 2;
-		h_pad = 0;
+	if (prepare(true) < 0) {
+		bDetecting = false;
+		return -1;
 	}
 
 	while (1)
@@ -82,40 +272,30 @@ int Yolo::detect_process(){
 		if(input.index == 0){
 			start_time = what_time_is_it_now();
 		} 
-		
+		const letterbox_t &lb = input.lb;
+		bool tiled = input.tile.n_tiles > 0;
 		detect_result_group_t detect_result_group;
-		// detection interval to speed up
-		if (input.index < this->det_interval || !(input.index % this->det_interval)) {
-			double timeBeforeDetection = what_time_is_it_now();
-			cost_time = inference(input.img_pad.data);
-			if(cost_time == -1)
-				printf("NPU inference Error");
-
-			std::vector<float> out_scales;
-			std::vector<int32_t> out_zps;
-			for (int i = 0; i < _n_output; ++i) {
-				out_scales.push_back(_output_attrs[i].scale);
-				out_zps.push_back(_output_attrs[i].zp);
-			}
-
-			// post_process_fp((float *)_output_buff[0], (float *)_output_buff[1], (float *)_output_buff[2],
-		 				// NET_INPUTHEIGHT, NET_INPUTWIDTH, 0, 0, resize_scale, BOX_THRESH, NMS_THRESH, &detect_result_group);
-
-			post_process_i8((int8_t *)_output_buff[0], (int8_t *)_output_buff[1], (int8_t *)_output_buff[2],
-						 NET_INPUTHEIGHT, NET_INPUTWIDTH, 0, 0, resize_scale, BOX_THRESH, NMS_THRESH, out_zps, out_scales, &detect_result_group);
-
-			double timeAfterDetection = what_time_is_it_now();
-
-			cout << "--------Time cost in Detection: " << timeAfterDetection - timeBeforeDetection << "\n";
-			
-		}
+		int t = detect(input, detect_result_group);
+		if (t > 0)
+			cost_time = t;
 		
 		// cout << "post process done\n";
-		detect_result_group.id = input.index;
 		// double end_time = what_time_is_it_now();
 		// cost_time = end_time - start_time;
 		npu_performance = cal_NPU_performance(history_time, sum_time, cost_time / 1.0e3);
 
+		if (tiled) {
+			// 一帧的块到齐后由提交最后一块的线程合并, 按帧序号输出
+			tile_merger.add(input.index, input.img_src, input.tile, detect_result_group, [&](imageout_idx &res) {
+				roi.filter(&res.dets, lb.scale_x, lb.pad_top, lb.pad_left);
+				mtxQueueDetOut.lock();
+				queueDetOut.push(res);
+				mtxQueueDetOut.unlock();
+				idxOutputImage = idxOutputImage + 1;
+			});
+			continue;
+		}
+
 		while(detect_result_group.id != idxOutputImage){
 			usleep(1000);
 		}
@@ -0,0 +1,445 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "common.h"
+#include "detect.h"
+#include "deepsort.h"
+#include "frame_source.h"
+#include "mytime.h"
+#include "multistream.h"
+
+using namespace std;
+
+extern string YOLO_MODEL_PATH;
+extern string SORT_MODEL_PATH;
+extern string ROI_PATH;
+extern bool TILED_INFERENCE;
+extern bool MOTION_GATING;
+extern bool FOLLOW_ROI;
+extern bool DETECT_CASCADE;
+extern int DETECT_INTERVAL;
+
+struct pending_job {
+    input_image job;
+    double queued_ms;   // 进入待检测队列的时间, 凑批时限制最老一帧的等待
+};
+
+struct stream_ctx {
+    int id;
+    string uri;
+    FrameSource *source = NULL;
+    DeepSort *tracker = NULL;
+    bool live = false;
+    deque<pending_job> pending;     // 待检测, mtxStreams 保护
+    atomic<bool> reading{true};
+    atomic<int> read_frames{0};     // 已编号的帧数 (含丢掉的)
+    // 检测结果按帧序号重排, 交给追踪线程
+    mutex mtx_done;
+    condition_variable cv_done;
+    map<int, imageout_idx> done;
+    // 统计
+    atomic<int> tracked{0};
+    atomic<int> dropped{0};
+    double start_ms = 0;
+    double end_ms = 0;
+};
+
+static vector<stream_ctx *> streams;
+static mutex mtxStreams;              // 各路的 pending 与轮转位置
+static condition_variable cvStreams;
+static int lastServed = -1;           // 上次取帧的路, 下次从它的下一路开始找
+static atomic<int> tracksRunning(0);
+static StreamObserver *streamObserver = NULL;
+static BatchWindow *batchWindow = NULL;  // 检测模型 batch > 1 时才有, mtxStreams 保护
+
+BatchWindow::BatchWindow(int max_batch, int n_streams)
+    : max_batch(max_batch), interval_ema(-1), run_ema(-1), last_arrival(-1), stream_last(n_streams, -1e9),
+      batches(0), frames(0), waited_sum(0), fill(max_batch + 1, 0)
+{
+}
+
+void BatchWindow::arrived(int stream, double now_ms)
+{
+    if (last_arrival >= 0) {
+        double dt = now_ms - last_arrival;
+        interval_ema = interval_ema < 0 ? dt : interval_ema + STREAM_BATCH_EMA * (dt - interval_ema);
+    }
+    last_arrival = now_ms;
+    stream_last[stream] = now_ms;
+}
+
+int BatchWindow::target(double now_ms) const
+{
+    int active = 0;
+    for (double t : stream_last)
+        active += now_ms - t < STREAM_BATCH_ACTIVE_MS;
+    return std::max(1, std::min(active, max_batch));
+}
+
+double BatchWindow::window_ms(int target, int have) const
+{
+    if (have >= target)
+        return 0;
+    double wait = STREAM_BATCH_MAX_WAIT_MS;
+    if (run_ema >= 0)
+        wait = std::min(wait, run_ema);
+    if (interval_ema >= 0)
+        wait = std::min(wait, interval_ema * (target - have));
+    return wait;
+}
+
+void BatchWindow::ran(int n, double waited_ms, double run_ms)
+{
+    run_ema = run_ema < 0 ? run_ms : run_ema + STREAM_BATCH_EMA * (run_ms - run_ema);
+    batches++;
+    frames += n;
+    waited_sum += waited_ms;
+    fill[std::min(n, max_batch)]++;
+}
+
+void BatchWindow::print_stats() const
+{
+    if (batches == 0)
+        return;
+    printf("batching: %ld batches of up to %d, %.2f frames/batch, oldest frame waited %.1f ms on average, "
+           "%.1f ms per batch\n", batches, max_batch, mean_fill(), waited_sum / batches, run_ema);
+    printf("  frames/batch:");
+    for (int n = 1; n <= max_batch; n++)
+        printf(" %d:%ld", n, fill[n]);
+    printf("\n");
+}
+
+static void deliver(stream_ctx *s, imageout_idx &res)
+{
+    lock_guard<mutex> lock(s->mtx_done);
+    s->done[res.dets.id] = res;
+    s->cv_done.notify_one();
+}
+
+// 不检测的帧 (检测间隔/被丢掉) 直接交给追踪, 只做预测
+static void deliver_skipped(stream_ctx *s, const input_image &job)
+{
+    imageout_idx res;
+    res.img = job.img_src;
+    res.dets.id = job.index;
+    res.dets.count = 0;
+    res.dets.skipped = true;
+    deliver(s, res);
+}
+
+static void stream_read(stream_ctx *s)
+{
+    letterbox_t lb;
+    memset(&lb, 0, sizeof(lb));
+    tile_t full;
+    nv12_frame img;
+    while (s->source->read(img)) {
+        if (s->start_ms == 0)
+            s->start_ms = what_time_is_it_now();
+        if (lb.src_w != img.width || lb.src_h != img.height) {
+            // 整帧作为一块, 由检测线程直接写进它自己的输入 tensor
+            letterbox_init(lb, img.width, img.height, NET_INPUTWIDTH, NET_INPUTHEIGHT, true);
+            full.region.x = 0;
+            full.region.y = 0;
+            full.region.width = img.width;
+            full.region.height = img.height;
+            full.lb = lb;
+            full.tile = 0;
+            full.n_tiles = 1;
+        }
+        input_image job(s->read_frames, img, lb, full);
+        job.stream = s->id;
+        if (DETECT_INTERVAL > 1 && job.index % DETECT_INTERVAL != 0) {
+            s->read_frames++;
+            deliver_skipped(s, job);
+            continue;
+        }
+        unique_lock<mutex> lock(mtxStreams);
+        if (!s->live) {
+            cvStreams.wait(lock, [s] { return s->pending.size() < STREAM_QUEUE_DEPTH; });
+        }
+        else if (s->pending.size() >= STREAM_QUEUE_DEPTH) {
+            // 实时源检测跟不上: 丢最旧的, 追踪对它只做预测
+            input_image old = s->pending.front().job;
+            s->pending.pop_front();
+            s->dropped++;
+            lock.unlock();
+            deliver_skipped(s, old);
+            lock.lock();
+        }
+        double now = what_time_is_it_now();
+        s->pending.push_back({job, now});
+        if (batchWindow != NULL)
+            batchWindow->arrived(s->id, now);
+        s->read_frames++;
+        cvStreams.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(mtxStreams);
+        s->reading = false;
+        cvStreams.notify_all();
+    }
+    lock_guard<mutex> lock(s->mtx_done);
+    s->cv_done.notify_one();
+}
+
+// 轮转找下一路有待检测帧的, 调用时持有 mtxStreams
+static stream_ctx *pick(input_image &job)
+{
+    int n = streams.size();
+    for (int k = 1; k <= n; k++) {
+        int i = (lastServed + k) % n;
+        if (!streams[i]->pending.empty()) {
+            job = streams[i]->pending.front().job;
+            streams[i]->pending.pop_front();
+            lastServed = i;
+            return streams[i];
+        }
+    }
+    return NULL;
+}
+
+static int pending_total()
+{
+    int n = 0;
+    for (stream_ctx *s : streams)
+        n += s->pending.size();
+    return n;
+}
+
+static bool any_reading()
+{
+    for (stream_ctx *s : streams)
+        if (s->reading)
+            return true;
+    return false;
+}
+
+// 所有待检测帧里最早入队的时间, 调用时持有 mtxStreams 且至少有一帧
+static double oldest_queued()
+{
+    double t = 1e300;
+    for (stream_ctx *s : streams)
+        if (!s->pending.empty())
+            t = std::min(t, s->pending.front().queued_ms);
+    return t;
+}
+
+static bool all_read()
+{
+    for (stream_ctx *s : streams)
+        if (s->reading || !s->pending.empty())
+            return false;
+    return true;
+}
+
+static void stream_detect(Yolo *yolo)
+{
+    while (1) {
+        input_image job;
+        stream_ctx *s = NULL;
+        {
+            unique_lock<mutex> lock(mtxStreams);
+            cvStreams.wait(lock, [&] { return (s = pick(job)) != NULL || all_read(); });
+            if (s == NULL)
+                break;
+            cvStreams.notify_all();  // 文件源的读帧线程可能在等空位
+        }
+        imageout_idx res;
+        res.img = job.img_src;
+        yolo->detect(job, res.dets);
+        res.dets.id = job.index;
+        deliver(s, res);
+    }
+}
+
+// batch > 1: 凑几路的帧一起推理; 轮转取帧, 一批里各路尽量各出一张
+static void stream_detect_batched(Yolo *yolo)
+{
+    int max_batch = yolo->batch();
+    vector<input_image> jobs;
+    vector<stream_ctx *> owners;
+    vector<detect_result_group_t> outs;
+    while (1) {
+        double waited = 0;
+        jobs.clear();
+        owners.clear();
+        {
+            unique_lock<mutex> lock(mtxStreams);
+            cvStreams.wait(lock, [] { return pending_total() > 0 || all_read(); });
+            if (pending_total() == 0)
+                break;
+            // 凑批: 够了目标张数, 或最老一帧等满窗口, 或不会再来帧
+            while (1) {
+                int have = pending_total();
+                if (have == 0)
+                    break;  // 被另一个检测线程取走了
+                double now = what_time_is_it_now();
+                double deadline = oldest_queued() + batchWindow->window_ms(batchWindow->target(now), have);
+                if (now >= deadline || !any_reading())
+                    break;
+                cvStreams.wait_for(lock, chrono::microseconds((long)((deadline - now) * 1000) + 1));
+            }
+            if (pending_total() == 0)
+                continue;
+            waited = what_time_is_it_now() - oldest_queued();
+            input_image job;
+            stream_ctx *s;
+            while ((int)jobs.size() < max_batch && (s = pick(job)) != NULL) {
+                jobs.push_back(job);
+                owners.push_back(s);
+            }
+            cvStreams.notify_all();  // 文件源的读帧线程可能在等空位
+        }
+        double t0 = what_time_is_it_now();
+        if (yolo->detect_batch(jobs, outs) < 0)
+            outs.assign(jobs.size(), detect_result_group_t());
+        double t1 = what_time_is_it_now();
+        // 按路拆开, 各自进该路的重排
+        for (size_t i = 0; i < jobs.size(); i++) {
+            imageout_idx res;
+            res.img = jobs[i].img_src;
+            res.dets = outs[i];
+            res.dets.id = jobs[i].index;
+            deliver(owners[i], res);
+        }
+        lock_guard<mutex> lock(mtxStreams);
+        batchWindow->ran(jobs.size(), waited, t1 - t0);
+    }
+}
+
+static void stream_track(stream_ctx *s)
+{
+    int next = 0;
+    while (1) {
+        imageout_idx frame;
+        {
+            unique_lock<mutex> lock(s->mtx_done);
+            s->cv_done.wait(lock, [&] { return s->done.count(next) || (!s->reading && next >= s->read_frames); });
+            map<int, imageout_idx>::iterator it = s->done.find(next);
+            if (it == s->done.end())
+                break;
+            frame = it->second;
+            s->done.erase(it);
+        }
+        s->tracker->process(frame);
+        if (streamObserver != NULL)
+            streamObserver->on_frame(s->id, frame, s->tracker);
+        s->tracked++;
+        next++;
+    }
+    s->end_ms = what_time_is_it_now();
+    tracksRunning--;
+}
+
+static void report(const vector<int> &last, double interval_ms)
+{
+    int total = 0;
+    printf("streams:");
+    for (size_t i = 0; i < streams.size(); i++) {
+        int n = streams[i]->tracked - last[i];
+        total += n;
+        printf("  [%d] %.1f fps (dropped %d)", (int)i, n * 1000.0 / interval_ms, (int)streams[i]->dropped);
+    }
+    printf("  | total %.1f fps", total * 1000.0 / interval_ms);
+    if (batchWindow != NULL) {
+        lock_guard<mutex> lock(mtxStreams);
+        printf("  | %.2f frames/batch", batchWindow->mean_fill());
+    }
+    printf("\n");
+}
+
+int run_multistream(const vector<string> &uris, StreamObserver *observer)
+{
+    streamObserver = observer;
+    if (TILED_INFERENCE || FOLLOW_ROI || DETECT_CASCADE || MOTION_GATING || !ROI_PATH.empty())
+        printf("multi-stream: tiling / follow / cascade / motion gating / ROI are single-stream only, disabled\n");
+    TILED_INFERENCE = FOLLOW_ROI = DETECT_CASCADE = MOTION_GATING = false;
+
+    rknn_core_mask cores[2] = {RKNN_NPU_CORE_0, RKNN_NPU_CORE_1};
+    vector<Yolo *> detectors;
+    for (int i = 0; i < STREAM_DETECTORS; i++) {
+        Yolo *yolo = new Yolo(YOLO_MODEL_PATH.c_str(), 4 + i % 2, cores[i % 2], 1, 3);
+        if (yolo->prepare(false) < 0)
+            exit(-1);
+        detectors.push_back(yolo);
+    }
+    ReidPool reid(SORT_MODEL_PATH, STREAM_REID_CONTEXTS, 6, RKNN_NPU_CORE_2, cv::Size(128, 256), 512);
+
+    for (size_t i = 0; i < uris.size(); i++) {
+        stream_ctx *s = new stream_ctx();
+        s->id = i;
+        s->uri = uris[i];
+        s->source = open_frame_source(uris[i]);
+        if (s->source == NULL)
+            exit(-1);
+        s->live = s->source->live;
+        s->tracker = new DeepSort(&reid, 512);
+        streams.push_back(s);
+    }
+    int max_batch = detectors[0]->batch();
+    if (max_batch > 1)
+        batchWindow = new BatchWindow(max_batch, streams.size());
+    printf("multi-stream: %d streams, %d detectors (batch %d), %d Re-ID contexts\n", (int)streams.size(),
+           STREAM_DETECTORS, max_batch, STREAM_REID_CONTEXTS);
+
+    double start = what_time_is_it_now();
+    vector<thread> threads;
+    tracksRunning = streams.size();
+    for (stream_ctx *s : streams) {
+        threads.push_back(thread(stream_read, s));
+        threads.push_back(thread(stream_track, s));
+    }
+    for (Yolo *yolo : detectors)
+        threads.push_back(thread(batchWindow != NULL ? stream_detect_batched : stream_detect, yolo));
+
+    vector<int> last(streams.size(), 0);
+    double last_report = start;
+    while (tracksRunning > 0) {
+        usleep(100 * 1000);
+        double now = what_time_is_it_now();
+        if (now - last_report < STREAM_REPORT_MS)
+            continue;
+        report(last, now - last_report);
+        for (size_t i = 0; i < streams.size(); i++)
+            last[i] = streams[i]->tracked;
+        last_report = now;
+    }
+    for (thread &t : threads)
+        t.join();
+
+    double wall = what_time_is_it_now() - start;
+    int total = 0;
+    for (stream_ctx *s : streams) {
+        double span = s->end_ms - s->start_ms;
+        printf("stream %d (%s): %d frames, %.1f fps, dropped %d\n", s->id, s->uri.c_str(), (int)s->tracked,
+               span > 0 ? s->tracked * 1000.0 / span : 0.0, (int)s->dropped);
+        total += s->tracked;
+    }
+    printf("multi-stream total: %d frames in %.1f s, %.1f fps aggregate\n", total, wall / 1000, total * 1000.0 / wall);
+    if (batchWindow != NULL) {
+        batchWindow->print_stats();
+        delete batchWindow;
+        batchWindow = NULL;
+    }
+
+    for (stream_ctx *s : streams) {
+        delete s->tracker;
+        delete s->source;
+        delete s;
+    }
+    streams.clear();
+    for (Yolo *yolo : detectors)
+        delete yolo;
+    streamObserver = NULL;
+    return 0;
+}
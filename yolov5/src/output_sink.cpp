@@ -0,0 +1,321 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "output_sink.h"
+#include "mytime.h"
+
+using namespace std;
+
+extern string IMAGE_BACKEND;
+
+bool AsyncSink::push(const imageout_idx &frame)
+{
+    lock_guard<mutex> lock(mtx);
+    if (closing)
+        return false;
+    if (queue.size() >= depth) {
+        dropped++;
+        if (!drop_oldest)
+            return false;
+        queue.pop_front();
+    }
+    queue.push_back(frame);
+    accepted++;
+    cv.notify_one();
+    return true;
+}
+
+void AsyncSink::start()
+{
+    worker = thread(&AsyncSink::run, this);
+}
+
+void AsyncSink::close()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        closing = true;
+        cv.notify_one();
+    }
+    if (worker.joinable())
+        worker.join();
+}
+
+void AsyncSink::run()
+{
+    double next = 0;
+    while (1) {
+        imageout_idx frame;
+        if (interval_ms > 0) {
+            double now = what_time_is_it_now();
+            if (now < next)
+                usleep((useconds_t)((next - now) * 1000));
+        }
+        {
+            unique_lock<mutex> lock(mtx);
+            cv.wait(lock, [this] { return !queue.empty() || closing; });
+            if (queue.empty())
+                break;
+            frame = queue.front();
+            queue.pop_front();
+        }
+        next = what_time_is_it_now() + interval_ms;
+        if (consume(frame))
+            rendered++;
+    }
+    finish();
+}
+
+EncoderSink::EncoderSink(const string &path, int fps, double fourcc)
+    : AsyncSink(OUTPUT_ENCODE_DEPTH, false), path(path), fps(fps > 0 ? fps : 25), fourcc(fourcc), failed(false),
+      unwritten(0)
+{
+    start();
+}
+
+bool EncoderSink::consume(imageout_idx &frame)
+{
+    // 打不开就不再试, 之后的帧都算丢掉
+    if (failed) {
+        unwritten++;
+        return false;
+    }
+    cv::Mat img;
+    frame.img.to_bgr(img);
+    if (!writer.isOpened()) {
+        int cc = fourcc > 0 ? (int)fourcc : cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+        if (!writer.open(path, cc, fps, img.size())) {
+            printf("open video writer %s fail, nothing will be saved\n", path.c_str());
+            failed = true;
+            unwritten++;
+            return false;
+        }
+        printf("writing %dx%d @ %d fps to %s\n", img.cols, img.rows, fps, path.c_str());
+    }
+    overlay.draw(img, frame.dets, 1.f);
+    writer.write(img);
+    return true;
+}
+
+void EncoderSink::finish()
+{
+    writer.release();
+    // 队列已排空, push 不会再改 dropped
+    dropped += unwritten;
+    if (dropped > 0)
+        printf("file %s: %ld frames dropped (%ld encoder queue full, %ld writer failed)\n", path.c_str(), dropped,
+               dropped - unwritten, unwritten);
+}
+
+PreviewSink::PreviewSink() : AsyncSink(1, true)
+{
+    interval_ms = 1000.0 / PREVIEW_FPS;
+    pre = create_image_processor(IMAGE_BACKEND.c_str());
+    start();
+}
+
+PreviewSink::~PreviewSink()
+{
+    close();
+    delete pre;
+}
+
+// 原图转色并缩小到宽度不超过 max_width 的 BGR (一步完成), 再画框和标签
+static void render_scaled(ImageProcessor *pre, OverlayRenderer &overlay, const imageout_idx &frame, int max_width,
+                          cv::Mat &canvas)
+{
+    const nv12_frame &src = frame.img;
+    float scale = 1.f;
+    if (max_width > 0 && src.width > max_width)
+        scale = (float)max_width / src.width;
+    int w = (int)(src.width * scale) & ~1;
+    int h = (int)(src.height * scale) & ~1;
+    if (canvas.cols != w || canvas.rows != h)
+        canvas.create(h, w, CV_8UC3);
+    image_view dst = make_image_view(canvas.data, w, h, IMAGE_BGR888);
+    image_rect src_rect = {0, 0, src.width, src.height};
+    image_rect dst_rect = {0, 0, w, h};
+    if (pre->process(src.view(), src_rect, dst, dst_rect) < 0) {
+        cv::Mat bgr;
+        src.to_bgr(bgr);
+        cv::resize(bgr, canvas, canvas.size());
+    }
+    overlay.draw(canvas, frame.dets, (float)w / src.width);
+}
+
+bool PreviewSink::consume(imageout_idx &frame)
+{
+    render_scaled(pre, overlay, frame, PREVIEW_MAX_WIDTH, canvas);
+    cv::imshow(PREVIEW_WINDOW, canvas);
+    cv::waitKey(1);
+    return true;
+}
+
+void PreviewSink::finish()
+{
+    cv::destroyWindow(PREVIEW_WINDOW);
+}
+
+MjpegSink::MjpegSink(int port) : AsyncSink(1, true)
+{
+    interval_ms = 1000.0 / MJPEG_FPS;
+    pre = create_image_processor(IMAGE_BACKEND.c_str());
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(MJPEG_QUALITY);
+    // 端口占用等打不开时整个输出端不工作, 帧都算丢掉
+    enabled = server.start(MJPEG_BIND, port);
+    if (!enabled) {
+        printf("mjpeg: cannot serve on %s:%d, web preview disabled\n", MJPEG_BIND, port);
+        return;
+    }
+    start();
+}
+
+bool MjpegSink::push(const imageout_idx &frame)
+{
+    if (!enabled) {
+        dropped++;
+        return false;
+    }
+    return AsyncSink::push(frame);
+}
+
+MjpegSink::~MjpegSink()
+{
+    close();
+    printf("mjpeg: %ld frames sent to clients, %ld skipped for slow clients\n", (long)server.frames_sent,
+           (long)server.frames_skipped);
+    server.stop();
+    delete pre;
+}
+
+bool MjpegSink::consume(imageout_idx &frame)
+{
+    if (!server.has_clients())
+        return false;
+    render_scaled(pre, overlay, frame, PREVIEW_MAX_WIDTH, canvas);
+    std::shared_ptr<std::vector<uint8_t> > jpeg = std::make_shared<std::vector<uint8_t> >();
+    if (!cv::imencode(".jpg", canvas, *jpeg, params))
+        return false;
+    server.publish(jpeg);
+    return true;
+}
+
+// 有轨迹号的框转成日志/共享内存的记录
+static void to_track_records(const detect_result_group_t &dets, vector<track_record> &records)
+{
+    records.clear();
+    for (const DetectBox &b : dets.results) {
+        if (b.trackID < 0)
+            continue;
+        track_record r;
+        r.track_id = (int32_t)b.trackID;
+        r.class_id = (int16_t)b.classID;
+        r.confidence = (uint16_t)(std::min(std::max(b.confidence, 0.f), 1.f) * 65535);
+        r.x1 = b.x1;
+        r.y1 = b.y1;
+        r.x2 = b.x2;
+        r.y2 = b.y2;
+        records.push_back(r);
+    }
+}
+
+TrackLogSink::TrackLogSink(const string &path)
+{
+    ok = writer.open(path.c_str());
+    if (ok)
+        printf("writing tracks to %s\n", path.c_str());
+}
+
+bool TrackLogSink::push(const imageout_idx &frame)
+{
+    if (!ok) {
+        dropped++;
+        return false;
+    }
+    to_track_records(frame.dets, records);
+    if (!writer.write(frame.dets.id, frame.img.pts_ms, records.empty() ? NULL : &records[0], records.size())) {
+        printf("write track log fail, frame %d\n", frame.dets.id);
+        ok = false;
+        dropped++;
+        return false;
+    }
+    accepted++;
+    rendered++;
+    return true;
+}
+
+void TrackLogSink::close()
+{
+    if (writer.frame_count() > 0)
+        printf("track log: %lu frames, %lu records\n", (unsigned long)writer.frame_count(),
+               (unsigned long)writer.record_count());
+    writer.close();
+}
+
+TrackRingSink::TrackRingSink(const string &name)
+{
+    ok = writer.open(name.c_str());
+}
+
+bool TrackRingSink::push(const imageout_idx &frame)
+{
+    if (!ok) {
+        dropped++;
+        return false;
+    }
+    to_track_records(frame.dets, records);
+    writer.write(frame.dets.id, frame.img.pts_ms, records.empty() ? NULL : &records[0], records.size());
+    accepted++;
+    rendered++;
+    return true;
+}
+
+void TrackRingSink::close()
+{
+    if (writer.frame_count() > 0)
+        printf("track ring: %lu frames published\n", (unsigned long)writer.frame_count());
+    writer.close();
+}
+
+vector<OutputSink *> open_output_sinks(const string &spec, const string &default_path, int fps, double fourcc)
+{
+    vector<OutputSink *> sinks;
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == string::npos)
+            end = spec.size();
+        string item = spec.substr(start, end - start);
+        start = end + 1;
+        if (item.empty())
+            continue;
+        if (item == "null")
+            sinks.push_back(new NullSink());
+        else if (item == "preview")
+            sinks.push_back(new PreviewSink());
+        else if (item == "file")
+            sinks.push_back(new EncoderSink(default_path, fps, fourcc));
+        else if (item.compare(0, 5, "file:") == 0)
+            sinks.push_back(new EncoderSink(item.substr(5), fps, fourcc));
+        else if (item == "tracks")
+            sinks.push_back(new TrackLogSink(default_path + ".tracks"));
+        else if (item.compare(0, 7, "tracks:") == 0)
+            sinks.push_back(new TrackLogSink(item.substr(7)));
+        else if (item == "mjpeg")
+            sinks.push_back(new MjpegSink(MJPEG_PORT));
+        else if (item.compare(0, 6, "mjpeg:") == 0)
+            sinks.push_back(new MjpegSink(atoi(item.substr(6).c_str())));
+        else if (item == "shm")
+            sinks.push_back(new TrackRingSink(TRACKRING_NAME));
+        else if (item.compare(0, 4, "shm:") == 0)
+            sinks.push_back(new TrackRingSink(item.substr(4)));
+        else
+            printf("unknown output sink '%s' (null / preview / file[:<path>] / tracks[:<path>] / mjpeg[:<port>] / "
+                   "shm[:<name>])\n",
+                   item.c_str());
+    }
+    return sinks;
+}
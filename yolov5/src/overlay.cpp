@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "overlay.h"
+
+static const cv::Scalar BOX_COLOR(139, 0, 0, 255);
+static const cv::Scalar TEXT_COLOR(0, 255, 0, 255);
+
+// 文字画在与框同色的底上, 拷贝时不用做透明混合
+static cv::Mat render_glyph(const std::string &text, double size, int h, int baseline)
+{
+    int b = 0;
+    cv::Size sz = cv::getTextSize(text, OVERLAY_FONT, size, 1, &b);
+    cv::Mat g(h, sz.width, CV_8UC3, BOX_COLOR);
+    cv::putText(g, text, cv::Point(0, h - baseline), OVERLAY_FONT, size, TEXT_COLOR);
+    return g;
+}
+
+void OverlayRenderer::build_glyphs(double size)
+{
+    font_size = size;
+    int b = 0;
+    cv::Size sz = cv::getTextSize("ID:0123456789-", OVERLAY_FONT, size, 1, &b);
+    baseline = b;
+    glyph_h = sz.height + b;
+    prefix = render_glyph("ID:", size, glyph_h, baseline);
+    for (int i = 0; i < 10; i++)
+        digits[i] = render_glyph(std::string(1, (char)('0' + i)), size, glyph_h, baseline);
+    digits[10] = render_glyph("-", size, glyph_h, baseline);
+}
+
+void OverlayRenderer::blit(cv::Mat &img, const cv::Mat &glyph, int x, int y)
+{
+    cv::Rect dst(x, y, glyph.cols, glyph.rows);
+    cv::Rect clip = dst & cv::Rect(0, 0, img.cols, img.rows);
+    if (clip.empty())
+        return;
+    cv::Rect src(clip.x - x, clip.y - y, clip.width, clip.height);
+    cv::Mat roi = img(clip);
+    glyph(src).copyTo(roi);
+}
+
+void OverlayRenderer::draw_label(cv::Mat &img, int x, int y, int id)
+{
+    int top = y - glyph_h;
+    blit(img, prefix, x, top);
+    x += prefix.cols;
+    if (id < 0) {
+        blit(img, digits[10], x, top);
+        x += digits[10].cols;
+        id = -id;
+    }
+    // 从高位到低位, 不经过字符串
+    int div = 1;
+    while (id / div >= 10)
+        div *= 10;
+    for (; div > 0; div /= 10) {
+        const cv::Mat &g = digits[id / div % 10];
+        blit(img, g, x, top);
+        x += g.cols;
+    }
+}
+
+void OverlayRenderer::draw(cv::Mat &img, const detect_result_group_t &dets, float scale)
+{
+    double size = std::max(1.0, OVERLAY_FONT_SIZE * scale);
+    if (size != font_size)
+        build_glyphs(size);
+    int line = std::max(1, (int)(OVERLAY_LINE * scale + 0.5f));
+    for (const DetectBox &b : dets.results) {
+        cv::Point p1((int)(b.x1 * scale), (int)(b.y1 * scale));
+        cv::Point p2((int)(b.x2 * scale), (int)(b.y2 * scale));
+        cv::rectangle(img, p1, p2, BOX_COLOR, line);
+        draw_label(img, p1.x, p1.y, (int)b.trackID);
+    }
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "roi_mask.h"
+
+// 射线法判断点是否在多边形内
+static bool point_in_polygon(const std::vector<float> &poly, float x, float y)
+{
+    bool inside = false;
+    int n = poly.size() / 2;
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        float xi = poly[i * 2], yi = poly[i * 2 + 1];
+        float xj = poly[j * 2], yj = poly[j * 2 + 1];
+        if (((yi > y) != (yj > y)) && (x < (xj - xi) * (y - yi) / (yj - yi) + xi))
+            inside = !inside;
+    }
+    return inside;
+}
+
+int RoiMask::load(const char *path)
+{
+    polygons.clear();
+    enabled = false;
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return -1;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#') continue;
+        std::vector<float> poly;
+        char *p = line;
+        float x, y;
+        int n;
+        while (sscanf(p, " %f , %f%n", &x, &y, &n) == 2) {
+            poly.push_back(x);
+            poly.push_back(y);
+            p += n;
+        }
+        if (poly.size() >= 6)
+            polygons.push_back(poly);
+    }
+    fclose(fp);
+    enabled = !polygons.empty();
+    printf("ROI: %d polygons loaded from %s\n", (int)polygons.size(), path);
+    return enabled ? 0 : -1;
+}
+
+void RoiMask::rasterize(const model_meta &meta, float scale_x, float scale_y, float pad_x, float pad_y)
+{
+    if (!enabled) return;
+    n_head = meta.n_head;
+
+    // 网络坐标下的粗位图
+    grid_w = (meta.model_in_w + ROI_MASK_STEP - 1) / ROI_MASK_STEP;
+    grid_h = (meta.model_in_h + ROI_MASK_STEP - 1) / ROI_MASK_STEP;
+    net_mask.assign(grid_w * grid_h, 0);
+    for (int i = 0; i < grid_h; i++) {
+        for (int j = 0; j < grid_w; j++) {
+            float fx = ((j + 0.5f) * ROI_MASK_STEP - pad_x) / scale_x;
+            float fy = ((i + 0.5f) * ROI_MASK_STEP - pad_y) / scale_y;
+            for (const std::vector<float> &poly : polygons) {
+                if (point_in_polygon(poly, fx, fy)) {
+                    net_mask[i * grid_w + j] = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 检测头格子: 与区域有交集的格子, 再向外扩一格 (框中心可以偏出所在格子)
+    for (int h = 0; h < n_head; h++) {
+        int gh = meta.grid_h[h], gw = meta.grid_w[h], stride = meta.strides[h];
+        std::vector<uint8_t> hit(gh * gw, 0);
+        for (int i = 0; i < grid_h; i++) {
+            for (int j = 0; j < grid_w; j++) {
+                if (!net_mask[i * grid_w + j]) continue;
+                int ci = i * ROI_MASK_STEP / stride, cj = j * ROI_MASK_STEP / stride;
+                if (ci < gh && cj < gw) hit[ci * gw + cj] = 1;
+            }
+        }
+        head_masks[h].assign(gh * gw, 0);
+        int enabled_cells = 0;
+        for (int i = 0; i < gh; i++) {
+            for (int j = 0; j < gw; j++) {
+                uint8_t v = 0;
+                for (int di = -1; di <= 1 && !v; di++)
+                    for (int dj = -1; dj <= 1 && !v; dj++) {
+                        int y = i + di, x = j + dj;
+                        if (y >= 0 && y < gh && x >= 0 && x < gw) v = hit[y * gw + x];
+                    }
+                head_masks[h][i * gw + j] = v;
+                enabled_cells += v;
+            }
+        }
+        printf("ROI: head %d scans %d/%d cells\n", h, enabled_cells, gh * gw);
+    }
+}
+
+void RoiMask::apply(Decoder *decoder)
+{
+    for (int h = 0; h < DECODER_MAX_HEAD; h++)
+        decoder->set_cell_mask(h, (enabled && h < n_head) ? head_masks[h].data() : NULL);
+}
+
+bool RoiMask::contains_net(float x, float y) const
+{
+    if (!enabled) return true;
+    int j = (int)(x / ROI_MASK_STEP), i = (int)(y / ROI_MASK_STEP);
+    j = j < 0 ? 0 : (j >= grid_w ? grid_w - 1 : j);
+    i = i < 0 ? 0 : (i >= grid_h ? grid_h - 1 : i);
+    return net_mask[i * grid_w + j] != 0;
+}
+
+int RoiMask::filter(detect_result_group_t *group, float resize_scale, int h_offset, int w_offset) const
+{
+    if (!enabled) return 0;
+    int dropped = 0;
+    std::vector<DetectBox> kept;
+    for (DetectBox &det : group->results) {
+        float cx = (det.x1 + det.x2) * 0.5f * resize_scale + w_offset;
+        float cy = (det.y1 + det.y2) * 0.5f * resize_scale + h_offset;
+        if (contains_net(cx, cy)) kept.push_back(det);
+        else dropped++;
+    }
+    group->results.swap(kept);
+    group->count = group->results.size();
+    return dropped;
+}
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "deepsort.h"
+#include "frame_source.h"
+#include "multistream.h"
+#include "mytime.h"
+#include "segmented.h"
+#include "track_log.h"
+
+using namespace std;
+
+extern string VIDEO_SAVEPATH;
+
+struct segment_frame {
+    bool valid = false;
+    double pts_ms = 0;
+    vector<track_record> records;   // 段内的轨迹号
+};
+
+struct segment_info {
+    int start;      // 读的第一帧 (原视频帧号), 含前面的重叠
+    int own;        // 结果从这一帧起算这一段的
+    int end;        // 不含
+    vector<segment_frame> frames;   // 下标为段内帧号
+    // 轨迹在重叠里最后一次取到的特征: head 为本段热身时, tail 为下一段热身时
+    map<int, Eigen::RowVectorXf> head_feat;
+    map<int, Eigen::RowVectorXf> tail_feat;
+};
+
+// 各段的结果由各自的追踪线程写进自己的 segment_info, 互不相干, 不用加锁
+class SegmentCollector : public StreamObserver {
+public:
+    SegmentCollector(vector<segment_info> &segs) : segs(segs) {}
+
+    void on_frame(int stream, const imageout_idx &frame, DeepSort *tracker)
+    {
+        segment_info &g = segs[stream];
+        int local = frame.dets.id;
+        if (local < 0 || local >= (int)g.frames.size())
+            return;
+        segment_frame &f = g.frames[local];
+        f.valid = true;
+        f.pts_ms = frame.img.pts_ms;
+        f.records.clear();
+        for (const DetectBox &b : frame.dets.results) {
+            if (b.trackID < 0)
+                continue;
+            track_record r;
+            r.track_id = (int32_t)b.trackID;
+            r.class_id = (int16_t)b.classID;
+            r.confidence = (uint16_t)(min(max(b.confidence, 0.f), 1.f) * 65535);
+            r.x1 = b.x1;
+            r.y1 = b.y1;
+            r.x2 = b.x2;
+            r.y2 = b.y2;
+            f.records.push_back(r);
+        }
+
+        int global = g.start + local;
+        map<int, Eigen::RowVectorXf> *feats = NULL;
+        if (global < g.own)
+            feats = &g.head_feat;
+        else if (stream + 1 < (int)segs.size() && global >= segs[stream + 1].start)
+            feats = &g.tail_feat;
+        if (feats == NULL)
+            return;
+        FEATURE feature;
+        for (const track_record &r : f.records)
+            if (tracker->track_feature(r.track_id, feature))
+                (*feats)[r.track_id] = feature;
+    }
+
+private:
+    vector<segment_info> &segs;
+};
+
+static float box_iou(const track_record &a, const track_record &b)
+{
+    float w = min(a.x2, b.x2) - max(a.x1, b.x1);
+    float h = min(a.y2, b.y2) - max(a.y1, b.y1);
+    if (w <= 0 || h <= 0)
+        return 0;
+    float inter = w * h;
+    float uni = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1) - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+struct stitch_pair {
+    int prev_id;
+    int next_id;
+    float score;
+};
+
+/*
+    前一段 a 与后一段 b 在重叠帧 [b.start, a.end) 上配对轨迹, 返回 b 的轨迹号 -> a 的轨迹号
+    同类、同时出现至少 STITCH_MIN_FRAMES 帧、平均 IoU 和外观相似度都过门限的才是候选, 按综合分从高到低贪心
+*/
+static map<int, int> stitch(const segment_info &a, const segment_info &b)
+{
+    map<pair<int, int>, pair<double, int> > overlap;   // (a 号, b 号) -> (IoU 和, 同时出现的帧数)
+    for (int g = b.start; g < a.end; g++) {
+        const segment_frame &fa = a.frames[g - a.start];
+        const segment_frame &fb = b.frames[g - b.start];
+        if (!fa.valid || !fb.valid)
+            continue;
+        for (const track_record &ra : fa.records)
+            for (const track_record &rb : fb.records) {
+                if (ra.class_id != rb.class_id)
+                    continue;
+                pair<double, int> &o = overlap[make_pair(ra.track_id, rb.track_id)];
+                o.first += box_iou(ra, rb);
+                o.second++;
+            }
+    }
+
+    vector<stitch_pair> candidates;
+    for (const auto &it : overlap) {
+        if (it.second.second < STITCH_MIN_FRAMES)
+            continue;
+        float iou = it.second.first / it.second.second;
+        if (iou < STITCH_IOU_MIN)
+            continue;
+        float score = iou;
+        auto fa = a.tail_feat.find(it.first.first);
+        auto fb = b.head_feat.find(it.first.second);
+        if (fa != a.tail_feat.end() && fb != b.head_feat.end()) {
+            // 特征已归一化
+            float cos = fa->second.dot(fb->second);
+            if (cos < STITCH_COS_MIN)
+                continue;
+            score = STITCH_IOU_WEIGHT * iou + (1 - STITCH_IOU_WEIGHT) * cos;
+        }
+        candidates.push_back({it.first.first, it.first.second, score});
+    }
+    sort(candidates.begin(), candidates.end(),
+         [](const stitch_pair &x, const stitch_pair &y) { return x.score > y.score; });
+
+    map<int, int> links;
+    map<int, bool> prev_used;
+    for (const stitch_pair &c : candidates) {
+        if (links.count(c.next_id) || prev_used.count(c.prev_id))
+            continue;
+        links[c.next_id] = c.prev_id;
+        prev_used[c.prev_id] = true;
+    }
+    return links;
+}
+
+int run_segmented(const string &uri, int segments)
+{
+    FrameSource *probe = open_frame_source(uri);
+    if (probe == NULL)
+        return -1;
+    int total = probe->frame_count;
+    int fps = probe->fps > 0 ? probe->fps : 25;
+    delete probe;
+    if (total <= 0) {
+        printf("segmented: %s has no frame count (live source?), cannot split\n", uri.c_str());
+        return -1;
+    }
+
+    int len = (total + segments - 1) / segments;
+    int overlap = (int)(SEGMENT_OVERLAP_S * fps + 0.5);
+    vector<segment_info> segs;
+    vector<string> uris;
+    for (int own = 0; own < total; own += len) {
+        segment_info g;
+        g.own = own;
+        g.start = max(0, own - overlap);
+        g.end = min(own + len, total);
+        g.frames.resize(g.end - g.start);
+        segs.push_back(g);
+        char query[64];
+        snprintf(query, sizeof(query), "%cstart=%d&frames=%d", uri.find('?') == string::npos ? '?' : '&', g.start,
+                 g.end - g.start);
+        uris.push_back(uri + query);
+    }
+    printf("segmented: %d frames in %d segments of %d, %d frames overlap\n", total, (int)segs.size(), len, overlap);
+
+    SegmentCollector collector(segs);
+    double start = what_time_is_it_now();
+    run_multistream(uris, &collector);
+    double wall = what_time_is_it_now() - start;
+
+    // 段 k 的轨迹号 -> 段 k-1 的轨迹号
+    vector<map<int, int> > links(segs.size());
+    int stitched = 0;
+    for (size_t k = 1; k < segs.size(); k++) {
+        links[k] = stitch(segs[k - 1], segs[k]);
+        stitched += links[k].size();
+        printf("segment %d -> %d: %d tracks stitched\n", (int)k - 1, (int)k, (int)links[k].size());
+    }
+
+    // 按帧顺序写, 轨迹第一次出现时定全局编号; 配上的沿用前一段的编号 (前一段在重叠里出现过, 已经定了)
+    string path = VIDEO_SAVEPATH + ".tracks";
+    TrackLogWriter writer;
+    if (!writer.open(path.c_str())) {
+        printf("segmented: cannot write %s\n", path.c_str());
+        return -1;
+    }
+    vector<map<int, int> > global_ids(segs.size());
+    int next_id = 1;
+    long missing = 0;
+    vector<track_record> records;
+    for (size_t k = 0; k < segs.size(); k++) {
+        segment_info &g = segs[k];
+        for (int f = g.own; f < g.end; f++) {
+            const segment_frame &sf = g.frames[f - g.start];
+            if (!sf.valid) {
+                missing++;
+                continue;
+            }
+            records = sf.records;
+            for (track_record &r : records) {
+                map<int, int>::iterator it = global_ids[k].find(r.track_id);
+                if (it == global_ids[k].end()) {
+                    int id = -1;
+                    map<int, int>::iterator link = links[k].find(r.track_id);
+                    if (link != links[k].end() && global_ids[k - 1].count(link->second))
+                        id = global_ids[k - 1][link->second];
+                    if (id < 0)
+                        id = next_id++;
+                    it = global_ids[k].insert(make_pair(r.track_id, id)).first;
+                }
+                r.track_id = it->second;
+            }
+            if (!writer.write(f, sf.pts_ms, records.empty() ? NULL : &records[0], records.size())) {
+                printf("segmented: write %s fail at frame %d\n", path.c_str(), f);
+                return -1;
+            }
+        }
+    }
+    printf("segmented: %lu frames, %lu records, %d global tracks (%d stitched) -> %s\n",
+           (unsigned long)writer.frame_count(), (unsigned long)writer.record_count(), next_id - 1, stitched,
+           path.c_str());
+    writer.close();
+    if (missing > 0)
+        printf("segmented: %ld frames not tracked (source ended early?)\n", missing);
+    int processed = 0;
+    for (const segment_info &g : segs)
+        processed += g.end - g.start;
+    printf("segmented: %.1f s, %.1f fps (%.1f fps incl. overlap)\n", wall / 1000, total * 1000.0 / wall,
+           processed * 1000.0 / wall);
+    return 0;
+}
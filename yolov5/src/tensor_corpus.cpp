@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "tensor_corpus.h"
+
+static void attr_to_desc(const rknn_tensor_attr &attr, uint32_t size, corpus_tensor_desc &desc)
+{
+    memset(&desc, 0, sizeof(desc));
+    desc.n_dims = attr.n_dims;
+    for (int i = 0; i < 4 && i < (int)attr.n_dims; i++)
+        desc.dims[i] = attr.dims[i];
+    desc.fmt = attr.fmt;
+    desc.type = attr.type;
+    desc.zp = attr.zp;
+    desc.scale = attr.scale;
+    desc.size = size;
+}
+
+static void desc_to_attr(const corpus_tensor_desc &desc, int index, rknn_tensor_attr &attr)
+{
+    memset(&attr, 0, sizeof(attr));
+    attr.index = index;
+    attr.n_dims = desc.n_dims;
+    for (int i = 0; i < 4; i++)
+        attr.dims[i] = desc.dims[i];
+    attr.fmt = (rknn_tensor_format)desc.fmt;
+    attr.type = (rknn_tensor_type)desc.type;
+    attr.qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    attr.zp = desc.zp;
+    attr.scale = desc.scale;
+    attr.size = desc.size;
+    attr.n_elems = desc.type == RKNN_TENSOR_FLOAT32 ? desc.size / sizeof(float) : desc.size;
+}
+
+/*---------------------------------------------------------
+    CorpusWriter
+----------------------------------------------------------*/
+CorpusWriter::CorpusWriter(const char *path, rknn_tensor_attr *input_attr, rknn_tensor_attr *output_attrs, int n_output)
+{
+    fp = fopen(path, "wb");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return;
+    }
+    corpus_tensor_desc desc;
+    fwrite(CORPUS_MAGIC, 1, 4, fp);
+    int32_t n = n_output;
+    fwrite(&n, sizeof(n), 1, fp);
+    attr_to_desc(*input_attr, input_attr->size, desc);
+    fwrite(&desc, sizeof(desc), 1, fp);
+    for (int i = 0; i < n_output; i++) {
+        // 输出按 _output_attrs[i].type 存放, int8 每个元素 1 字节
+        uint32_t elem_size = output_attrs[i].type == RKNN_TENSOR_FLOAT32 ? sizeof(float) : 1;
+        uint32_t size = output_attrs[i].n_elems * elem_size;
+        attr_to_desc(output_attrs[i], size, desc);
+        fwrite(&desc, sizeof(desc), 1, fp);
+        sizes.push_back(size);
+    }
+    fflush(fp);
+    printf("Record detection outputs to %s\n", path);
+}
+
+CorpusWriter::~CorpusWriter()
+{
+    if (fp) fclose(fp);
+}
+
+int CorpusWriter::write(int frame_id, void **outputs)
+{
+    if (fp == NULL) return -1;
+    std::lock_guard<std::mutex> lock(mtx);
+    int32_t id = frame_id;
+    fwrite(&id, sizeof(id), 1, fp);
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (fwrite(outputs[i], 1, sizes[i], fp) != sizes[i]) {
+            printf("CorpusWriter: write frame %d fail!\n", frame_id);
+            return -1;
+        }
+    }
+    fflush(fp);
+    return 0;
+}
+
+/*---------------------------------------------------------
+    CorpusReader
+----------------------------------------------------------*/
+CorpusReader::~CorpusReader()
+{
+    if (fp) fclose(fp);
+}
+
+int CorpusReader::open(const char *path)
+{
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        printf("fopen %s fail!\n", path);
+        return -1;
+    }
+    char magic[4];
+    int32_t n = 0;
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, CORPUS_MAGIC, 4) != 0
+        || fread(&n, sizeof(n), 1, fp) != 1 || n <= 0) {
+        printf("%s is not a tensor corpus\n", path);
+        return -1;
+    }
+    n_output = n;
+    corpus_tensor_desc desc;
+    if (fread(&desc, sizeof(desc), 1, fp) != 1) return -1;
+    desc_to_attr(desc, 0, input_attr);
+    output_attrs.resize(n_output);
+    for (int i = 0; i < n_output; i++) {
+        if (fread(&desc, sizeof(desc), 1, fp) != 1) return -1;
+        desc_to_attr(desc, i, output_attrs[i]);
+    }
+    return 0;
+}
+
+int CorpusReader::read(int &frame_id, std::vector<std::vector<int8_t> > &outputs)
+{
+    int32_t id;
+    if (fp == NULL) return -1;
+    if (fread(&id, sizeof(id), 1, fp) != 1) return 0;
+    frame_id = id;
+    outputs.resize(n_output);
+    for (int i = 0; i < n_output; i++) {
+        outputs[i].resize(output_attrs[i].size);
+        if (fread(outputs[i].data(), 1, output_attrs[i].size, fp) != output_attrs[i].size) {
+            printf("CorpusReader: truncated frame %d\n", frame_id);
+            return -1;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include "tiler.h"
+
+// 一个方向上的分块起点, 块长 min(len, tile)
+static void axis_layout(int len, int tile, int overlap, std::vector<int> &starts)
+{
+    starts.clear();
+    if (len <= tile) {
+        starts.push_back(0);
+        return;
+    }
+    // n 块覆盖 len 且重叠 >= overlap: n >= (len - overlap) / (tile - overlap)
+    int step = std::max(tile - overlap, 1);
+    int n = std::max((len - overlap + step - 1) / step, 2);
+    for (int i = 0; i < n; i++) {
+        // NV12 的色度按 2x2 采样, 起点取偶数
+        int start = (int)((long)(len - tile) * i / (n - 1)) & ~1;
+        starts.push_back(start);
+    }
+}
+
+void tile_layout(int frame_w, int frame_h, int net_w, int net_h, int overlap, bool full_frame,
+                 std::vector<tile_t> &tiles)
+{
+    tiles.clear();
+    std::vector<int> xs, ys;
+    axis_layout(frame_w, net_w, overlap, xs);
+    axis_layout(frame_h, net_h, overlap, ys);
+    for (int y : ys) {
+        for (int x : xs) {
+            tile_t t;
+            t.region.x = x;
+            t.region.y = y;
+            t.region.width = std::min(frame_w, net_w);
+            t.region.height = std::min(frame_h, net_h);
+            tiles.push_back(t);
+        }
+    }
+    if (full_frame && tiles.size() > 1) {
+        tile_t t;
+        t.region.x = 0;
+        t.region.y = 0;
+        t.region.width = frame_w;
+        t.region.height = frame_h;
+        tiles.push_back(t);
+    }
+    for (size_t i = 0; i < tiles.size(); i++) {
+        tile_t &t = tiles[i];
+        letterbox_init(t.lb, t.region.width, t.region.height, net_w, net_h, true);
+        t.tile = i;
+        t.n_tiles = tiles.size();
+    }
+    printf("tile layout %dx%d: %d x %d tiles%s\n", frame_w, frame_h, (int)xs.size(), (int)ys.size(),
+           tiles.size() > xs.size() * ys.size() ? " + full frame" : "");
+}
+
+image_rect follow_region(int frame_w, int frame_h, float cx, float cy, float w, float h, int min_side)
+{
+    int side = (int)(std::max(w, h) * FOLLOW_ROI_MARGIN);
+    side = std::max(side, min_side);
+    int side_w = std::min(side, frame_w) & ~1;
+    int side_h = std::min(side, frame_h) & ~1;
+    int x = std::min(std::max((int)(cx - side_w / 2), 0), frame_w - side_w) & ~1;
+    int y = std::min(std::max((int)(cy - side_h / 2), 0), frame_h - side_h) & ~1;
+    image_rect r = {x, y, side_w, side_h};
+    return r;
+}
+
+static float box_area(const DetectBox &b)
+{
+    return std::max(0.f, b.x2 - b.x1) * std::max(0.f, b.y2 - b.y1);
+}
+
+static float box_inter(const DetectBox &a, const DetectBox &b)
+{
+    float w = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
+    float h = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
+    return (w <= 0 || h <= 0) ? 0.f : w * h;
+}
+
+void TileMerger::add(int frame, const nv12_frame &img, const tile_t &tile, const detect_result_group_t &dets,
+                     const emit_fn &emit)
+{
+    const image_rect &r = tile.region;
+    // 块的内侧边界 (不是原图边界) 上的框可能只是目标的一部分
+    bool inner_l = r.x > 0, inner_t = r.y > 0;
+    bool inner_r = r.x + r.width < img.width, inner_b = r.y + r.height < img.height;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    pending_frame &p = pending[frame];
+    p.img = img;
+    p.skipped = p.skipped || dets.skipped;
+    for (const DetectBox &d : dets.results) {
+        DetectBox b = d;
+        b.x1 = std::min(std::max(d.x1, 0.f), (float)r.width) + r.x;
+        b.y1 = std::min(std::max(d.y1, 0.f), (float)r.height) + r.y;
+        b.x2 = std::min(std::max(d.x2, 0.f), (float)r.width) + r.x;
+        b.y2 = std::min(std::max(d.y2, 0.f), (float)r.height) + r.y;
+        bool cut = (inner_l && b.x1 - r.x < TILE_EDGE_MARGIN) || (inner_t && b.y1 - r.y < TILE_EDGE_MARGIN)
+                || (inner_r && r.x + r.width - b.x2 < TILE_EDGE_MARGIN)
+                || (inner_b && r.y + r.height - b.y2 < TILE_EDGE_MARGIN);
+        p.boxes.push_back(b);
+        p.tile_of.push_back(tile.tile);
+        p.truncated.push_back(cut);
+    }
+    if (++p.received < tile.n_tiles)
+        return;
+
+    imageout_idx &out = done[frame];
+    out.img = p.img;
+    out.dets.id = frame;
+    out.dets.skipped = p.skipped;
+    merge(p, out.dets.results);
+    out.dets.count = out.dets.results.size();
+    pending.erase(frame);
+
+    // 按帧序号输出
+    std::map<int, imageout_idx>::iterator it;
+    while ((it = done.find(next_frame)) != done.end()) {
+        emit(it->second);
+        done.erase(it);
+        next_frame++;
+    }
+}
+
+/*
+    跨块 NMS, 按置信度从高到低, 只在同类的框之间 (与 post_process 的逐类 NMS 一致):
+        IoU > nms_threshold 的框去掉低分的
+        来自不同块且有一个被截断时, 交集 / 较小面积 > TILE_IOS_THRESH 即为同一目标, 去掉被截断的
+*/
+void TileMerger::merge(pending_frame &p, std::vector<DetectBox> &out)
+{
+    int n = p.boxes.size();
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&p](int a, int b) {
+        return p.boxes[a].confidence > p.boxes[b].confidence;
+    });
+    std::vector<uint8_t> removed(n, 0);
+    for (int i = 0; i < n; i++) {
+        int a = order[i];
+        if (removed[a])
+            continue;
+        for (int j = i + 1; j < n && !removed[a]; j++) {
+            int b = order[j];
+            if (removed[b] || p.boxes[a].classID != p.boxes[b].classID)
+                continue;
+            float inter = box_inter(p.boxes[a], p.boxes[b]);
+            if (inter <= 0)
+                continue;
+            float area_a = box_area(p.boxes[a]), area_b = box_area(p.boxes[b]);
+            if (inter > nms_threshold * (area_a + area_b - inter)) {
+                removed[b] = 1;
+                continue;
+            }
+            if (p.tile_of[a] == p.tile_of[b] || !(p.truncated[a] || p.truncated[b]))
+                continue;
+            if (inter > TILE_IOS_THRESH * std::min(area_a, area_b)) {
+                // 保留完整的框, 分数取两者较高的
+                if (p.truncated[a] && !p.truncated[b]) {
+                    p.boxes[b].confidence = p.boxes[a].confidence;
+                    removed[a] = 1;
+                }
+                else {
+                    removed[b] = 1;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n; i++)
+        if (!removed[order[i]])
+            out.push_back(p.boxes[order[i]]);
+}
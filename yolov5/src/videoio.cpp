@@ -1,11 +1,19 @@
+#include <unistd.h>
+#include <atomic>
+
 #include "videoio.h"
-#include "resize.h"
+#include "image_processor.h"
+#include "frame_source.h"
+#include "motion_detector.h"
 #include "common.h"
+#include "tiler.h"
+#include "cascade.h"
+#include "output_sink.h"
 
 using namespace std;
 
 extern video_property video_probs;
-extern vector<cv::Mat> imagePool;
+extern FrameQueue frameQueue;     // videoRead -> videoResize
 extern mutex mtxQueueInput;
 extern queue<input_image> queueInput;  // input queue client
 extern mutex mtxQueueDetOut;
@@ -20,12 +28,24 @@ extern bool bReading;      // flag of input
 extern bool bDetecting;    // 目标检测进程状态
 extern bool bTracking;
 extern int idxInputImage;  // image index of input video
+extern string IMAGE_BACKEND;
+extern bool TILED_INFERENCE;
+extern bool MOTION_GATING;
+extern atomic<bool> bTracksMoving;  // 追踪线程: 有确认的轨迹在动
+extern bool FOLLOW_ROI;
+extern int DETECT_INTERVAL;
+extern atomic<int> followTrackID;
+extern mutex mtxFollow;
+extern follow_state followTarget;
+extern bool DETECT_CASCADE;
+extern CascadeScheduler cascadeScheduler;  // 级联检测的逐帧模型选择
+extern string OUTPUT_SINKS;
 
 
 
 /*---------------------------------------------------------
-	读视频 缓存在imagePool
-	video_name: 视频路径
+	读视频 放进 frameQueue (有界), 由 videoResize 取走
+	video_name: 帧来源 URI (摄像头/视频文件/图片目录/原始帧), 见 frame_source.h
 	cpuid:		绑定到某核
 ----------------------------------------------------------*/
 void videoRead(const char *video_name, int cpuid) 
@@ -41,84 +61,113 @@ void videoRead(const char *video_name, int cpuid)
 
 	printf("Bind videoReadClient process to CPU %d\n", cpuid); 
 
-	// cv::VideoCapture video;
-	// if (!video.open(video_name)) {
-	// 	cout << "Fail to open " << video_name << endl;
-	// 	return;
-	// }
-
-    cv::VideoCapture video("v4l2src device=/dev/video-camera0 io-mode=4 ! video/x-raw,format=NV12,width=720,height=576,framerate=15/1 ! appsink", cv::CAP_GSTREAMER);
-	if (!video.isOpened()) {
-		cout << "Fail to open " << endl;
+	FrameSource *source = open_frame_source(video_name);
+	if (source == NULL) {
+		bReading = false;
+		frameQueue.close();
 		return;
 	}
 
-	video_probs.Frame_cnt = video.get(CV_CAP_PROP_FRAME_COUNT);
-    video_probs.Fps = video.get(CV_CAP_PROP_FPS);
-    video_probs.Video_width = video.get(CV_CAP_PROP_FRAME_WIDTH);
-    video_probs.Video_height = video.get(CV_CAP_PROP_FRAME_HEIGHT);
-    video_probs.Video_fourcc = video.get(CV_CAP_PROP_FOURCC);
+	video_probs.Frame_cnt = source->frame_count;
+    video_probs.Fps = source->fps;
+    video_probs.Video_width = source->width;
+    video_probs.Video_height = source->height;
+    video_probs.Video_fourcc = source->fourcc;
 
 	bReading = true;//读写状态标记
+	// 摄像头等实时源预处理跟不上时丢最旧的帧, 文件等着不丢
+	bool live = source->live;
+	long frames = 0;
 	while (1) 
 	{  
-		cv::Mat img_src;
-		cv::Mat frame;
+		nv12_frame img_src;
 		// 如果读不到图片 或者 bReading 不在读取状态则跳出
-		if (!video.read(img_src)) {
+		if (!source->read(img_src)) {
 			cout << "read video stream failed! Maybe to the end!" << endl;
-			video.release();
 			break;
 		}
-		cv::cvtColor(img_src, frame, cv::COLOR_YUV2BGR_NV12);
-		imagePool.emplace_back(frame);
+		// 保留 NV12 (height*3/2 x width), 只在需要时转换; 帧用完后像素缓冲回到来源的缓冲池
+		frameQueue.push(img_src, live);
+		frames++;
 	}
+	frameQueue.close();
+	delete source;
 	cout << "VideoRead is over." << endl;
-	cout << "Video Total Length: " << imagePool.size() << "\n";
+	printf("Video Total Length: %ld (dropped %ld)\n", frames, frameQueue.dropped_frames());
 }
 
-/*---------------------------------------------------------
-	调整视频尺寸
-	cpuid:		绑定到某核
-----------------------------------------------------------*/
-int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size)
+void FrameQueue::push(const nv12_frame &frame, bool drop_oldest)
 {
-	im_rect src_rect;
-	im_rect dst_rect;
-	memset(&src_rect, 0, sizeof(src_rect));
-	memset(&dst_rect, 0, sizeof(dst_rect));
-	size_t img_width = image.cols;
-	size_t img_height = image.rows;
-	if (image.type() != CV_8UC3)
-	{
-		printf("source image type is %d!\n", image.type());
-		return -1;
-	}
-	size_t target_width = target_size.width;
-	size_t target_height = target_size.height;
-	src = wrapbuffer_virtualaddr((void *)image.data, img_width, img_height, RK_FORMAT_RGB_888);
-	dst = wrapbuffer_virtualaddr((void *)resized_image.data, target_width, target_height, RK_FORMAT_RGB_888);
-	int ret = imcheck(src, dst, src_rect, dst_rect);
-	if (IM_STATUS_NOERROR != ret)
-	{
-		fprintf(stderr, "rga check error! %s", imStrError((IM_STATUS)ret));
-		return -1;
+	unique_lock<mutex> lock(mtx);
+	if (drop_oldest) {
+		if (frames.size() >= depth) {
+			frames.pop_front();
+			dropped++;
+		}
 	}
-	IM_STATUS STATUS = imresize(src, dst);
-	return 0;
+	else
+		cv_space.wait(lock, [this] { return frames.size() < depth; });
+	frames.push_back(frame);
+	cv_frame.notify_one();
 }
 
-void videoResize(int cpuid){
-	// int initialization_finished = 1;
-	rga_buffer_t src;
-	rga_buffer_t dst;
-	im_rect src_rect;
-	im_rect dst_rect;
-	memset(&src_rect, 0, sizeof(src_rect));
-	memset(&dst_rect, 0, sizeof(dst_rect));
-	memset(&src, 0, sizeof(src));
-	memset(&dst, 0, sizeof(dst));
+bool FrameQueue::pop(nv12_frame &frame)
+{
+	unique_lock<mutex> lock(mtx);
+	cv_frame.wait(lock, [this] { return !frames.empty() || closed; });
+	if (frames.empty())
+		return false;
+	frame = frames.front();
+	frames.pop_front();
+	cv_space.notify_one();
+	return true;
+}
+
+void FrameQueue::close()
+{
+	lock_guard<mutex> lock(mtx);
+	closed = true;
+	cv_frame.notify_all();
+}
 
+static size_t input_backlog()
+{
+	lock_guard<mutex> lock(mtxQueueInput);
+	return queueInput.size();
+}
+
+/*
+	跟随模式下该帧是否只检测目标附近
+	被跟随轨迹的状态外推到该帧, 得到以预测框为中心的裁剪区域; 每 FOLLOW_FULL_INTERVAL 帧或目标丢失时整帧检测
+*/
+static bool follow_tile(int frame, const nv12_frame &img, tile_t &t)
+{
+	if (followTrackID < 0 || frame % FOLLOW_FULL_INTERVAL == 0)
+		return false;
+	mtxFollow.lock();
+	follow_state s = followTarget;
+	mtxFollow.unlock();
+	int dt = frame - s.frame;
+	if (!s.valid || s.track_id != followTrackID || dt < 0 || dt > FOLLOW_FULL_INTERVAL)
+		return false;
+	t.region = follow_region(img.width, img.height, s.cx + s.vx * dt, s.cy + s.vy * dt, s.w, s.h, FOLLOW_ROI_SIZE);
+	letterbox_init(t.lb, t.region.width, t.region.height, FOLLOW_ROI_SIZE, FOLLOW_ROI_SIZE, true);
+	t.tile = 0;
+	t.n_tiles = 1;
+	return true;
+}
+
+/*---------------------------------------------------------
+	调整视频尺寸
+	NV12 一遍直接缩放/转换为网络输入的 RGB, 见 image_processor.h
+	分块模式 (TILED_INFERENCE) 下每帧按块放入多个任务, 由各检测线程自己预处理
+	运动门控 (MOTION_GATING): 画面静止且没有轨迹在动时标记该帧不检测, 也不做预处理
+	检测间隔 (DETECT_INTERVAL): 只有序号为其倍数的帧检测, 其余同样标记不检测
+	跟随模式 (FOLLOW_ROI): 整帧和目标附近的裁剪区域都作为单块任务, 由检测线程预处理
+	级联检测 (DETECT_CASCADE): 同样作为单块任务, 逐帧由 CascadeScheduler 选完整模型或小模型
+	cpuid:		绑定到某核
+----------------------------------------------------------*/
+void videoResize(int cpuid){
 	cpu_set_t mask;
 
 	CPU_ZERO(&mask);
@@ -129,7 +178,15 @@ void videoResize(int cpuid){
 
 	printf("Bind videoTransClient process to CPU %d\n", cpuid);
 
-	PreResize pre_do(NET_INPUTHEIGHT, NET_INPUTWIDTH, NET_INPUTCHANNEL);
+	ImageProcessor *pre = create_image_processor(IMAGE_BACKEND.c_str());
+	// 网络输入的内存, 检测完成后回收; 随分辨率重建
+	BufferPool *input_pool = NULL;
+	letterbox_t lb;
+	memset(&lb, 0, sizeof(lb));
+	vector<tile_t> tiles;
+	vector<tile_t> lite_tiles;  // 级联: 整帧 letterbox 到小模型输入
+	MotionDetector motion_detector;
+	int static_run = 0;  // 连续静止的帧数
 	bReading = true;//读写状态标记
 	cout << "total length of video: " << video_probs.Frame_cnt << "\n";
 	while (1) 
@@ -138,31 +195,105 @@ void videoResize(int cpuid){
 		// if (!bReading || idxInputImage >= video_probs.Frame_cnt) {
 			// break;
 		// }
-		if (idxInputImage < imagePool.size()) {
-			cv::Mat img_src = imagePool[idxInputImage];
-			cv::Mat img = img_src.clone();
-			cv::cvtColor(img_src, img, cv::COLOR_BGR2RGB);
-
-			cv::Mat img_pad;
-			resize(img, img_pad, cv::Size(640,640), 0, 0, 1);
-
-			cv::Mat resized_img(NET_INPUTHEIGHT, NET_INPUTWIDTH, CV_8UC3);
-			if (add_head){
-				// adaptive head
+		// 检测跟不上时先不取帧: 实时源在读帧队列里丢最旧的, 文件由读帧线程等着
+		while (input_backlog() >= INPUT_QUEUE_DEPTH)
+			usleep(1000);
+		nv12_frame img_src;
+		if (!frameQueue.pop(img_src))
+			break;
+		if (lb.src_w != img_src.width || lb.src_h != img_src.height) {
+			// 每个分辨率算一次, 随 input_image 交给 detect_process 还原坐标
+			letterbox_init(lb, img_src.width, img_src.height, NET_INPUTWIDTH, NET_INPUTHEIGHT, true);
+			// 边框只在分配内存时填一次, 之后每帧只写内容区域
+			delete input_pool;
+			input_pool = new BufferPool(NET_INPUTHEIGHT * NET_INPUTWIDTH * NET_INPUTCHANNEL, [lb](uint8_t *p) {
+				fill_letterbox_pad(make_image_view(p, lb.dst_w, lb.dst_h, IMAGE_RGB888), lb);
+			});
+			if (TILED_INFERENCE)
+				tile_layout(img_src.width, img_src.height, NET_INPUTWIDTH, NET_INPUTHEIGHT, TILE_OVERLAP,
+							TILE_FULL_FRAME, tiles);
+			else if (FOLLOW_ROI || DETECT_CASCADE) {
+				// 整帧也走分块路径, 与裁剪区域/小模型的结果共用合并/排序
+				tile_t t;
+				t.region.x = 0;
+				t.region.y = 0;
+				t.region.width = img_src.width;
+				t.region.height = img_src.height;
+				t.lb = lb;
+				t.tile = 0;
+				t.n_tiles = 1;
+				tiles.assign(1, t);
+				lite_tiles.clear();
 			}
-			else{
-				// rga resize
-
-				resize_rga(src, dst, img, resized_img, cv::Size(NET_INPUTHEIGHT, NET_INPUTWIDTH));
+		}
+		bool motion = true;
+		if (MOTION_GATING) {
+			motion = motion_detector.update(img_src) > MOTION_RATIO_THRESH || bTracksMoving;
+			static_run = motion ? 0 : static_run + 1;
+			if (static_run >= MOTION_REFRESH) {
+				motion = true;
+				static_run = 0;
 			}
-
+		}
+		if (DETECT_INTERVAL > 1 && idxInputImage % DETECT_INTERVAL != 0)
+			motion = false;
+		if (TILED_INFERENCE || FOLLOW_ROI || DETECT_CASCADE) {
+			// 跟随目标时只检测它附近, 否则按分块 (或整帧)
+			const vector<tile_t> *jobs = &tiles;
+			vector<tile_t> follow_job(1);
+			int model = CASCADE_FULL;
+			if (FOLLOW_ROI && follow_tile(idxInputImage, img_src, follow_job[0]))
+				jobs = &follow_job;
+			else if (DETECT_CASCADE && !TILED_INFERENCE && motion) {
+				model = cascadeScheduler.choose(idxInputImage);
+				int lite_w, lite_h;
+				if (model == CASCADE_LITE && cascadeScheduler.lite_input(lite_w, lite_h)) {
+					// 整帧 letterbox 到小模型的输入, 分辨率或小模型尺寸变了才重算
+					if (lite_tiles.empty() || lite_tiles[0].lb.dst_w != lite_w || lite_tiles[0].lb.dst_h != lite_h) {
+						lite_tiles = tiles;
+						letterbox_init(lite_tiles[0].lb, img_src.width, img_src.height, lite_w, lite_h, true);
+					}
+					jobs = &lite_tiles;
+				}
+			}
+			mtxQueueInput.lock();
+			for (const tile_t &t : *jobs) {
+				input_image job(idxInputImage, img_src, lb, t);
+				job.motion = motion;
+				job.model = model;
+				queueInput.push(job);
+			}
+			mtxQueueInput.unlock();
+			idxInputImage++;
+			continue;
+		}
+		if (!motion) {
+			input_image input(idxInputImage, img_src, lb);
+			input.motion = false;
 			mtxQueueInput.lock();
-			// queueInput.push(input_image(idxInputImage, img_src, img_pad));
-			queueInput.push(input_image(idxInputImage, img_src, resized_img));
+			queueInput.push(input);
 			mtxQueueInput.unlock();
 			idxInputImage++;
+			continue;
+		}
+
+		pooled_buffer buf = input_pool->acquire();
+		cv::Mat resized_img(NET_INPUTHEIGHT, NET_INPUTWIDTH, CV_8UC3, buf.get());
+		if (add_head){
+			// adaptive head
+		}
+		else{
+			image_view dst = make_image_view(resized_img.data, NET_INPUTWIDTH, NET_INPUTHEIGHT, IMAGE_RGB888);
+			pre->letterbox(img_src.view(), dst, lb);
 		}
+
+		mtxQueueInput.lock();
+		queueInput.push(input_image(idxInputImage, img_src, lb, resized_img, buf));
+		mtxQueueInput.unlock();
+		idxInputImage++;
 	}
+	delete pre;
+	delete input_pool;
 	bReading = false;
 	cout << "VideoResize is over." << endl;
 	cout << "Resize Video Total Length: " << queueInput.size() << "\n";
@@ -202,68 +333,42 @@ void videoWrite(const char* save_path,int cpuid)
 
 	printf("Bind videoWrite process to CPU %d\n", cpuid); 
 
-	cv::VideoWriter vid_writer;
-    while(1)
-    {
-		// cout << "checkpoint! " << queueInput.size() << "\n";
-    	if(queueInput.size() > 0)
-    	{
-            // cout << video_probs.Video_width << " " << video_probs.Video_height << endl;
-            vid_writer  = cv::VideoWriter(save_path, video_probs.Video_fourcc, video_probs.Fps, 
-										  cv::Size(video_probs.Video_width, video_probs.Video_height));
-            break;
-    	}
-    }
-
+	// 输出端在第一帧到达时创建, 那时 videoRead 已经填好视频属性
+	vector<OutputSink *> sinks;
+	bool opened = false;
 	while (1) 
 	{  
-		// if (queueOutput.size()) cout << "checkpoint in VideoWriter: " << queueOutput.size() << "\n";
-		// queueOutput 就尝试写
-		if (queueOutput.size() > 0) {
-			mtxQueueOutput.lock();
- 			imageout_idx res_pair = queueOutput.front();
+		imageout_idx res_pair;
+		mtxQueueOutput.lock();
+		bool has_frame = !queueOutput.empty();
+		if (has_frame) {
+			res_pair = queueOutput.front();
 			queueOutput.pop();
-			mtxQueueOutput.unlock();
-			mtxResult.lock();
-			result = res_pair.dets;
-			mtxResult.unlock();
-			draw_image(res_pair.img, res_pair.dets);
-			//vid_writer.write(res_pair.img); // Save-video
-			cv::imshow("DeepSORT", res_pair.img);
-			cv::waitKey(1);
 		}
-		// 最后一帧检测/追踪结束 bWriting置为false 此时如果queueOutput仍存在元素 继续写
-		else if(!bTracking){
-			vid_writer.release();
-			break;
+		mtxQueueOutput.unlock();
+		if (!has_frame) {
+			// 最后一帧追踪结束且队列已空
+			if (!bTracking)
+				break;
+			usleep(1000);
+			continue;
 		}
+		mtxResult.lock();
+		result = res_pair.dets;
+		mtxResult.unlock();
+		if (!opened) {
+			sinks = open_output_sinks(OUTPUT_SINKS, save_path, video_probs.Fps, video_probs.Video_fourcc);
+			opened = true;
+		}
+		// 各输出端都不阻塞, 跟不上时自己丢帧
+		for (OutputSink *sink : sinks)
+			sink->push(res_pair);
+	}
+	for (OutputSink *sink : sinks) {
+		sink->close();
+		printf("output %s: %ld frames, %ld rendered, dropped %ld\n", sink->name(), sink->accepted, sink->rendered,
+			   sink->dropped);
+		delete sink;
 	}
 	cout << "VideoWrite is over." << endl;
 }
-
-/*---------------------------------------------------------
-	绘制预测框
-----------------------------------------------------------*/
-string labels[2]={"person", "vehicle"};
-cv::Scalar colorArray[2]={
-	cv::Scalar(139,0,0,255),
-	cv::Scalar(139,0,139,255),
-};
-int draw_image(cv::Mat &img,detect_result_group_t detect_result_group)
-{
-	char text[256];
-    for (auto det_result : detect_result_group.results)
-    {
-        // sprintf(text, "%s %.1f%%", det_result.name, det_result.confidence * 100);
-		sprintf(text, "ID:%d", (int)det_result.trackID);
-        int x1 = det_result.x1;
-        int y1 = det_result.y1 / IMG_WIDTH * IMG_HEIGHT;
-        int x2 = det_result.x2;
-        int y2 = det_result.y2 / IMG_WIDTH * IMG_HEIGHT;
-		int class_id = det_result.classID;
-        rectangle(img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(139,0,0,255), 3);
-        putText(img, text, cv::Point(x1, y1 - 12), 1, 2, cv::Scalar(0, 255, 0, 255));
-    }
-	// imwrite("./display.jpg", img);
-	return 0;
-}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <mutex>
 #include <thread>
+#include <atomic>
 
 #include "common.h"
 #include "detect.h"
@@ -11,6 +12,9 @@
 #include "mytime.h"
 #include "videoio.h"
 #include "control.h"
+#include "cascade.h"
+#include "multistream.h"
+#include "segmented.h"
 
 using namespace std;
 
@@ -28,10 +32,49 @@ string VIDEO_SAVEPATH = PROJECT_DIR + "/data/M0201_results.mp4";
 // string YOLO_MODEL_PATH = PROJECT_DIR + "/model/best_nofocus_relu.rknn";
 string YOLO_MODEL_PATH = PROJECT_DIR + "/model/yolov5s-640-640.rknn";
 string SORT_MODEL_PATH = PROJECT_DIR + "/model/osnet_x0_25_market.rknn";
-
+// 关联优先的 Re-ID: 先按运动门控 + IoU 配对, 只给有竞争的检测/新目标算特征, 每条轨迹定期刷新一次 (见 tracker.h)
+bool LAZY_REID = false;
+// int8 输出用定点后处理 (post_process_fixed, 见 tools/bench_postprocess 的比对), 默认浮点路径
+bool POST_PROCESS_FIXED = false;
+// 级联检测的小模型 (输入尺寸从模型读), 与 YOLO_MODEL_PATH 类别相同
+string YOLO_LITE_MODEL_PATH = PROJECT_DIR + "/model/yolov5n-320-320.rknn";
+
+// 帧来源 URI, 见 frame_source.h: camera:设备?width=&height=&fps= / file:路径 / images:目录 / raw:路径?size=WxH
 // string VIDEO_PATH = PROJECT_DIR + "/data/DJI_0001_S_cut.mp4";
-string VIDEO_PATH = PROJECT_DIR + "/data/test.mp4";
+// string VIDEO_PATH = PROJECT_DIR + "/data/test.mp4";
+string VIDEO_PATH = "camera:/dev/video-camera0?width=720&height=576&fps=15";
 string VIDEO_SAVEPATH = PROJECT_DIR + "/data/results.mp4";
+// 输出端 (见 output_sink.h), 逗号分隔: null 无界面 / preview 窗口预览 / file[:<path>] 写视频 / tracks[:<path>] 追踪结果日志 / mjpeg[:<port>] 网页预览
+string OUTPUT_SINKS = "preview";
+// string OUTPUT_SINKS = "null";
+// string OUTPUT_SINKS = "preview,file";
+// string OUTPUT_SINKS = "null,tracks";
+// string OUTPUT_SINKS = "mjpeg,tracks";   // 无显示器: 浏览器打开 http://<板子 IP>:8080/
+// 非空时把检测头原始输出逐帧写入该文件, 供 tools/bench_postprocess 回放
+string CORPUS_SAVEPATH = "";
+// string CORPUS_SAVEPATH = PROJECT_DIR + "/data/corpus.bin";
+// 非空时从该文件读取感兴趣区域多边形 (原图坐标), 区域外不检测
+string ROI_PATH = "";
+// string ROI_PATH = PROJECT_DIR + "/data/roi.txt";
+// 预处理 (缩放/裁剪/颜色转换) 后端: cpu / rga / auto
+string IMAGE_BACKEND = "cpu";
+// 高分辨率输入: 每帧切成重叠的网络输入大小的块, 分给各检测线程, 跨块 NMS 合并
+bool TILED_INFERENCE = false;
+// 固定机位: 画面静止且没有轨迹在动时跳过检测, 追踪只做预测
+bool MOTION_GATING = false;
+// 跟随模式: 只在被跟随目标附近用小输入检测, 每 FOLLOW_FULL_INTERVAL 帧整帧检测一次 (需要动态形状模型)
+bool FOLLOW_ROI = false;
+// 每隔这么多帧检测一次, 中间的帧追踪只做预测; 1 为每帧检测
+int DETECT_INTERVAL = 1;
+// 没有检测的帧用稀疏光流 (缩小的亮度图上 LK) 修正轨迹, DETECT_INTERVAL 可以开到 3~5
+bool FLOW_PROPAGATION = false;
+// 级联检测: 小模型每帧刷新已有目标, 每 CASCADE_KEYFRAME 帧或小模型置信度下降时跑完整模型
+bool DETECT_CASCADE = false;
+// 多路: 非空时每个来源一路, 共用检测与 Re-ID 上下文, 各路独立追踪 (见 multistream.h), VIDEO_PATH 不用
+vector<string> STREAM_URIS = {};
+// vector<string> STREAM_URIS = {"camera:/dev/video-camera0", "camera:/dev/video-camera1", "file:" + PROJECT_DIR + "/data/M0201.mp4"};
+// 离线分段: >0 时把 VIDEO_PATH (须为文件等非实时来源) 切成这么多段并行处理, 拼接轨迹后写 VIDEO_SAVEPATH.tracks (见 segmented.h)
+int OFFLINE_SEGMENTS = 0;
 
 
 
@@ -43,11 +86,16 @@ int idxTrackImage = 0;	  // 目标追踪下一帧要处理的对象
 bool bReading = true;   // flag of input
 bool bDetecting = true; // Detect是否完成
 bool bTracking = true;  // Track是否完成
+atomic<bool> bTracksMoving(false); // 有确认的轨迹在动 (追踪线程更新, 运动门控用)
+atomic<int> followTrackID(-1);     // 跟随的轨迹 ID (controlLoop 设置), -1 为不跟随
+mutex mtxFollow;
+follow_state followTarget = {-1, -1, false, 0, 0, 0, 0, 0, 0};  // 被跟随轨迹的最新状态
+CascadeScheduler cascadeScheduler;  // 级联检测: videoResize 选模型, 检测线程反馈结果
 double start_time; // Video Detection开始时间
 double end_time;   // Video Detection结束时间
 
 // 多线程控制相关
-vector<cv::Mat> imagePool;        // video cache
+FrameQueue frameQueue(FRAME_QUEUE_DEPTH);  // videoRead -> videoResize, 有界, 帧用完即回到来源的缓冲池
 mutex mtxQueueInput;        	  // mutex of input queue
 queue<input_image> queueInput;    // input queue 
 mutex mtxQueueDetOut;
@@ -63,6 +111,10 @@ void videoResize(int cpuid);
 void videoWrite(const char* save_path,int cpuid);
 
 int main() {
+    if (!STREAM_URIS.empty())
+        return run_multistream(STREAM_URIS);
+    if (OFFLINE_SEGMENTS > 0)
+        return run_segmented(VIDEO_PATH, OFFLINE_SEGMENTS);
 
     class Yolo detect1(YOLO_MODEL_PATH.c_str(), 4, RKNN_NPU_CORE_0, 1, 3);
     class Yolo detect2(YOLO_MODEL_PATH.c_str(), 5, RKNN_NPU_CORE_1, 1, 3);
@@ -83,5 +135,7 @@ int main() {
               };
     for (int i = 0; i < thread_num; i++) threads[i].join();
     printf("Video detection mean cost time(ms): %f\n", (end_time-start_time) / video_probs.Frame_cnt);
+    if (DETECT_CASCADE)
+        cascadeScheduler.print_stats();
     return 0;
 }